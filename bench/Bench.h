@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "modules/SIMD.h"
+
+#if defined(_WIN32)
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <sched.h>
+#endif
+
+// Small self contained harness for the micro benchmarks in this folder. Each case is a callable doing
+// 'opsPerCall' operations; it is warmed up, calibrated so one sample lasts at least SampleMs, then timed
+// for a number of samples. Reports mean ns/op with a 95% confidence interval and the best sample, and
+// can write everything to JSON for comparing runs (--json out.json).
+
+namespace bench
+{
+    struct Options
+    {
+        int samples = 40;
+        double warmupMs = 200;
+        double sampleMs = 5;
+        int cpu = 0; // -1 leaves the thread unpinned
+        std::string json, filter;
+    };
+
+    struct Result
+    {
+        std::string name;
+        double nsPerOp = 0, ci95 = 0, bestNsPerOp = 0;
+        size_t callsPerSample = 0, opsPerCall = 0;
+        int samples = 0;
+    };
+
+    // Keeps 'value' (and whatever it points into) from being optimized away.
+    template<typename T>
+    static inline void DoNotOptimize(const T &value)
+    {
+        #if defined(__GNUC__)
+            asm volatile("" : : "g"(&value) : "memory");
+        #else
+            static volatile const void* sink;
+            sink = &value;
+        #endif
+    }
+
+    // Widest instruction set the build was allowed, recorded with the results
+    static const char* SIMDLevel()
+    {
+        #if defined(SR_AVX512)
+            return "avx512";
+        #elif defined(SR_AVX2)
+            return "avx2";
+        #elif defined(SR_AVX)
+            return "avx";
+        #elif defined(SR_SSE41)
+            return "sse4.1";
+        #elif defined(SR_SSE2)
+            return "sse2";
+        #else
+            return "scalar";
+        #endif
+    }
+
+    static bool PinThread(int cpu)
+    {
+        if (cpu < 0) return false;
+
+        #if defined(_WIN32)
+            return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+        #elif defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            return sched_setaffinity(0, sizeof(set), &set) == 0;
+        #else
+            return false;
+        #endif
+    }
+
+    // --samples N, --warmup MS, --sample-ms MS, --cpu N (-1 for none), --json PATH, --filter SUBSTRING
+    static Options ParseOptions(int argc, char** argv)
+    {
+        Options options;
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            if (!strcmp(argv[i], "--samples")) options.samples = std::max(2, atoi(argv[i + 1]));
+            else if (!strcmp(argv[i], "--warmup")) options.warmupMs = atof(argv[i + 1]);
+            else if (!strcmp(argv[i], "--sample-ms")) options.sampleMs = atof(argv[i + 1]);
+            else if (!strcmp(argv[i], "--cpu")) options.cpu = atoi(argv[i + 1]);
+            else if (!strcmp(argv[i], "--json")) options.json = argv[i + 1];
+            else if (!strcmp(argv[i], "--filter")) options.filter = argv[i + 1];
+            else std::cout << "[Bench] Unknown option (" << argv[i] << ")." << std::endl;
+        }
+        return options;
+    }
+
+    class Runner
+    {
+        public:
+            Runner(const Options &options) : _options(options)
+            {
+                if (_options.cpu >= 0 && !PinThread(_options.cpu))
+                    std::cout << "[Bench] Couldn't pin to cpu " << _options.cpu << ", timings may be noisier." << std::endl;
+
+                std::cout << std::left << std::setw(48) << "case" << std::right << std::setw(12) << "ns/op" << std::setw(12) << "+-95%" << std::setw(12) << "best" << std::endl;
+            }
+
+            template<typename F>
+            void Run(const std::string &name, size_t opsPerCall, F &&call)
+            {
+                if (!_options.filter.empty() && name.find(_options.filter) == std::string::npos) return;
+
+                typedef std::chrono::steady_clock Clock;
+                auto elapsedMs = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+                // Warmup doubles as calibration: count how many calls fit in the warmup time
+                size_t warmupCalls = 0;
+                const Clock::time_point warmupStart = Clock::now();
+                do { call(); warmupCalls++; } while (elapsedMs(warmupStart) < _options.warmupMs);
+
+                const double msPerCall = elapsedMs(warmupStart) / warmupCalls;
+                const size_t callsPerSample = std::max<size_t>(1, (size_t)std::ceil(_options.sampleMs / msPerCall));
+
+                std::vector<double> nsPerOp(_options.samples);
+                for (int s = 0; s < _options.samples; s++)
+                {
+                    const Clock::time_point start = Clock::now();
+                    for (size_t c = 0; c < callsPerSample; c++) call();
+                    nsPerOp[s] = elapsedMs(start) * 1e6 / ((double)callsPerSample * opsPerCall);
+                }
+
+                Result result;
+                result.name = name;
+                result.samples = _options.samples;
+                result.callsPerSample = callsPerSample;
+                result.opsPerCall = opsPerCall;
+                result.bestNsPerOp = *std::min_element(nsPerOp.begin(), nsPerOp.end());
+
+                double sum = 0;
+                for (double ns : nsPerOp) sum += ns;
+                result.nsPerOp = sum / nsPerOp.size();
+
+                double variance = 0;
+                for (double ns : nsPerOp) variance += (ns - result.nsPerOp) * (ns - result.nsPerOp);
+                variance /= nsPerOp.size() - 1;
+                result.ci95 = StudentT95(nsPerOp.size() - 1) * std::sqrt(variance / nsPerOp.size());
+
+                std::cout << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(3)
+                          << std::setw(12) << result.nsPerOp << std::setw(12) << result.ci95 << std::setw(12) << result.bestNsPerOp << std::endl;
+
+                _results.push_back(result);
+            }
+
+            inline const std::vector<Result>& get_results() const { return _results; }
+
+            bool WriteJSON() const
+            {
+                if (_options.json.empty()) return true;
+
+                std::ofstream file(_options.json);
+                if (!file)
+                {
+                    std::cout << "[Bench] Failed to write results (.\\" << _options.json << ")." << std::endl;
+                    return false;
+                }
+
+                file << std::setprecision(6) << "{\n  \"simd\": \"" << SIMDLevel() << "\",\n  \"samples\": " << _options.samples << ",\n  \"cpu\": " << _options.cpu << ",\n  \"results\": [\n";
+                for (size_t i = 0; i < _results.size(); i++)
+                {
+                    const Result &r = _results[i];
+                    file << "    { \"name\": \"" << Escaped(r.name) << "\", \"ns_per_op\": " << r.nsPerOp << ", \"ci95\": " << r.ci95
+                         << ", \"best_ns_per_op\": " << r.bestNsPerOp << ", \"calls_per_sample\": " << r.callsPerSample
+                         << ", \"ops_per_call\": " << r.opsPerCall << " }" << (i + 1 < _results.size() ? ",\n" : "\n");
+                }
+                file << "  ]\n}\n";
+
+                return true;
+            }
+
+        private:
+            Options _options;
+            std::vector<Result> _results;
+
+            // Two sided 95% quantile of Student's t, falls to the normal one past 30 degrees of freedom
+            static double StudentT95(size_t dof)
+            {
+                static const double table[] = { 0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                                2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                                2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+                return dof <= 30 ? table[dof] : 1.96;
+            }
+
+            static std::string Escaped(const std::string &text)
+            {
+                std::string out;
+                for (char c : text)
+                {
+                    if (c == '"' || c == '\\') out += '\\';
+                    out += c;
+                }
+                return out;
+            }
+    };
+}
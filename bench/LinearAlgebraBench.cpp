@@ -0,0 +1,240 @@
+// LinearAlgebra micro benchmarks, to compare builds before and after SIMD work. Build from the repo root:
+//   g++ -std=c++17 -O2 -ffp-contract=off -DTRANSFORM_STATS=1 -Isrc bench/LinearAlgebraBench.cpp src/Transform.cpp src/Camera.cpp -o bin/LinearAlgebraBench
+// add -mavx2 (and -mfma -DSR_MATRIX_FMA) for the wider paths, -DSR_NO_SIMD for the scalar ones. Leave out
+// TRANSFORM_STATS to time the Transform cases without the rebuild counters (they aren't reported then).
+// Options are listed in Bench.h, e.g. bin/LinearAlgebraBench --json avx2.json --filter Multiply
+
+#include <vector>
+
+#include "Bench.h"
+#include "Camera.h"
+#include "Transform.h"
+#include "modules/LinearAlgebra.h"
+#include "modules/BatchTransform.h"
+#include "modules/Vector3Stream.h"
+#include "modules/Geometry.h"
+
+#define BATCH 1024
+
+using namespace std;
+
+template<typename T>
+static Matrix4x4<T> SomeTRS(size_t i)
+{
+    const Quaternion<T> q = Quaternion<T>::FromEuler(Vector3<T>(T(i % 360), T(i * 7 % 360), T(i * 13 % 360)));
+    Matrix4x4<T> mat = q.ToMatrix();
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            mat[r][c] *= T(1 + r * 0.5);
+    mat[3][0] = T(i % 17); mat[3][1] = T(i % 5); mat[3][2] = -T(i % 11);
+    return mat;
+}
+
+template<typename T>
+static Vector3<T> SomeVector(size_t i)
+{
+    return Vector3<T>(T(i % 97) - 48, T(i * 3 % 89) - 44, T(i * 5 % 83) - 41 + T(0.5));
+}
+
+template<typename T>
+static void MatrixCases(bench::Runner &runner, const string &type)
+{
+    vector<Matrix4x4<T>> as(BATCH), bs(BATCH), out(BATCH);
+    vector<Vector3<T>> vecs(BATCH), outVecs(BATCH);
+    for (size_t i = 0; i < BATCH; i++)
+    {
+        as[i] = SomeTRS<T>(i);
+        bs[i] = SomeTRS<T>(i * 31 + 7);
+        vecs[i] = SomeVector<T>(i);
+    }
+
+    runner.Run("Matrix4x4<" + type + ">::MultiplyScalar", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++) out[i] = Matrix4x4<T>::MultiplyScalar(as[i], bs[i]);
+        bench::DoNotOptimize(out);
+    });
+    runner.Run("Matrix4x4<" + type + ">::Multiply", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++) out[i] = Matrix4x4<T>::Multiply(as[i], bs[i]);
+        bench::DoNotOptimize(out);
+    });
+    runner.Run("Matrix4x4<" + type + ">::Inverted", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++) out[i] = as[i].Inverted();
+        bench::DoNotOptimize(out);
+    });
+    runner.Run("Matrix4x4<" + type + ">::InvertedAffine", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++) out[i] = as[i].InvertedAffine();
+        bench::DoNotOptimize(out);
+    });
+    runner.Run("Matrix4x4<" + type + ">::InvertedRigid", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++) out[i] = as[i].InvertedRigid();
+        bench::DoNotOptimize(out);
+    });
+    runner.Run("Matrix4x4<" + type + ">::TransformVector", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++) outVecs[i] = as[i & 15].TransformVector(vecs[i]);
+        bench::DoNotOptimize(outVecs);
+    });
+}
+
+// Same work over the two layouts: an array of Vector3 against one array per component
+template<typename T>
+static void LayoutCases(bench::Runner &runner, const string &type)
+{
+    vector<Vector3<T>> aos(BATCH), aosOut(BATCH);
+    vector<T> xs(BATCH), ys(BATCH), zs(BATCH), outX(BATCH), outY(BATCH), outZ(BATCH);
+    for (size_t i = 0; i < BATCH; i++)
+    {
+        aos[i] = SomeVector<T>(i);
+        xs[i] = aos[i].x; ys[i] = aos[i].y; zs[i] = aos[i].z;
+    }
+
+    runner.Run("Vector3<" + type + ">::Normalized AoS", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++) aosOut[i] = aos[i].Normalized();
+        bench::DoNotOptimize(aosOut);
+    });
+    Vector3Stream<T> stream(BATCH);
+    for (size_t i = 0; i < BATCH; i++) stream.Set(i, aos[i]);
+
+    // In place, normalizing again costs the same
+    Vector3Stream<T> normalized = stream;
+    runner.Run("Vector3Stream<" + type + ">::Normalize", BATCH, [&] {
+        normalized.Normalize();
+        bench::DoNotOptimize(normalized);
+    });
+    runner.Run("Vector3<" + type + "> bounds AoS", BATCH, [&] {
+        Vector3<T> lo = aos[0], hi = aos[0];
+        for (size_t i = 1; i < BATCH; i++)
+        {
+            lo = Vector3<T>(min(lo.x, aos[i].x), min(lo.y, aos[i].y), min(lo.z, aos[i].z));
+            hi = Vector3<T>(max(hi.x, aos[i].x), max(hi.y, aos[i].y), max(hi.z, aos[i].z));
+        }
+        bench::DoNotOptimize(lo); bench::DoNotOptimize(hi);
+    });
+    runner.Run("Vector3Stream<" + type + ">::MinMax", BATCH, [&] {
+        Vector3<T> lo, hi;
+        stream.MinMax(&lo, &hi);
+        bench::DoNotOptimize(lo); bench::DoNotOptimize(hi);
+    });
+
+    const Matrix4x4<T> mat = SomeTRS<T>(42);
+    runner.Run("Matrix4x4<" + type + "> * point AoS", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++)
+        {
+            const Vector3<T> &p = aos[i];
+            aosOut[i] = Vector3<T>(p.x * mat[0][0] + p.y * mat[1][0] + p.z * mat[2][0] + mat[3][0],
+                                   p.x * mat[0][1] + p.y * mat[1][1] + p.z * mat[2][1] + mat[3][1],
+                                   p.x * mat[0][2] + p.y * mat[1][2] + p.z * mat[2][2] + mat[3][2]);
+        }
+        bench::DoNotOptimize(aosOut);
+    });
+    if constexpr (is_same<T, float>::value)
+    {
+        runner.Run("Matrix4x4<float> * point SoA (batch)", BATCH, [&] {
+            batch::TransformPoints(mat, xs.data(), ys.data(), zs.data(), outX.data(), outY.data(), outZ.data(), BATCH);
+            bench::DoNotOptimize(outX); bench::DoNotOptimize(outY); bench::DoNotOptimize(outZ);
+        });
+    }
+    else
+    {
+        runner.Run("Matrix4x4<" + type + "> * point SoA", BATCH, [&] {
+            for (size_t i = 0; i < BATCH; i++)
+            {
+                const T x = xs[i], y = ys[i], z = zs[i];
+                outX[i] = x * mat[0][0] + y * mat[1][0] + z * mat[2][0] + mat[3][0];
+                outY[i] = x * mat[0][1] + y * mat[1][1] + z * mat[2][1] + mat[3][1];
+                outZ[i] = x * mat[0][2] + y * mat[1][2] + z * mat[2][2] + mat[3][2];
+            }
+            bench::DoNotOptimize(outX); bench::DoNotOptimize(outY); bench::DoNotOptimize(outZ);
+        });
+    }
+}
+
+static void TransformCases(bench::Runner &runner)
+{
+    vector<Transform> rigid(BATCH), scaled(BATCH);
+    for (size_t i = 0; i < BATCH; i++)
+    {
+        rigid[i] = Transform(SomeVector<float>(i), SomeVector<float>(i * 3));
+        scaled[i] = Transform(SomeVector<float>(i), SomeVector<float>(i * 3), Vector3<float>(1, 2, 0.5f));
+    }
+
+    // Setters only flag the matrices, reading WorldToLocal() rebuilds both
+    runner.Run("Transform rebuild rigid", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++)
+        {
+            rigid[i].set_position(rigid[i].get_position());
+            bench::DoNotOptimize(rigid[i].WorldToLocal());
+        }
+    });
+    runner.Run("Transform rebuild scaled", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++)
+        {
+            scaled[i].set_position(scaled[i].get_position());
+            bench::DoNotOptimize(scaled[i].WorldToLocal());
+        }
+    });
+
+    // Several edits per frame and only the forward matrix read (drawing): one rebuild, no inverse
+    Transform::ResetStats();
+    runner.Run("Transform 3 edits + LocalToWorld", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++)
+        {
+            scaled[i].Translate(0, 0, 0);
+            scaled[i].Scale(1, 1, 1);
+            scaled[i].set_orientation(scaled[i].get_orientation());
+            bench::DoNotOptimize(scaled[i].LocalToWorld());
+        }
+    });
+
+    #if TRANSFORM_STATS
+        const TransformStats stats = Transform::get_stats();
+        cout << "    rebuilds " << stats.localRebuilds << " local, " << stats.inverseRebuilds << " inverse; skipped "
+             << stats.localSkipped << " local, " << stats.inverseSkipped << " inverse" << endl;
+    #endif
+}
+
+static void CullingCases(bench::Runner &runner)
+{
+    Camera cam;
+    cam.transform.set_position(Vector3<float>(0, 0, 40));
+    const Frustum<float> frustum = cam.ViewFrustum();
+
+    Vector3Stream<float> centers(BATCH), extents(BATCH);
+    vector<float> radii(BATCH);
+    for (size_t i = 0; i < BATCH; i++)
+    {
+        centers.Set(i, SomeVector<float>(i * 7));
+        extents.Set(i, Vector3<float>(float(1 + i % 4), float(1 + (i + 1) % 4), float(1 + (i + 2) % 4)));
+        radii[i] = extents.Get(i).Magnitud();
+    }
+    vector<Containment> out(BATCH);
+
+    runner.Run("Frustum::Classify AABB", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++) out[i] = frustum.Classify(centers.Get(i), extents.Get(i));
+        bench::DoNotOptimize(out);
+    });
+    runner.Run("batch::ClassifyAABBs", BATCH, [&] {
+        batch::ClassifyAABBs(frustum, centers, extents, out.data());
+        bench::DoNotOptimize(out);
+    });
+    runner.Run("Frustum::Classify Sphere", BATCH, [&] {
+        for (size_t i = 0; i < BATCH; i++) out[i] = frustum.Classify(Sphere<float>(centers.Get(i), radii[i]));
+        bench::DoNotOptimize(out);
+    });
+    runner.Run("batch::ClassifySpheres", BATCH, [&] {
+        batch::ClassifySpheres(frustum, centers.get_x(), centers.get_y(), centers.get_z(), radii.data(), out.data(), BATCH);
+        bench::DoNotOptimize(out);
+    });
+}
+
+int main(int argc, char** argv)
+{
+    bench::Runner runner(bench::ParseOptions(argc, argv));
+
+    MatrixCases<float>(runner, "float");
+    MatrixCases<double>(runner, "double");
+    LayoutCases<float>(runner, "float");
+    LayoutCases<double>(runner, "double");
+    TransformCases(runner);
+    CullingCases(runner);
+
+    return runner.WriteJSON() ? 0 : 1;
+}
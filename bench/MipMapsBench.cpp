@@ -0,0 +1,76 @@
+// CPU mip generation: images::DownsampleBox (SSE2, 4 texels per iteration) against a plain per channel loop,
+// then whole BuildMipChain calls, on a power of two and a non power of two image. Build from the repo root with
+//   g++ -std=c++17 -O2 -Isrc bench/MipMapsBench.cpp -o bin/MipMapsBench
+// (add -DSR_NO_SIMD for the scalar path everywhere). Options are listed in Bench.h.
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "modules/MipMaps.h"
+
+using namespace std;
+
+// DownsampleBox without the SSE2 loop
+static void DownsampleScalar(const unsigned char* src, int srcW, int srcH, unsigned char* dst, int dstW, int dstH)
+{
+    for (int y = 0; y < dstH; y++)
+    {
+        const unsigned char* row0 = src + (size_t)min(2 * y, srcH - 1) * srcW * 4;
+        const unsigned char* row1 = src + (size_t)min(2 * y + 1, srcH - 1) * srcW * 4;
+        unsigned char* out = dst + (size_t)y * dstW * 4;
+
+        for (int x = 0; x < dstW; x++)
+        {
+            const int x0 = min(2 * x, srcW - 1) * 4;
+            const int x1 = min(2 * x + 1, srcW - 1) * 4;
+
+            for (int c = 0; c < 4; c++)
+                out[x * 4 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bench::Options options = bench::ParseOptions(argc, argv);
+    options.samples = min(options.samples, 20); // Each call is megabytes of texels
+    bench::Runner runner(options);
+
+    mt19937 rng(1);
+    uniform_int_distribution<int> value(0, 255);
+
+    const int sizes[][2] = { { 2048, 2048 }, { 1920, 1080 } };
+    for (auto const &size : sizes)
+    {
+        const int width = size[0], height = size[1];
+        const string name = to_string(width) + "x" + to_string(height);
+
+        vector<unsigned char> level0((size_t)width * height * 4);
+        for (auto &v : level0) v = (unsigned char)value(rng);
+
+        const int dstW = width / 2, dstH = height / 2;
+        vector<unsigned char> level1((size_t)dstW * dstH * 4);
+
+        // Ops are output texels
+        runner.Run("DownsampleBox " + name + ", scalar", (size_t)dstW * dstH, [&] {
+            DownsampleScalar(level0.data(), width, height, level1.data(), dstW, dstH);
+            bench::DoNotOptimize(level1);
+        });
+        runner.Run("DownsampleBox " + name, (size_t)dstW * dstH, [&] {
+            images::DownsampleBox(level0.data(), width, height, level1.data(), dstW, dstH);
+            bench::DoNotOptimize(level1);
+        });
+
+        // Ops are level 0 texels, the chain reuses its buffer after the first call
+        images::MipChain chain;
+        runner.Run("BuildMipChain " + name, (size_t)width * height, [&] {
+            images::BuildMipChain(level0.data(), width, height, &chain);
+            bench::DoNotOptimize(chain.pixels);
+        });
+    }
+
+    return runner.WriteJSON() ? 0 : 1;
+}
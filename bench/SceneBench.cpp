@@ -0,0 +1,133 @@
+// SceneGraph::Update() over a million nodes, next to a plain copy of the same bytes as the memory bandwidth
+// reference, then its scaling from one thread to every hardware thread on 100k to 10M nodes. Build from the
+// repo root:
+//   g++ -std=c++17 -O2 -ffp-contract=off -Isrc bench/SceneBench.cpp src/SceneGraph.cpp -o bin/SceneBench -pthread
+// The 10M node scene takes about 1.3 GB, leave it out with e.g. --filter "Update 1M"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "SceneGraph.h"
+#include "modules/ThreadPool.h"
+
+#define ASSEMBLY_NODES 1000
+#define NODES 1000000
+
+// What Update() streams per recomputed node: position, orientation, scale, parent index, dirty flag in,
+// world matrix out
+#define NODE_BYTES (12 + 16 + 12 + 4 + 1 + 64)
+
+using namespace std;
+
+// Nothing when 'name' was filtered out
+static void PrintBandwidth(const bench::Runner &runner, const string &name)
+{
+    if (runner.get_results().empty() || runner.get_results().back().name != name) return;
+
+    const bench::Result &r = runner.get_results().back();
+    cout << "    " << fixed << setprecision(2) << NODE_BYTES / r.nsPerOp << " GB/s" << endl;
+}
+
+// Assemblies of short arms (a root, then chains of 10) built depth first, so the storage never re-sorts
+static void BuildScene(SceneGraph &scene, size_t nodes, vector<SceneNode>* roots, vector<SceneNode>* arms)
+{
+    scene.Clear();
+    scene.Reserve(nodes);
+    for (size_t a = 0; a < nodes / ASSEMBLY_NODES; a++)
+    {
+        const SceneNode root = scene.Add(INVALID_SCENE_NODE, Vector3<float>(float(a % 100), 0, float(a / 100)));
+        roots->push_back(root);
+
+        SceneNode parent = root;
+        for (int n = 1; n < ASSEMBLY_NODES; n++)
+        {
+            if (n % 10 == 1) { arms->push_back(scene.Add(root, Vector3<float>(1, 0, 0))); parent = arms->back(); continue; }
+            parent = scene.Add(parent, Vector3<float>(0, 0.5f, 0), Quaternion<float>::FromEuler(Vector3<float>(0, float(n % 90), 0)), Vector3<float>(0.95f, 0.95f, 0.95f));
+        }
+    }
+    scene.Update();
+}
+
+static string Name(const char* size, unsigned int threads)
+{
+    return string("SceneGraph::Update ") + size + ", " + to_string(threads) + (threads == 1 ? " thread" : " threads");
+}
+
+int main(int argc, char** argv)
+{
+    const bench::Options options = bench::ParseOptions(argc, argv);
+
+    // Before the runner pins this thread, the workers would inherit it and all share one core. Thread
+    // counts include the calling thread, it works through Update() along with the pool.
+    const unsigned int hardwareThreads = max(1u, thread::hardware_concurrency());
+    vector<unique_ptr<ThreadPool>> pools(hardwareThreads + 1);
+    for (unsigned int threads = 2; threads <= hardwareThreads; threads++) pools[threads].reset(new ThreadPool(threads - 1));
+
+    bench::Runner runner(options);
+
+    SceneGraph scene;
+    vector<SceneNode> roots, arms;
+    BuildScene(scene, NODES, &roots, &arms);
+
+    runner.Run("SceneGraph::Update all dirty", NODES, [&] {
+        for (SceneNode root : roots) scene.Translate(root, 0, 0, 0);
+        scene.Update();
+    });
+    PrintBandwidth(runner, "SceneGraph::Update all dirty");
+
+    runner.Run("SceneGraph::Update 10% of the arms dirty", NODES / 10, [&] {
+        for (size_t i = 0; i < arms.size(); i += 10) scene.Rotate(arms[i], 0, 1, 0);
+        scene.Update();
+    });
+    PrintBandwidth(runner, "SceneGraph::Update 10% of the arms dirty");
+
+    runner.Run("SceneGraph::Update clean", NODES, [&] { scene.Update(); });
+
+    {
+        vector<char> source((size_t)NODES * NODE_BYTES), destination((size_t)NODES * NODE_BYTES);
+        runner.Run("memcpy reference", NODES, [&] {
+            memcpy(destination.data(), source.data(), source.size());
+            bench::DoNotOptimize(destination);
+        });
+        PrintBandwidth(runner, "memcpy reference");
+    }
+
+    // Scaling, every node dirty so there's as much to split as possible
+    const size_t sizes[] = { 100000, 1000000, 10000000 };
+    const char* sizeNames[] = { "100k", "1M", "10M" };
+    for (int s = 0; s < 3; s++)
+    {
+        // Runner::Run() filters too, this just saves building scenes nothing will run on
+        vector<string> names;
+        for (unsigned int threads = 1; threads <= hardwareThreads; threads++)
+            if (options.filter.empty() || Name(sizeNames[s], threads).find(options.filter) != string::npos) names.push_back(Name(sizeNames[s], threads));
+        if (names.empty()) continue;
+
+        roots.clear(); arms.clear();
+        BuildScene(scene, sizes[s], &roots, &arms);
+
+        double single = 0;
+        for (unsigned int threads = 1; threads <= hardwareThreads; threads++)
+        {
+            const string name = Name(sizeNames[s], threads);
+            if (find(names.begin(), names.end(), name) == names.end()) continue;
+
+            ThreadPool* pool = pools[threads].get();
+            runner.Run(name, sizes[s], [&] {
+                for (SceneNode root : roots) scene.Translate(root, 0, 0, 0);
+                scene.Update(pool);
+            });
+
+            const double ns = runner.get_results().back().nsPerOp;
+            if (threads == 1) single = ns;
+            cout << "    " << fixed << setprecision(2) << NODE_BYTES / ns << " GB/s";
+            if (single > 0) cout << ", " << single / ns << "x";
+            cout << endl;
+        }
+    }
+
+    return runner.WriteJSON() ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+// Transform update over 1M objects, Euler angles in, matrices out: std::sin/std::cos against the
+// vectorized fastmath::SinCos that Quaternion<float>::FromEuler uses. Build from the repo root with
+//   g++ -std=c++17 -O2 -mavx2 -ffp-contract=off -Isrc bench/TransformBench.cpp src/Transform.cpp -o bin/TransformBench
+// (drop -mavx2 for the SSE2 lanes, add -DSR_NO_SIMD for the scalar ones). Options are listed in Bench.h.
+
+#include <cmath>
+#include <vector>
+
+#include "Bench.h"
+#include "Transform.h"
+#include "modules/FastMath.h"
+
+#define OBJECTS 1000000
+
+using namespace std;
+
+// FromEuler as it was, one libm call per sine and cosine
+static Quaternion<float> FromEulerLibm(const Vector3<float> &euler)
+{
+    const float hx = euler.x * float(DEG2RAD) / 2, hy = euler.y * float(DEG2RAD) / 2, hz = euler.z * float(DEG2RAD) / 2;
+    const float sx = sin(hx), cx = cos(hx);
+    const float sy = sin(hy), cy = cos(hy);
+    const float sz = sin(hz), cz = cos(hz);
+
+    return Quaternion<float>(
+        sx * cy * cz - cx * sy * sz,
+        cx * sy * cz + sx * cy * sz,
+        cx * cy * sz - sx * sy * cz,
+        cx * cy * cz + sx * sy * sz
+    );
+}
+
+int main(int argc, char** argv)
+{
+    bench::Options options = bench::ParseOptions(argc, argv);
+    options.samples = min(options.samples, 10); // Each call is already a million objects
+    bench::Runner runner(options);
+
+    vector<Transform> transforms(OBJECTS);
+    vector<Vector3<float>> angles(OBJECTS);
+    for (size_t i = 0; i < OBJECTS; i++)
+        angles[i] = Vector3<float>((float)(i % 360), (float)(i * 7 % 360) - 180, (float)(i * 13 % 720) - 360);
+
+    // Whole update, orientation built from Euler angles then the matrices refreshed
+    const Vector3<float> spin(0.5f, 0.25f, 0.125f);
+    float frame = 0;
+    runner.Run("Transform update, std::sin/cos", OBJECTS, [&] {
+        for (size_t i = 0; i < OBJECTS; i++) transforms[i].set_orientation(FromEulerLibm(angles[i] + spin * frame));
+        bench::DoNotOptimize(transforms);
+        frame++;
+    });
+    runner.Run("Transform update, fastmath", OBJECTS, [&] {
+        for (size_t i = 0; i < OBJECTS; i++) transforms[i].set_orientation(Quaternion<float>::FromEuler(angles[i] + spin * frame));
+        bench::DoNotOptimize(transforms);
+        frame++;
+    });
+
+    // Just the trig, as one flat stream of 3M angles
+    vector<float> flat(OBJECTS * 3), sines(OBJECTS * 3), cosines(OBJECTS * 3);
+    for (size_t i = 0; i < OBJECTS; i++)
+    {
+        flat[i * 3 + 0] = angles[i].x * float(DEG2RAD);
+        flat[i * 3 + 1] = angles[i].y * float(DEG2RAD);
+        flat[i * 3 + 2] = angles[i].z * float(DEG2RAD);
+    }
+
+    runner.Run("SinCos stream, std::sin/cos", flat.size(), [&] {
+        for (size_t i = 0; i < flat.size(); i++) { sines[i] = sin(flat[i]); cosines[i] = cos(flat[i]); }
+        bench::DoNotOptimize(sines); bench::DoNotOptimize(cosines);
+    });
+    runner.Run("SinCos stream, fastmath", flat.size(), [&] {
+        fastmath::SinCos(flat.data(), sines.data(), cosines.data(), flat.size());
+        bench::DoNotOptimize(sines); bench::DoNotOptimize(cosines);
+    });
+
+    return runner.WriteJSON() ? 0 : 1;
+}
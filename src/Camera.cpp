@@ -1,5 +1,7 @@
 #include "Camera.h"
 
+#include <algorithm>
+
 
 using namespace std;
 
@@ -54,6 +56,28 @@ void Camera::set_resolution(const int w, const int h)
     OnPropertyChange();
 }
 
+const Frustum<float>& Camera::ViewFrustum() const
+{
+    if (_frustumDirty || _frustumVersion != transform.get_version())
+    {
+        _frustum = Frustum<float>::FromMatrix(Matrix4x4<float>::Chain(WorldToCamera(), _projectionMatrix));
+        _frustumVersion = transform.get_version();
+        _frustumDirty = false;
+    }
+    return _frustum;
+}
+
+float Camera::ProjectedSize(const Vector3<float> &center, float radius) const
+{
+    const float pixelScale = _projectionMatrix[1][1] * _resolution.second;
+    if (_mode == CameraMode::Orthographic) return radius * pixelScale;
+
+    const float distance = (center - transform.get_position()).Magnitud();
+    if (distance <= radius) return (float)max(_resolution.first, _resolution.second);
+
+    return radius / distance * pixelScale;
+}
+
 Matrix4x4<float> Camera::PerspectiveProjection()
 {
     float xScalar, yScalar;
@@ -85,6 +109,7 @@ void Camera::OnPropertyChange()
 {
     CalculateCanvasPlane();
     RefreshProjectionMatrix();
+    _frustumDirty = true;
 }
 
 void Camera::RefreshProjectionMatrix()
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "modules/LinearAlgebra.h"
+#include "modules/Geometry.h"
 #include "Transform.h"
 
 #define INCH2MM 25.4
@@ -18,10 +19,13 @@ class Camera
         Camera(float fLength, std::pair<float,float> aperture, std::pair<int,int> resolution, float zNear, float zFar, CameraMode mode = CameraMode::Perspective, CameraScaling scaling = CameraScaling::Fill);
 
 
-        inline Matrix4x4<float> CameraToWorld(bool transpose = false) { return transform.LocalToWorld(transpose); }
-        inline Matrix4x4<float> WorldToCamera(bool transpose = false) { return transform.WorldToLocal(transpose); }
+        inline const Matrix4x4<float>& CameraToWorld() const { return transform.LocalToWorld(); }
+        inline const Matrix4x4<float>& WorldToCamera() const { return transform.WorldToLocal(); }
+        inline const Matrix4x4<float>& ProjectionMatrix() const { return _projectionMatrix; }
 
-        inline Matrix4x4<float> ProjectionMatrix(bool transpose = false) { return transpose ? _projectionMatrix.Transposed() : _projectionMatrix; }
+        inline Matrix4x4<float> CameraToWorld(bool transpose) const { return transform.LocalToWorld(transpose); }
+        inline Matrix4x4<float> WorldToCamera(bool transpose) const { return transform.WorldToLocal(transpose); }
+        inline Matrix4x4<float> ProjectionMatrix(bool transpose) const { return transpose ? _projectionMatrix.Transposed() : _projectionMatrix; }
 
         inline float FilmAspectRatio() const { return _aperture.first / _aperture.second; }
         inline float PixelAspectRatio() const { return (float)_resolution.first / (float)_resolution.second; }
@@ -32,6 +36,13 @@ class Camera
         inline std::pair<int, int> get_resolution() const { return _resolution; }
 
         inline Rect<float> get_canvasPlane() const { return _canvasPlane; }
+
+        // World space planes of the view volume, from WorldToCamera() and ProjectionMatrix(). Rebuilt on the
+        // first call after the projection or the transform changed.
+        const Frustum<float>& ViewFrustum() const;
+
+        // Approximate on screen diameter, in pixels, of a world space sphere.
+        float ProjectedSize(const Vector3<float> &center, float radius) const;
         
 
         void set_fLength(const float flength);
@@ -52,6 +63,10 @@ class Camera
 
         Rect<float> _canvasPlane;
 
+        mutable Frustum<float> _frustum;
+        mutable uint32_t _frustumVersion = 0;   // transform.get_version() it was built for
+        mutable bool _frustumDirty = true;      // Projection changed since
+
         Matrix4x4<float> PerspectiveProjection();
         Matrix4x4<float> OrthographicProjection();
 
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+
+
+static void FatalError(const std::string &msg)
+{
+    std::cout << "[FATAL ERROR] " << msg << "\n"
+              << "Press any key to exit... " << std::endl;
+
+    char s;
+    std::cin >> s ;
+
+    SDL_Quit();
+    exit(1);
+}
+
+#define GLCheck(x) GLClearErrors(); x; GLPrintErrors(__FILE__, #x, __LINE__);
+
+static void GLClearErrors() { while (glGetError() != GL_NO_ERROR); }
+
+static void GLPrintErrors(const char* file, const char* func, int line)
+{
+    bool onError = false;
+
+    GLenum error;
+    while ((error = glGetError()) != GL_NO_ERROR)
+    {
+        std::cout << "[OPENGL ERROR] " << file << " - line: " << line << " " << func << " (Error code " << error << ")." << std::endl;
+        onError = true;
+    }
+
+    if (onError) FatalError("OpenGL error detected");
+}
@@ -0,0 +1,288 @@
+#include "InstanceBuffer.h"
+
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+
+#include "GLDebug.h"
+
+
+using namespace std;
+
+static void Pack(const Matrix4x4<float> &mat, float m0[4], float m1[4], float m2[4])
+{
+    for (int r = 0; r < 4; r++)
+    {
+        m0[r] = mat[r][0];
+        m1[r] = mat[r][1];
+        m2[r] = mat[r][2];
+    }
+}
+
+static Matrix4x4<float> Unpack(const float m0[4], const float m1[4], const float m2[4])
+{
+    Matrix4x4<float> mat;
+    for (int r = 0; r < 4; r++)
+    {
+        mat[r][0] = m0[r];
+        mat[r][1] = m1[r];
+        mat[r][2] = m2[r];
+    }
+    return mat;
+}
+
+InstanceBuffer::InstanceBuffer()
+{
+    GLCheck(glGenBuffers(1, &_vboID));
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    glDeleteBuffers(1, &_vboID);
+}
+
+void InstanceBuffer::Attach(int firstLocation)
+{
+    _firstLocation = firstLocation;
+    GLCheck(glBindBuffer(GL_ARRAY_BUFFER, _vboID));
+
+    for (int i = 0; i < 3; i++)
+    {
+        GLCheck(glEnableVertexAttribArray(firstLocation + i));
+        GLCheck(glVertexAttribPointer(firstLocation + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (const void*)(i * 4 * sizeof(float))));
+        GLCheck(glVertexAttribDivisor(firstLocation + i, 1));
+    }
+}
+
+Instance InstanceBuffer::Add(const Matrix4x4<float> &localToWorld)
+{
+    const uint32_t index = (uint32_t)_instances.size();
+
+    Instance instance;
+    if (!_freeHandles.empty())
+    {
+        instance = _freeHandles.back();
+        _freeHandles.pop_back();
+        _indices[instance] = index;
+    }
+    else
+    {
+        instance = (Instance)_indices.size();
+        _indices.push_back(index);
+    }
+
+    InstanceData data;
+    Pack(localToWorld, data.m0, data.m1, data.m2);
+    _instances.push_back(data);
+    _handles.push_back(instance);
+    _dirty.push_back(0);
+    _centers.PushBack(Vector3<float>(0, 0, 0));
+    _extents.PushBack(Vector3<float>(0, 0, 0));
+    MarkDirty(index);
+    if (_culling) UpdateBounds(index);
+
+    return instance;
+}
+
+void InstanceBuffer::Remove(Instance instance)
+{
+    if (!IsValid(instance)) return;
+
+    // The last one fills the gap, only that slot has to be sent again
+    const uint32_t index = _indices[instance], last = (uint32_t)_instances.size() - 1;
+    if (index != last)
+    {
+        _instances[index] = _instances[last];
+        _handles[index] = _handles[last];
+        _centers.Set(index, _centers.Get(last));
+        _extents.Set(index, _extents.Get(last));
+        _indices[_handles[index]] = index;
+        MarkDirty(index);
+    }
+
+    if (_dirty[last]) _dirtyCount--;
+    _instances.pop_back();
+    _handles.pop_back();
+    _dirty.pop_back();
+    _centers.Resize(last);
+    _extents.Resize(last);
+
+    _indices[instance] = INVALID_INDEX;
+    _freeHandles.push_back(instance);
+}
+
+void InstanceBuffer::Clear()
+{
+    _instances.clear();
+    _dirty.clear();
+    _handles.clear();
+    _centers.Clear();
+    _extents.Clear();
+    _indices.clear();
+    _freeHandles.clear();
+    _dirtyCount = 0;
+}
+
+void InstanceBuffer::Reserve(size_t count)
+{
+    _instances.reserve(count);
+    _dirty.reserve(count);
+    _handles.reserve(count);
+    _centers.Reserve(count);
+    _extents.Reserve(count);
+    _indices.reserve(count);
+}
+
+void InstanceBuffer::Set(Instance instance, const Matrix4x4<float> &localToWorld)
+{
+    InstanceData data;
+    Pack(localToWorld, data.m0, data.m1, data.m2);
+
+    const uint32_t index = _indices[instance];
+    if (!memcmp(&_instances[index], &data, sizeof(InstanceData))) return;
+
+    _instances[index] = data;
+    MarkDirty(index);
+    if (_culling) UpdateBounds(index);
+}
+
+void InstanceBuffer::set_meshBounds(const AABB<float> &bounds)
+{
+    _meshBounds = bounds;
+    _culling = true;
+
+    for (uint32_t i = 0; i < (uint32_t)_instances.size(); i++) UpdateBounds(i);
+}
+
+void InstanceBuffer::Upload()
+{
+    _lastUpload = InstanceStats();
+    _lastUpload.instances = _instances.size();
+    if (_dirtyCount == 0) return;
+
+    GLCheck(glBindBuffer(GL_ARRAY_BUFFER, _vboID));
+
+    if (_instances.size() > _capacity)
+    {
+        _capacity = max(_instances.size(), _capacity * 2);
+        GLCheck(glBufferData(GL_ARRAY_BUFFER, _capacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW));
+        GLCheck(glBufferSubData(GL_ARRAY_BUFFER, 0, _instances.size() * sizeof(InstanceData), _instances.data()));
+
+        _lastUpload.uploaded = _instances.size();
+        _lastUpload.ranges = 1;
+        _lastUpload.reallocated = true;
+    }
+    else
+    {
+        // Dirty runs, with short clean gaps between them folded in
+        const size_t count = _dirty.size();
+        const uint8_t* dirty = _dirty.data();
+        for (size_t i = 0; i < count; )
+        {
+            const uint8_t* next = (const uint8_t*)memchr(dirty + i, 1, count - i);
+            if (!next) break;
+
+            const size_t first = next - dirty;
+            size_t end = first + 1;
+            for (size_t clean = 0; end < count && clean <= INSTANCE_MERGE_GAP; end++)
+            {
+                if (dirty[end]) clean = 0;
+                else clean++;
+            }
+            while (!dirty[end - 1]) end--;
+
+            GLCheck(glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(InstanceData), (end - first) * sizeof(InstanceData), &_instances[first]));
+
+            _lastUpload.uploaded += end - first;
+            _lastUpload.ranges++;
+            i = end;
+        }
+    }
+
+    memset(_dirty.data(), 0, _dirty.size());
+    _dirtyCount = 0;
+}
+
+void InstanceBuffer::Draw(int indexCount)
+{
+    const auto start = chrono::steady_clock::now();
+    _lastDraw = InstanceDrawStats();
+    _lastDraw.visible = _instances.size();
+    if (_instances.empty()) return;
+
+    GLCheck(glBindBuffer(GL_ARRAY_BUFFER, _vboID));
+    DrawRange(indexCount, 0, _instances.size());
+    _lastDraw.drawMs = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void InstanceBuffer::Draw(int indexCount, const Frustum<float> &frustum)
+{
+    if (!_culling)
+    {
+        Draw(indexCount);
+        return;
+    }
+
+    const auto start = chrono::steady_clock::now();
+    _lastDraw = InstanceDrawStats();
+    if (_instances.empty()) return;
+
+    _containment.resize(_instances.size());
+    batch::ClassifyAABBs(frustum, _centers, _extents, _containment.data());
+    _lastDraw.cullMs = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+
+    GLCheck(glBindBuffer(GL_ARRAY_BUFFER, _vboID));
+
+    // Visible runs, a short enough stretch of culled instances between two of them is drawn along
+    size_t first = 0, end = 0;
+    for (size_t i = 0; i < _containment.size(); i++)
+    {
+        if (_containment[i] == Containment::Outside) continue;
+        _lastDraw.visible++;
+
+        if (end > 0 && i - end <= INSTANCE_DRAW_GAP)
+        {
+            end = i + 1;
+            continue;
+        }
+
+        if (end > 0) DrawRange(indexCount, first, end);
+        first = i;
+        end = i + 1;
+    }
+    if (end > 0) DrawRange(indexCount, first, end);
+
+    _lastDraw.culled = _instances.size() - _lastDraw.visible;
+    _lastDraw.drawMs = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Instanced draws can't start past the first instance in GL 3.3, the attributes are pointed at it instead.
+void InstanceBuffer::DrawRange(int indexCount, size_t first, size_t end)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        GLCheck(glVertexAttribPointer(_firstLocation + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (const void*)(first * sizeof(InstanceData) + i * 4 * sizeof(float))));
+    }
+
+    GLCheck(glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr, (GLsizei)(end - first)));
+
+    _lastDraw.drawn += end - first;
+    _lastDraw.drawCalls++;
+}
+
+void InstanceBuffer::UpdateBounds(uint32_t index)
+{
+    const InstanceData &data = _instances[index];
+    const AABB<float> box = _meshBounds.Transformed(Unpack(data.m0, data.m1, data.m2));
+
+    _centers.Set(index, box.Center());
+    _extents.Set(index, box.Extents());
+}
+
+void InstanceBuffer::MarkDirty(uint32_t index)
+{
+    if (_dirty[index]) return;
+
+    _dirty[index] = 1;
+    _dirtyCount++;
+}
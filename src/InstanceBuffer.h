@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "modules/LinearAlgebra.h"
+#include "modules/Geometry.h"
+#include "modules/Vector3Stream.h"
+
+#define INSTANCE_ATTRIBUTE_LOCATION 2   // First of the three vec4 attributes an instance takes
+#define INSTANCE_MERGE_GAP 64           // Clean instances between two dirty runs sent anyway, to save a call
+#define INSTANCE_DRAW_GAP 16            // Culled instances between two visible runs drawn anyway, same reason
+
+typedef uint32_t Instance;
+
+#define INVALID_INSTANCE ((Instance)-1)
+
+struct InstanceStats
+{
+    size_t instances;
+    size_t uploaded;    // Instances sent by the last Upload()
+    size_t ranges;      // Buffer updates they took
+    bool reallocated;   // The buffer had to grow, everything went up at once
+};
+
+struct InstanceDrawStats
+{
+    size_t visible;     // Inside or intersecting the frustum
+    size_t culled;
+    size_t drawn;       // Visible ones plus the culled ones bridging two runs
+    size_t drawCalls;
+    float cullMs;       // Classifying the boxes
+    float drawMs;       // All of Draw(), culling and submission
+};
+
+// Per-instance model matrices in a vertex buffer, so one glDrawElementsInstanced() draws every copy of a
+// mesh. Attach() adds them to the bound vertex array as three vec4 attributes with a divisor of 1: the
+// columns of the row vector matrix (the rows GL sees), the vertex shader does
+//   world = vec3(dot(p, m0), dot(p, m1), dot(p, m2))   with p = vec4(position, 1)
+//
+// Instances are stored densely (removal moves the last one into the gap) behind stable handles. Set()
+// ignores matrices that didn't change, and Upload() only sends the dirty runs.
+//
+// Once the mesh bounds are known every instance also keeps its world space box, and Draw() can cull them
+// against a frustum first: the boxes go through batch::ClassifyAABBs, and only the runs of visible
+// instances are drawn, by pointing the attributes at the start of each run. Instances added close
+// together in space (rows of a grid...) make for few, long runs.
+class InstanceBuffer
+{
+    public:
+        // Needs a current GL context.
+        InstanceBuffer();
+        ~InstanceBuffer();
+
+        InstanceBuffer(const InstanceBuffer&) = delete;
+        InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+        // Points the instance attributes of the currently bound vertex array at this buffer.
+        void Attach(int firstLocation = INSTANCE_ATTRIBUTE_LOCATION);
+
+        Instance Add(const Matrix4x4<float> &localToWorld);
+        void Remove(Instance instance);
+        void Clear();
+        void Reserve(size_t count);
+
+        void Set(Instance instance, const Matrix4x4<float> &localToWorld);
+
+        inline bool IsValid(Instance instance) const { return instance < _indices.size() && _indices[instance] != INVALID_INDEX; }
+        inline size_t size() const { return _instances.size(); }
+
+        // Sends what changed since the last call, before drawing.
+        void Upload();
+        // Every instance of the bound mesh (vertex array and program bound by the caller) in one call.
+        void Draw(int indexCount);
+        // Only the instances in 'frustum', all of them until set_meshBounds() was called.
+        void Draw(int indexCount, const Frustum<float> &frustum);
+
+        // Local space, world boxes of the instances are this one moved by their matrix.
+        void set_meshBounds(const AABB<float> &bounds);
+
+        inline const InstanceStats& get_lastUpload() const { return _lastUpload; }
+        inline const InstanceDrawStats& get_lastDraw() const { return _lastDraw; }
+
+    private:
+        static constexpr uint32_t INVALID_INDEX = (uint32_t)-1;
+
+        struct InstanceData
+        {
+            float m0[4], m1[4], m2[4];
+        };
+
+        unsigned int _vboID = 0;
+        int _firstLocation = INSTANCE_ATTRIBUTE_LOCATION;
+        size_t _capacity = 0;                   // In instances, of the GL buffer
+
+        // Dense
+        std::vector<InstanceData> _instances;
+        std::vector<uint8_t> _dirty;
+        std::vector<Instance> _handles;
+        Vector3Stream<float> _centers, _extents;  // World boxes, when the mesh bounds are known
+        std::vector<Containment> _containment;
+
+        std::vector<uint32_t> _indices;         // Handle -> dense index
+        std::vector<Instance> _freeHandles;
+
+        size_t _dirtyCount = 0;
+
+        AABB<float> _meshBounds;
+        bool _culling = false;
+
+        InstanceStats _lastUpload = {};
+        InstanceDrawStats _lastDraw = {};
+
+        void MarkDirty(uint32_t index);
+        void UpdateBounds(uint32_t index);
+        void DrawRange(int indexCount, size_t first, size_t end);
+};
@@ -0,0 +1,86 @@
+#include "Picking.h"
+
+#include <chrono>
+
+
+using namespace std;
+
+PickObject Picking::Add(const BVH* bvh, const Transform* transform)
+{
+    if (!bvh || !transform) return INVALID_PICK_OBJECT;
+
+    if (!_freeObjects.empty())
+    {
+        const PickObject object = _freeObjects.back();
+        _freeObjects.pop_back();
+        _objects[object] = { bvh, transform };
+        return object;
+    }
+
+    _objects.push_back({ bvh, transform });
+    return (PickObject)_objects.size() - 1;
+}
+
+void Picking::Remove(PickObject object)
+{
+    if (!IsValid(object)) return;
+
+    _objects[object] = { nullptr, nullptr };
+    _freeObjects.push_back(object);
+}
+
+void Picking::Clear()
+{
+    _objects.clear();
+    _freeObjects.clear();
+}
+
+Ray<float> Picking::ScreenRay(const Camera &camera, float x, float y)
+{
+    const pair<int, int> resolution = camera.get_resolution();
+    const float ndcX = 2 * (x + 0.5f) / resolution.first - 1;
+    const float ndcY = 1 - 2 * (y + 0.5f) / resolution.second;
+
+    // Clip space z -1 and 1 are the near and far planes, back to camera space and then to the world
+    const Matrix4x4<float> clipToWorld = Matrix4x4<float>::Chain(camera.ProjectionMatrix().Inverted(), camera.CameraToWorld());
+    const Vector3<float> nearPoint = clipToWorld.TransformVector(Vector3<float>(ndcX, ndcY, -1));
+    const Vector3<float> farPoint = clipToWorld.TransformVector(Vector3<float>(ndcX, ndcY, 1));
+
+    return Ray<float>(nearPoint, (farPoint - nearPoint).Normalized());
+}
+
+PickHit Picking::Pick(const Camera &camera, float x, float y)
+{
+    const auto start = chrono::steady_clock::now();
+    const PickHit hit = Cast(ScreenRay(camera, x, y));
+    _lastPickMs = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+
+    return hit;
+}
+
+PickHit Picking::Cast(const Ray<float> &ray, float maxDistance) const
+{
+    PickHit best;
+    best.distance = maxDistance;
+
+    for (size_t i = 0; i < _objects.size(); i++)
+    {
+        const Object &object = _objects[i];
+        if (!object.bvh || object.bvh->empty()) continue;
+
+        // The direction isn't renormalized, so t still measures world units along the world ray
+        const Matrix4x4<float> &worldToLocal = object.transform->WorldToLocal();
+        const Ray<float> local(worldToLocal.TransformVector(ray.origin), worldToLocal * ray.direction);
+
+        RayHit hit;
+        if (!object.bvh->Intersect(local, &hit, best.distance)) continue;
+
+        best.object = (PickObject)i;
+        best.triangle = hit.triangle;
+        best.u = hit.u; best.v = hit.v;
+        best.distance = hit.t;
+    }
+
+    if (best.Hit()) best.point = ray.At(best.distance);
+    return best;
+}
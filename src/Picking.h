@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+
+#include "modules/LinearAlgebra.h"
+#include "modules/Geometry.h"
+#include "modules/BVH.h"
+#include "Camera.h"
+#include "Transform.h"
+
+typedef int PickObject;
+
+#define INVALID_PICK_OBJECT ((PickObject)-1)
+
+struct PickHit
+{
+    PickObject object = INVALID_PICK_OBJECT;
+    int triangle = -1;              // In the object's mesh (its index buffer / 3)
+    float u = 0, v = 0;             // Barycentrics of the triangle's second and third corners
+    float distance = std::numeric_limits<float>::infinity(); // World units from the near plane
+    Vector3<float> point;           // World space
+
+    inline bool Hit() const { return object != INVALID_PICK_OBJECT; }
+};
+
+// Mouse picking on the CPU: the cursor is unprojected into a world space ray and cast through the BVH of
+// every registered object, in its local space, so nothing waits on the GPU. Local rays keep the world
+// ray's parameter, which lets the closest hit so far bound every following object.
+//
+// The BVHs and transforms are borrowed, they have to outlive their registration.
+class Picking
+{
+    public:
+        PickObject Add(const BVH* bvh, const Transform* transform);
+        void Remove(PickObject object);
+        void Clear();
+
+        // World space ray through a pixel (origin at the top left, like SDL's mouse coordinates), from the
+        // near plane and normalized.
+        static Ray<float> ScreenRay(const Camera &camera, float x, float y);
+
+        PickHit Pick(const Camera &camera, float x, float y);
+        PickHit Cast(const Ray<float> &ray, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+        inline const Transform* get_transform(PickObject object) const { return IsValid(object) ? _objects[object].transform : nullptr; }
+        inline float get_lastPickMs() const { return _lastPickMs; }
+
+    private:
+        struct Object
+        {
+            const BVH* bvh;
+            const Transform* transform;
+        };
+
+        std::vector<Object> _objects;
+        std::vector<PickObject> _freeObjects;
+
+        float _lastPickMs = 0;
+
+        inline bool IsValid(PickObject object) const { return object >= 0 && object < (PickObject)_objects.size() && _objects[object].bvh; }
+};
@@ -0,0 +1,358 @@
+#include "SceneGraph.h"
+
+#include <cstring>
+
+
+using namespace std;
+
+template<typename Vector>
+static void Permute(Vector &values, const vector<uint32_t> &order)
+{
+    Vector permuted(order.size());
+    for (size_t i = 0; i < order.size(); i++) permuted[i] = values[order[i]];
+    values.swap(permuted);
+}
+
+static void Permute(Vector3Stream<float> &stream, const vector<uint32_t> &order)
+{
+    Vector3Stream<float> permuted(order.size());
+    for (size_t i = 0; i < order.size(); i++) permuted.Set(i, stream.Get(order[i]));
+    stream = move(permuted);
+}
+
+SceneNode SceneGraph::Add(SceneNode parent, const Vector3<float> &position, const Quaternion<float> &orientation, const Vector3<float> &scale)
+{
+    uint32_t parentIndex = INVALID_INDEX;
+    if (parent != INVALID_SCENE_NODE)
+    {
+        if (!IsValid(parent)) return INVALID_SCENE_NODE;
+        parentIndex = _indices[parent];
+    }
+
+    const uint32_t index = (uint32_t)_handles.size();
+
+    // Appending only keeps the order when the parent's subtree is the last one, then it (and every
+    // ancestor, they all end here too) just grows by one
+    if (parentIndex != INVALID_INDEX)
+    {
+        if (_sorted && parentIndex + _subtreeSizes[parentIndex] == index)
+            for (uint32_t a = parentIndex; a != INVALID_INDEX; a = _parents[a]) _subtreeSizes[a]++;
+        else _sorted = false;
+    }
+
+    SceneNode node;
+    if (!_freeHandles.empty())
+    {
+        node = _freeHandles.back();
+        _freeHandles.pop_back();
+        _indices[node] = index;
+    }
+    else
+    {
+        node = (SceneNode)_indices.size();
+        _indices.push_back(index);
+    }
+
+    const Quaternion<float> q = orientation.Normalized();
+    _positions.PushBack(position);
+    _scales.PushBack(scale);
+    _qx.push_back(q.x); _qy.push_back(q.y); _qz.push_back(q.z); _qw.push_back(q.w);
+    _parents.push_back(parentIndex);
+    _subtreeSizes.push_back(1);
+    _dirty.push_back(1);
+    _world.emplace_back();
+    _handles.push_back(node);
+
+    _alive++;
+    return node;
+}
+
+void SceneGraph::Remove(SceneNode node)
+{
+    if (!IsValid(node)) return;
+    if (!_sorted) Relayout();
+
+    // The range stays in place (and counted by the ancestors) as a hole until the next Update()
+    const uint32_t first = _indices[node], end = first + _subtreeSizes[first];
+    for (uint32_t i = first; i < end; i++)
+    {
+        const SceneNode handle = _handles[i];
+        if (handle == INVALID_SCENE_NODE) continue;
+
+        _indices[handle] = INVALID_INDEX;
+        _freeHandles.push_back(handle);
+        _handles[i] = INVALID_SCENE_NODE;
+        _alive--;
+    }
+    _holes = true;
+}
+
+void SceneGraph::Clear()
+{
+    _positions.Clear(); _scales.Clear();
+    _qx.clear(); _qy.clear(); _qz.clear(); _qw.clear();
+    _parents.clear();
+    _subtreeSizes.clear();
+    _dirty.clear();
+    _world.clear();
+    _handles.clear();
+
+    _indices.clear();
+    _freeHandles.clear();
+
+    _alive = 0;
+    _sorted = true;
+    _holes = false;
+}
+
+void SceneGraph::Reserve(size_t count)
+{
+    _positions.Reserve(count); _scales.Reserve(count);
+    _qx.reserve(count); _qy.reserve(count); _qz.reserve(count); _qw.reserve(count);
+    _parents.reserve(count);
+    _subtreeSizes.reserve(count);
+    _dirty.reserve(count);
+    _world.reserve(count);
+    _handles.reserve(count);
+    _indices.reserve(count);
+}
+
+SceneNode SceneGraph::get_parent(SceneNode node) const
+{
+    const uint32_t parent = _parents[_indices[node]];
+    return parent == INVALID_INDEX ? INVALID_SCENE_NODE : _handles[parent];
+}
+
+bool SceneGraph::set_parent(SceneNode node, SceneNode parent)
+{
+    if (!IsValid(node) || (parent != INVALID_SCENE_NODE && !IsValid(parent))) return false;
+
+    const uint32_t index = _indices[node];
+    uint32_t parentIndex = INVALID_INDEX;
+    if (parent != INVALID_SCENE_NODE)
+    {
+        parentIndex = _indices[parent];
+        for (uint32_t a = parentIndex; a != INVALID_INDEX; a = _parents[a])
+            if (a == index) return false;
+    }
+
+    if (_parents[index] == parentIndex) return true;
+
+    _parents[index] = parentIndex;
+    _dirty[index] = 1;
+    _sorted = false;
+    return true;
+}
+
+Quaternion<float> SceneGraph::get_orientation(SceneNode node) const
+{
+    const uint32_t i = _indices[node];
+    return Quaternion<float>(_qx[i], _qy[i], _qz[i], _qw[i]);
+}
+
+void SceneGraph::set_position(SceneNode node, const Vector3<float> &position)
+{
+    _positions.Set(_indices[node], position);
+    MarkDirty(node);
+}
+
+void SceneGraph::set_orientation(SceneNode node, const Quaternion<float> &orientation)
+{
+    const uint32_t i = _indices[node];
+    const Quaternion<float> q = orientation.Normalized();
+    _qx[i] = q.x; _qy[i] = q.y; _qz[i] = q.z; _qw[i] = q.w;
+    MarkDirty(node);
+}
+
+void SceneGraph::set_scale(SceneNode node, const Vector3<float> &scale)
+{
+    _scales.Set(_indices[node], scale);
+    MarkDirty(node);
+}
+
+void SceneGraph::Translate(SceneNode node, float deltaX, float deltaY, float deltaZ)
+{
+    set_position(node, get_position(node) + Vector3<float>(deltaX, deltaY, deltaZ));
+}
+
+void SceneGraph::Rotate(SceneNode node, float thetaX, float thetaY, float thetaZ)
+{
+    set_orientation(node, get_orientation(node) * Quaternion<float>::FromEuler({ thetaX, thetaY, thetaZ }));
+}
+
+void SceneGraph::Update(ThreadPool* pool)
+{
+    _lastUpdate = SceneUpdateStats();
+    _lastUpdate.relayout = !_sorted || _holes;
+    if (_lastUpdate.relayout) Relayout();
+
+    // Parents come first, so the first dirty node found is the top of a dirty subtree: the whole range gets
+    // recomputed and the scan resumes after it
+    _dirtySpans.clear();
+    const size_t count = _dirty.size();
+    for (size_t i = 0; i < count; )
+    {
+        const uint8_t* next = (const uint8_t*)memchr(_dirty.data() + i, 1, count - i);
+        if (!next) break;
+
+        i = next - _dirty.data();
+        const size_t end = i + _subtreeSizes[i];
+        _dirtySpans.push_back({ (uint32_t)i, (uint32_t)end });
+
+        _lastUpdate.updated += end - i;
+        _lastUpdate.subtrees++;
+        i = end;
+    }
+    _lastUpdate.nodes = _alive;
+
+    if (!pool || _lastUpdate.updated <= SCENE_TASK_SIZE)
+    {
+        for (const Span &span : _dirtySpans) UpdateRange(span.first, span.end);
+        return;
+    }
+
+    // Small subtrees are batched up to the task size, big ones split themselves further
+    vector<size_t> tasks;
+    size_t taskNodes = 0;
+    for (size_t s = 0; s < _dirtySpans.size(); s++)
+    {
+        if (taskNodes == 0) tasks.push_back(s);
+        taskNodes += _dirtySpans[s].end - _dirtySpans[s].first;
+        if (taskNodes >= SCENE_TASK_SIZE) taskNodes = 0;
+    }
+    tasks.push_back(_dirtySpans.size());
+
+    pool->ParallelFor(tasks.size() - 1, [&](size_t t) {
+        for (size_t s = tasks[t]; s < tasks[t + 1]; s++) UpdateSpan(_dirtySpans[s], pool);
+    });
+}
+
+// Re-sorts depth first (roots and siblings keep their relative order) and squeezes out removed nodes.
+void SceneGraph::Relayout()
+{
+    const uint32_t count = (uint32_t)_handles.size();
+
+    // Children of every node, by counting sort on the parent
+    vector<uint32_t> childStart(count + 1, 0), children(count);
+    for (uint32_t i = 0; i < count; i++)
+        if (_handles[i] != INVALID_SCENE_NODE && _parents[i] != INVALID_INDEX) childStart[_parents[i] + 1]++;
+    for (uint32_t i = 0; i < count; i++) childStart[i + 1] += childStart[i];
+
+    vector<uint32_t> next(childStart.begin(), childStart.end() - 1);
+    for (uint32_t i = 0; i < count; i++)
+        if (_handles[i] != INVALID_SCENE_NODE && _parents[i] != INVALID_INDEX) children[next[_parents[i]]++] = i;
+
+    vector<uint32_t> order, stack;
+    order.reserve(_alive);
+    for (uint32_t root = 0; root < count; root++)
+    {
+        if (_handles[root] == INVALID_SCENE_NODE || _parents[root] != INVALID_INDEX) continue;
+
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            const uint32_t i = stack.back();
+            stack.pop_back();
+            order.push_back(i);
+
+            for (uint32_t c = childStart[i + 1]; c > childStart[i]; c--) stack.push_back(children[c - 1]);
+        }
+    }
+
+    vector<uint32_t> newIndex(count, INVALID_INDEX);
+    for (uint32_t i = 0; i < (uint32_t)order.size(); i++) newIndex[order[i]] = i;
+
+    Permute(_positions, order);
+    Permute(_scales, order);
+    Permute(_qx, order); Permute(_qy, order); Permute(_qz, order); Permute(_qw, order);
+    Permute(_dirty, order);
+    Permute(_world, order);
+    Permute(_handles, order);
+
+    Permute(_parents, order);
+    for (uint32_t &parent : _parents)
+        if (parent != INVALID_INDEX) parent = newIndex[parent];
+
+    // Children always come after their parent, so a backwards sweep has every subtree summed in time
+    _subtreeSizes.assign(order.size(), 1);
+    for (size_t i = order.size(); i-- > 0; )
+        if (_parents[i] != INVALID_INDEX) _subtreeSizes[_parents[i]] += _subtreeSizes[i];
+
+    for (uint32_t i = 0; i < (uint32_t)_handles.size(); i++) _indices[_handles[i]] = i;
+
+    _sorted = true;
+    _holes = false;
+}
+
+void SceneGraph::UpdateSpan(Span span, ThreadPool* pool)
+{
+    while (span.end - span.first > SCENE_TASK_SIZE)
+    {
+        // Subtrees under the task size are grouped into runs of neighbours, a bigger one has its root
+        // done here and its children's subtrees become a span of their own
+        vector<Span> parts;
+        uint32_t run = span.first;
+        for (uint32_t i = span.first; i < span.end; i += _subtreeSizes[i])
+        {
+            const uint32_t size = _subtreeSizes[i];
+            if (size <= SCENE_TASK_SIZE)
+            {
+                if (i > run && i + size - run > SCENE_TASK_SIZE)
+                {
+                    parts.push_back({ run, i });
+                    run = i;
+                }
+                continue;
+            }
+
+            if (i > run) parts.push_back({ run, i });
+            UpdateRange(i, i + 1);
+            parts.push_back({ i + 1, i + size });
+            run = i + size;
+        }
+        if (span.end > run) parts.push_back({ run, span.end });
+
+        // A long chain only ever has one part, keep walking it here instead of recursing
+        if (parts.size() == 1)
+        {
+            span = parts[0];
+            continue;
+        }
+
+        pool->ParallelFor(parts.size(), [&](size_t p) { UpdateSpan(parts[p], pool); });
+        return;
+    }
+
+    UpdateRange(span.first, span.end);
+}
+
+void SceneGraph::UpdateRange(size_t first, size_t end)
+{
+    const float* px = _positions.get_x(); const float* py = _positions.get_y(); const float* pz = _positions.get_z();
+    const float* sx = _scales.get_x(); const float* sy = _scales.get_y(); const float* sz = _scales.get_z();
+
+    for (size_t i = first; i < end; i++)
+    {
+        // Same as Transform::RefreshLocalToWorld()
+        const Matrix4x4<float> rotation = Quaternion<float>(_qx[i], _qy[i], _qz[i], _qw[i]).ToMatrix();
+        const float scale[3] = { sx[i], sy[i], sz[i] };
+
+        Matrix4x4<float> local;
+        for (int r = 0; r < 3; r++)
+        {
+            local[r][0] = rotation[r][0] * scale[r];
+            local[r][1] = rotation[r][1] * scale[r];
+            local[r][2] = rotation[r][2] * scale[r];
+            local[r][3] = 0;
+        }
+        local[3][0] = px[i];
+        local[3][1] = py[i];
+        local[3][2] = pz[i];
+        local[3][3] = 1;
+
+        const uint32_t parent = _parents[i];
+        _world[i] = parent == INVALID_INDEX ? local : Matrix4x4<float>::Multiply(local, _world[parent]);
+    }
+
+    memset(_dirty.data() + first, 0, end - first);
+}
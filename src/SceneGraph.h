@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "modules/LinearAlgebra.h"
+#include "modules/Vector3Stream.h"
+#include "modules/ThreadPool.h"
+
+typedef uint32_t SceneNode;
+
+#define INVALID_SCENE_NODE ((SceneNode)-1)
+
+#define SCENE_TASK_SIZE 4096        // Nodes, Update() doesn't split work any finer across the pool
+
+struct SceneUpdateStats
+{
+    size_t nodes;       // Alive after the update
+    size_t updated;     // World matrices recomputed
+    size_t subtrees;    // Dirty subtrees they came from
+    bool relayout;      // Storage had to be re-sorted first (nodes reparented, removed, or added out of order)
+};
+
+// Parented TRS nodes with flat storage: local position, orientation and scale, parent indices and world
+// matrices sit in contiguous (SoA) arrays kept in depth first order, so every parent comes before its
+// children and every subtree is one contiguous range. Update() scans the dirty flags and recomputes each
+// dirty subtree front to back in a single linear pass, parents are always done by the time a child reads
+// them.
+//
+// Nodes are addressed by stable handles, the dense index behind one changes whenever the storage is
+// re-sorted. Adding a root, or a child to the subtree at the end of the storage (building depth first),
+// keeps the order; anything else re-sorts once, on the next Update().
+//
+// Matrices follow Transform: row vectors, world = local * parent world, and a root's world matrix is bit
+// for bit the LocalToWorld() of a Transform with the same TRS.
+class SceneGraph
+{
+    public:
+        SceneNode Add(SceneNode parent = INVALID_SCENE_NODE, const Vector3<float> &position = Vector3<float>(0, 0, 0),
+                      const Quaternion<float> &orientation = Quaternion<float>(), const Vector3<float> &scale = Vector3<float>(1, 1, 1));
+        // Also removes the whole subtree under 'node'.
+        void Remove(SceneNode node);
+        void Clear();
+        void Reserve(size_t count);
+
+        inline bool IsValid(SceneNode node) const { return node < _indices.size() && _indices[node] != INVALID_INDEX; }
+        inline size_t size() const { return _alive; }
+
+        SceneNode get_parent(SceneNode node) const;
+        // Keeps the local TRS, so the node moves with its new parent. False (and nothing changes) when
+        // 'parent' is 'node' or one of its descendants.
+        bool set_parent(SceneNode node, SceneNode parent);
+
+        inline Vector3<float> get_position(SceneNode node) const { return _positions.Get(_indices[node]); }
+        inline Vector3<float> get_scale(SceneNode node) const { return _scales.Get(_indices[node]); }
+        Quaternion<float> get_orientation(SceneNode node) const;
+
+        void set_position(SceneNode node, const Vector3<float> &position);
+        void set_orientation(SceneNode node, const Quaternion<float> &orientation);
+        void set_scale(SceneNode node, const Vector3<float> &scale);
+
+        void Translate(SceneNode node, float deltaX, float deltaY, float deltaZ);
+        // Degrees, around the local axes (x, then y, then z) on top of the current orientation, like Transform.
+        void Rotate(SceneNode node, float thetaX, float thetaY, float thetaZ);
+
+        // With a pool the dirty subtrees are spread across it, and the ones bigger than SCENE_TASK_SIZE are
+        // split further: their root is done first, then their children's subtrees are independent ranges.
+        void Update(ThreadPool* pool = nullptr);
+
+        // As of the last Update().
+        inline const Matrix4x4<float>& WorldMatrix(SceneNode node) const { return _world[_indices[node]]; }
+
+        inline const SceneUpdateStats& get_lastUpdate() const { return _lastUpdate; }
+
+    private:
+        typedef Vector3Stream<float>::Array Array;
+        typedef std::vector<Matrix4x4<float>, AlignedAllocator<Matrix4x4<float>, VECTOR3_STREAM_ALIGNMENT>> MatrixArray;
+
+        static constexpr uint32_t INVALID_INDEX = (uint32_t)-1;
+
+        // Consecutive whole subtrees whose parents are already up to date
+        struct Span
+        {
+            uint32_t first, end;
+        };
+
+        // Dense, in depth first order
+        Vector3Stream<float> _positions, _scales;
+        Array _qx, _qy, _qz, _qw;
+        std::vector<uint32_t> _parents;         // INVALID_INDEX for roots
+        std::vector<uint32_t> _subtreeSizes;    // Node included
+        std::vector<uint8_t> _dirty;            // Local TRS changed since the last Update()
+        MatrixArray _world;
+        std::vector<SceneNode> _handles;        // INVALID_SCENE_NODE for removed nodes not compacted yet
+
+        std::vector<uint32_t> _indices;         // Handle -> dense index
+        std::vector<SceneNode> _freeHandles;
+
+        size_t _alive = 0;
+        bool _sorted = true;                    // Subtree sizes valid, every subtree contiguous
+        bool _holes = false;                    // Removed nodes still taking room
+
+        SceneUpdateStats _lastUpdate = {};
+        std::vector<Span> _dirtySpans;          // Scratch for Update()
+
+        inline void MarkDirty(SceneNode node) { _dirty[_indices[node]] = 1; }
+
+        void Relayout();
+        void UpdateSpan(Span span, ThreadPool* pool);
+        void UpdateRange(size_t first, size_t end);
+};
@@ -0,0 +1,162 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <iostream>
+
+#include "GLDebug.h"
+#include "modules/AssetPackage.h"
+#include "modules/MipMaps.h"
+#include "modules/3rd_party/stb/stb_image.h"
+
+
+using namespace std;
+
+TextureAtlas::TextureAtlas(int size, int padding) : _size(size), _padding(padding)
+{
+    // Every level down to the padding running out, and the packer keeps rects aligned to the last one
+    _mipLevels = 1;
+    while ((1 << _mipLevels) <= _padding) _mipLevels++;
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    if (_glID) glDeleteTextures(1, &_glID);
+}
+
+bool TextureAtlas::Build(const vector<string> &paths, ThreadPool* pool)
+{
+    struct Source
+    {
+        int width = 0, height = 0;
+        unsigned char* pixels = nullptr;
+    };
+
+    _entries.assign(paths.size(), AtlasEntry());
+    vector<Source> sources(paths.size());
+
+    auto decode = [&](size_t i)
+    {
+        _entries[i].path = assets::NormalizePath(paths[i].c_str());
+
+        assets::Span file;
+        vector<unsigned char> storage;
+        if (!assets::ReadAsset(paths[i].c_str(), &file, &storage)) return;
+
+        int comp;
+        stbi_set_flip_vertically_on_load_thread(1);
+        sources[i].pixels = stbi_load_from_memory(file.data, (int)file.size, &sources[i].width, &sources[i].height, &comp, STBI_rgb_alpha);
+    };
+
+    if (pool) pool->ParallelFor(paths.size(), decode);
+    else for (size_t i = 0; i < paths.size(); i++) decode(i);
+
+    // Tallest first keeps the skyline flat
+    vector<size_t> order(paths.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sources[a].height > sources[b].height; });
+
+    images::SkylinePacker packer(_size, _size, 1 << (_mipLevels - 1));
+    vector<unsigned char> pixels((size_t)_size * _size * 4, 0);
+
+    const float texel = 1.0f / _size;
+    bool allPacked = true;
+    for (size_t i : order)
+    {
+        const Source &source = sources[i];
+        AtlasEntry &entry = _entries[i];
+
+        if (!source.pixels)
+        {
+            cout << "[Atlas] Failed to load image (.\\" << paths[i] << ")." << endl;
+            allPacked = false;
+            continue;
+        }
+
+        int x, y;
+        if (!packer.Insert(source.width + 2 * _padding, source.height + 2 * _padding, &x, &y))
+        {
+            cout << "[Atlas] Image doesn't fit in the atlas (.\\" << paths[i] << ")." << endl;
+            allPacked = false;
+            continue;
+        }
+
+        entry.x = x + _padding;
+        entry.y = y + _padding;
+        entry.width = source.width;
+        entry.height = source.height;
+        entry.uOffset = entry.x * texel;
+        entry.vOffset = entry.y * texel;
+        entry.uScale = entry.width * texel;
+        entry.vScale = entry.height * texel;
+        entry.packed = true;
+
+        // Copy with the border replicated into the padding
+        for (int row = -_padding; row < source.height + _padding; row++)
+        {
+            const int srcRow = min(max(row, 0), source.height - 1);
+            const unsigned char* src = source.pixels + (size_t)srcRow * source.width * 4;
+            unsigned char* dst = pixels.data() + ((size_t)(entry.y + row) * _size + entry.x) * 4;
+
+            for (int column = -_padding; column < 0; column++) memcpy(dst + column * 4, src, 4);
+            memcpy(dst, src, (size_t)source.width * 4);
+            for (int column = 0; column < _padding; column++) memcpy(dst + (source.width + column) * 4, src + (source.width - 1) * 4, 4);
+        }
+    }
+
+    for (Source &source : sources)
+        if (source.pixels) stbi_image_free(source.pixels);
+
+    // Without padding there's nothing past level 0, and a limit of 0 would ask for the whole chain
+    images::MipChain mips;
+    if (_mipLevels > 1) images::BuildMipChain(pixels.data(), _size, _size, &mips, _mipLevels - 1);
+
+    if (!_glID) glGenTextures(1, &_glID);
+    GLCheck(glBindTexture(GL_TEXTURE_2D, _glID));
+
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _mipLevels - 1));
+
+    GLCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    GLCheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _size, _size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()));
+    for (size_t level = 0; level < mips.levels.size(); level++)
+    {
+        const images::MipLevel &mip = mips.levels[level];
+        GLCheck(glTexImage2D(GL_TEXTURE_2D, (int)level + 1, GL_RGBA8, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, mips.pixels.data() + mip.offset));
+    }
+
+    return allPacked;
+}
+
+int TextureAtlas::Find(const char* path) const
+{
+    const string normalized = assets::NormalizePath(path);
+    for (size_t i = 0; i < _entries.size(); i++)
+        if (_entries[i].packed && _entries[i].path == normalized) return (int)i;
+
+    return -1;
+}
+
+void TextureAtlas::RemapUVs(int entry, float* verts, size_t vertexCount, int stride, int uvOffset) const
+{
+    if (entry < 0 || entry >= (int)_entries.size() || !_entries[entry].packed) return;
+
+    const AtlasEntry &rect = _entries[entry];
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        float* uv = verts + i * stride + uvOffset;
+        uv[0] = rect.uOffset + min(max(uv[0], 0.0f), 1.0f) * rect.uScale;
+        uv[1] = rect.vOffset + min(max(uv[1], 0.0f), 1.0f) * rect.vScale;
+    }
+}
+
+void TextureAtlas::Bind(unsigned short slot) const
+{
+    GLCheck(glActiveTexture(GL_TEXTURE0 + slot));
+    GLCheck(glBindTexture(GL_TEXTURE_2D, _glID));
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "modules/ThreadPool.h"
+#include "modules/AtlasPacker.h"
+
+#define ATLAS_SIZE 2048
+#define ATLAS_PADDING 8
+
+struct AtlasEntry
+{
+    std::string path;
+    int x = 0, y = 0, width = 0, height = 0; // Texels, padding excluded
+    float uOffset = 0, vOffset = 0, uScale = 1, vScale = 1;
+    bool packed = false;
+};
+
+// Packs many small images into a single mip mapped RGBA8 texture, so every mesh using one of them can
+// share one bind (and one draw). Each image is surrounded by 'padding' texels of its own edge, which keeps
+// the first log2(padding) mip levels from bleeding into the neighbours, the chain stops there.
+class TextureAtlas
+{
+    public:
+        TextureAtlas(int size = ATLAS_SIZE, int padding = ATLAS_PADDING);
+        ~TextureAtlas();
+
+        TextureAtlas(const TextureAtlas&) = delete;
+        TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+        // Decodes 'paths' (spread over 'pool' when given), packs them tallest first and uploads the atlas.
+        // Needs a current GL context. Images that don't fit are left unpacked and reported.
+        bool Build(const std::vector<std::string> &paths, ThreadPool* pool = nullptr);
+
+        inline unsigned int get_glID() const { return _glID; }
+        inline int get_size() const { return _size; }
+        inline int get_mipLevels() const { return _mipLevels; }
+        inline const std::vector<AtlasEntry>& get_entries() const { return _entries; }
+
+        int Find(const char* path) const;
+
+        // Moves the UVs of an interleaved vertex buffer (OBJLoader layout by default) into the entry rect.
+        // UVs are clamped to [0, 1] first, tiling textures can't live in an atlas.
+        void RemapUVs(int entry, float* verts, size_t vertexCount, int stride = 8, int uvOffset = 3) const;
+
+        void Bind(unsigned short slot = 0) const;
+
+    private:
+        unsigned int _glID = 0;
+        int _size, _padding, _mipLevels;
+
+        std::vector<AtlasEntry> _entries;
+};
@@ -0,0 +1,749 @@
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cstdio>
+#include <sys/stat.h>
+
+#include "GLDebug.h"
+#include "modules/AssetPackage.h"
+#include "modules/FileLoaders.h"
+#include "modules/3rd_party/stb/stb_image.h"
+
+
+using namespace std;
+
+static unsigned int GLBlockFormat(images::BlockFormat format)
+{
+    switch (format)
+    {
+        case images::BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case images::BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case images::BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
+TextureLoader::DecodedImage::~DecodedImage()
+{
+    if (pixels) stbi_image_free(pixels);
+}
+
+const unsigned char* TextureLoader::DecodedImage::LevelPixels(int level) const
+{
+    if (compressed) return blocks.blocks.data() + blocks.levels[level].offset;
+    return level == 0 ? pixels : mips.pixels.data() + mips.levels[level - 1].offset;
+}
+
+int TextureLoader::DecodedImage::LevelWidth(int level) const
+{
+    if (compressed) return blocks.levels[level].width;
+    return level == 0 ? width : mips.levels[level - 1].width;
+}
+
+int TextureLoader::DecodedImage::LevelHeight(int level) const
+{
+    if (compressed) return blocks.levels[level].height;
+    return level == 0 ? height : mips.levels[level - 1].height;
+}
+
+size_t TextureLoader::DecodedImage::TotalBytes() const
+{
+    if (compressed) return blocks.blocks.size();
+    return (size_t)width * height * 4 + mips.pixels.size();
+}
+
+TextureLoader::TextureLoader(unsigned int workers, TextureCompression compression, bool streaming) : _compression(compression), _streaming(streaming), _pool(workers)
+{
+    if (_compression == TextureCompression::Auto && !GLEW_EXT_texture_compression_s3tc)
+    {
+        cout << "[TextureLoader] S3TC not supported, textures stay uncompressed." << endl;
+        _compression = TextureCompression::None;
+    }
+    else if (_compression == TextureCompression::BC7 && !GLEW_ARB_texture_compression_bptc)
+    {
+        cout << "[TextureLoader] BPTC not supported, falling back to BC1/BC3." << endl;
+        _compression = GLEW_EXT_texture_compression_s3tc ? TextureCompression::Auto : TextureCompression::None;
+    }
+
+    // 2x2 grey checker shown while the real image is on its way
+    const unsigned char checker[16] = {
+        90, 90, 90, 255,    160, 160, 160, 255,
+        160, 160, 160, 255,  90, 90, 90, 255
+    };
+
+    GLCheck(glGenTextures(1, &_placeholder));
+    GLCheck(glBindTexture(GL_TEXTURE_2D, _placeholder));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    GLCheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, checker));
+
+    GLCheck(glGenBuffers(TEXTURE_PBO_COUNT, _pbos));
+}
+
+TextureLoader::~TextureLoader()
+{
+    _pool.Wait();
+
+    for (auto &texture : _textures)
+        if (texture.used && texture.alias == INVALID_TEXTURE && texture.glID) glDeleteTextures(1, &texture.glID);
+
+    if (_uploadingID && !_uploading->stream) glDeleteTextures(1, &_uploadingID);
+
+    glDeleteBuffers(TEXTURE_PBO_COUNT, _pbos);
+    glDeleteTextures(1, &_placeholder);
+}
+
+TextureHandle TextureLoader::Load(const char* path)
+{
+    const string canonical = assets::CanonicalPath(path);
+
+    auto cached = _byPath.find(canonical);
+    if (cached != _byPath.end())
+    {
+        _textures[cached->second].refs++;
+        return cached->second;
+    }
+
+    TextureHandle handle;
+    if (!_freeSlots.empty())
+    {
+        handle = _freeSlots.back();
+        _freeSlots.pop_back();
+    }
+    else
+    {
+        handle = (TextureHandle)_textures.size();
+        _textures.emplace_back();
+    }
+
+    TextureSlot &slot = _textures[handle];
+    slot.path = canonical;
+    slot.refs = 1;
+    slot.used = true;
+    slot.loading = true;
+
+    _byPath[canonical] = handle;
+    _pending++;
+
+    const uint32_t generation = slot.generation;
+    string p(path);
+    _pool.Submit([this, handle, generation, p] { Decode(handle, generation, p); });
+
+    return handle;
+}
+
+void TextureLoader::Release(TextureHandle handle)
+{
+    if (handle >= _textures.size() || !_textures[handle].used || _textures[handle].refs == 0) return;
+
+    TextureSlot &slot = _textures[handle];
+    if (--slot.refs > 0) return;
+
+    slot.lastRelease = ++_releaseClock;
+    Evict();
+}
+
+void TextureLoader::set_memoryBudget(size_t bytes)
+{
+    _memoryBudget = bytes;
+    Evict();
+}
+
+unsigned int TextureLoader::get_glID(TextureHandle handle) const
+{
+    if (handle >= _textures.size()) return _placeholder;
+
+    const TextureSlot &slot = _textures[handle];
+    if (slot.alias != INVALID_TEXTURE) return get_glID(slot.alias);
+
+    return slot.ready ? slot.glID : _placeholder;
+}
+
+bool TextureLoader::IsReady(TextureHandle handle) const
+{
+    if (handle >= _textures.size()) return false;
+
+    const TextureSlot &slot = _textures[handle];
+    return slot.alias != INVALID_TEXTURE ? IsReady(slot.alias) : slot.ready;
+}
+
+void TextureLoader::Bind(TextureHandle handle, unsigned short slot) const
+{
+    GLCheck(glActiveTexture(GL_TEXTURE0 + slot));
+    GLCheck(glBindTexture(GL_TEXTURE_2D, get_glID(handle)));
+}
+
+TextureLoader::TextureSlot& TextureLoader::Owner(TextureHandle handle)
+{
+    TextureSlot &slot = _textures[handle];
+    return slot.alias != INVALID_TEXTURE ? Owner(slot.alias) : slot;
+}
+
+void TextureLoader::RequestCoverage(TextureHandle handle, float pixels)
+{
+    if (handle >= _textures.size()) return;
+
+    const TextureSlot &slot = Owner(handle);
+    if (!slot.ready) return;
+
+    const float texels = (float)max(slot.width, slot.height);
+    RequestLevel(handle, pixels > 0 ? (int)floor(log2(texels / pixels)) : slot.levels - 1);
+}
+
+void TextureLoader::RequestLevel(TextureHandle handle, int level)
+{
+    if (handle >= _textures.size()) return;
+
+    TextureSlot &slot = Owner(handle);
+    if (!slot.ready) return;
+
+    level = min(max(level, 0), slot.levels - 1);
+    slot.requestedLevel = slot.requestedLevel < 0 ? level : min(slot.requestedLevel, level);
+}
+
+TextureStreamStats TextureLoader::get_streamStats() const
+{
+    TextureStreamStats stats = {};
+    stats.inFlight = _streamsInFlight;
+    stats.mipBias = _mipBias;
+    stats.residentBytes = _residentBytes;
+    stats.budget = _memoryBudget;
+
+    for (auto const &slot : _textures)
+    {
+        if (!slot.used || !slot.ready || slot.alias != INVALID_TEXTURE) continue;
+
+        stats.textures++;
+        stats.fullBytes += slot.streamable ? BytesFrom(slot, 0) : slot.bytes;
+
+        if (!slot.streamable) continue;
+
+        stats.streamed++;
+        if (slot.residentLevel > 0) stats.partial++;
+    }
+
+    return stats;
+}
+
+void TextureLoader::Decode(TextureHandle handle, uint32_t generation, const string &path)
+{
+    unique_ptr<DecodedImage> image(new DecodedImage);
+    image->handle = handle;
+
+    const bool cached = _compression != TextureCompression::None && LoadCache(path, image.get(), _streaming ? TEXTURE_STREAM_TAIL : 0);
+
+    assets::Span file;
+    vector<unsigned char> fileStorage;
+    if (!cached && assets::ReadAsset(path.c_str(), &file, &fileStorage))
+        image->contentHash = assets::HashBytes(file.data, file.size);
+
+    if (cached)
+    {
+        if (!ClaimContent(image.get(), generation)) image->blocks = images::CompressedImage();
+    }
+    else if (file.data && ClaimContent(image.get(), generation))
+    {
+        int comp;
+        stbi_set_flip_vertically_on_load_thread(1);
+        image->pixels = stbi_load_from_memory(file.data, (int)file.size, &image->width, &image->height, &comp, STBI_rgb_alpha);
+
+        if (image->pixels)
+        {
+            images::BuildMipChain(image->pixels, image->width, image->height, &image->mips);
+            if (_compression != TextureCompression::None) Compress(path, image.get());
+        }
+        else UnclaimContent(image.get());
+    }
+
+    lock_guard<mutex> lock(_decodedMutex);
+    _decoded.push_back(move(image));
+}
+
+// Finer levels of a resident texture, straight from its cache.
+void TextureLoader::DecodeLevels(TextureHandle handle, uint32_t generation, const string &path, int maxDimension)
+{
+    unique_ptr<DecodedImage> image(new DecodedImage);
+    image->handle = handle;
+    image->generation = generation;
+    image->stream = true;
+
+    if (!LoadCache(path, image.get(), maxDimension)) image->blocks = images::CompressedImage();
+
+    lock_guard<mutex> lock(_decodedMutex);
+    _decoded.push_back(move(image));
+}
+
+// First decode of a given content wins, any other texture with the same hash becomes an alias of it.
+bool TextureLoader::ClaimContent(DecodedImage* image, uint32_t generation)
+{
+    lock_guard<mutex> lock(_contentMutex);
+
+    auto claim = _byContent.find(image->contentHash);
+    if (claim != _byContent.end() && claim->second.handle != image->handle)
+    {
+        image->aliasOf = claim->second.handle;
+        image->aliasGeneration = claim->second.generation;
+        image->compressed = false;
+        return false;
+    }
+
+    _byContent[image->contentHash] = { image->handle, generation };
+    return true;
+}
+
+void TextureLoader::UnclaimContent(const DecodedImage* image)
+{
+    lock_guard<mutex> lock(_contentMutex);
+
+    auto claim = _byContent.find(image->contentHash);
+    if (claim != _byContent.end() && claim->second.handle == image->handle) _byContent.erase(claim);
+}
+
+// The cache is used when it's packaged, or when it's not older than the loose source image.
+bool TextureLoader::LoadCache(const string &path, DecodedImage* image, int maxDimension)
+{
+    const string cachePath = path + TEXTURE_CACHE_EXT;
+
+    struct stat source, cache;
+    if (stat(cachePath.c_str(), &cache) == 0 && stat(path.c_str(), &source) == 0 && cache.st_mtime < source.st_mtime)
+        return false;
+
+    if (!fLoaders::DDSLoader(cachePath.c_str(), &image->blocks, maxDimension)) return false;
+
+    const bool supported = _compression == TextureCompression::BC7 || image->blocks.format != images::BlockFormat::BC7;
+    if (!supported) return false;
+
+    image->compressed = true;
+    image->width = image->blocks.width;
+    image->height = image->blocks.height;
+    image->contentHash = image->blocks.sourceHash ? image->blocks.sourceHash : assets::HashBytes(image->blocks.blocks.data(), image->blocks.blocks.size());
+    return true;
+}
+
+void TextureLoader::Compress(const string &path, DecodedImage* image)
+{
+    images::BlockFormat format = images::BlockFormat::BC7;
+    if (_compression == TextureCompression::Auto)
+        format = images::HasAlpha(image->pixels, image->width, image->height) ? images::BlockFormat::BC3 : images::BlockFormat::BC1;
+
+    images::CompressImage(format, image->pixels, image->width, image->height, &image->mips, &image->blocks, &_pool);
+    image->blocks.sourceHash = image->contentHash;
+
+    // A packaged source can't have a loose cache next to it, its cache gets cooked into the package
+    assets::Span packaged;
+    if (!assets::AssetPackage::Default().Find(path.c_str(), &packaged))
+    {
+        const string cachePath = path + TEXTURE_CACHE_EXT;
+        if (!fLoaders::DDSWriter(cachePath.c_str(), image->blocks))
+        {
+            // Nothing half written left behind, the next load encodes again
+            remove(cachePath.c_str());
+            _cacheWriteFailures++;
+            cout << "[TextureLoader] Couldn't write the texture cache (.\\" << cachePath << ")." << endl;
+        }
+    }
+
+    // Only the blocks go to GL from here on
+    stbi_image_free(image->pixels);
+    image->pixels = nullptr;
+    image->mips = images::MipChain();
+    image->compressed = true;
+}
+
+void TextureLoader::Update(size_t uploadBudget)
+{
+    size_t uploaded = 0;
+
+    while (uploaded < uploadBudget)
+    {
+        if (!_uploading)
+        {
+            unique_ptr<DecodedImage> next;
+            {
+                lock_guard<mutex> lock(_decodedMutex);
+                if (_decoded.empty()) break;
+
+                next = move(_decoded.front());
+                _decoded.pop_front();
+            }
+
+            Resolve(move(next));
+            continue;
+        }
+
+        uploaded += UploadRows(uploadBudget - uploaded);
+    }
+
+    Stream();
+}
+
+void TextureLoader::Resolve(unique_ptr<DecodedImage> image)
+{
+    const TextureHandle handle = image->handle;
+    TextureSlot &slot = _textures[handle];
+
+    if (image->stream)
+    {
+        // Nothing finer than what's resident, or the cache went away
+        if (slot.generation != image->generation || !image->compressed || image->blocks.baseLevel >= slot.residentLevel)
+        {
+            _streamsInFlight--;
+            if (slot.generation != image->generation) return;
+
+            if (!image->compressed) slot.streamable = false;
+            slot.streaming = false;
+            return;
+        }
+
+        BeginUpload(move(image));
+        return;
+    }
+
+    slot.contentHash = image->contentHash;
+
+    if (image->aliasOf != INVALID_TEXTURE)
+    {
+        TextureSlot &owner = _textures[image->aliasOf];
+
+        // The owner got evicted while this one was in flight, decode it for real
+        if (!owner.used || owner.generation != image->aliasGeneration)
+        {
+            const uint32_t generation = slot.generation;
+            const string path = slot.path;
+            _pool.Submit([this, handle, generation, path] { Decode(handle, generation, path); });
+            return;
+        }
+
+        owner.refs++;
+        slot.alias = image->aliasOf;
+        slot.loading = false;
+        _pending--;
+
+        Evict();
+        return;
+    }
+
+    if (!image->IsValid())
+    {
+        cout << "[TextureLoader] Couldn't load the texture (.\\" << slot.path << ")." << endl;
+        slot.loading = false;
+        _pending--;
+
+        Evict();
+        return;
+    }
+
+    BeginUpload(move(image));
+}
+
+void TextureLoader::FreeSlot(TextureHandle handle)
+{
+    TextureSlot &slot = _textures[handle];
+
+    if (slot.alias != INVALID_TEXTURE)
+    {
+        TextureSlot &owner = _textures[slot.alias];
+        if (--owner.refs == 0) owner.lastRelease = ++_releaseClock;
+    }
+    else if (slot.glID)
+    {
+        glDeleteTextures(1, &slot.glID);
+        _residentBytes -= slot.bytes;
+    }
+
+    {
+        lock_guard<mutex> lock(_contentMutex);
+
+        auto claim = _byContent.find(slot.contentHash);
+        if (claim != _byContent.end() && claim->second.handle == handle && claim->second.generation == slot.generation)
+            _byContent.erase(claim);
+    }
+
+    auto path = _byPath.find(slot.path);
+    if (path != _byPath.end() && path->second == handle) _byPath.erase(path);
+
+    const uint32_t generation = slot.generation + 1;
+    slot = TextureSlot();
+    slot.generation = generation;
+
+    _freeSlots.push_back(handle);
+}
+
+void TextureLoader::Evict()
+{
+    // Unused aliases and failed loads hold no GL memory, they go right away
+    for (TextureHandle handle = 0; handle < _textures.size(); handle++)
+    {
+        const TextureSlot &slot = _textures[handle];
+        if (slot.used && slot.refs == 0 && !slot.loading && (slot.alias != INVALID_TEXTURE || !slot.ready)) FreeSlot(handle);
+    }
+
+    while (_residentBytes > _memoryBudget)
+    {
+        TextureHandle oldest = INVALID_TEXTURE;
+        for (TextureHandle handle = 0; handle < _textures.size(); handle++)
+        {
+            const TextureSlot &slot = _textures[handle];
+            if (!slot.used || slot.refs > 0 || !slot.ready || slot.alias != INVALID_TEXTURE || slot.streaming) continue;
+
+            if (oldest == INVALID_TEXTURE || slot.lastRelease < _textures[oldest].lastRelease) oldest = handle;
+        }
+
+        if (oldest == INVALID_TEXTURE) break; // Everything left is in use
+        FreeSlot(oldest);
+    }
+}
+
+void TextureLoader::BeginUpload(unique_ptr<DecodedImage> image)
+{
+    _uploading = move(image);
+    _uploadingFormat = _uploading->compressed ? GLBlockFormat(_uploading->blocks.format) : GL_RGBA8;
+    _uploadLevel = 0;
+    _uploadedRows = 0;
+
+    const int base = _uploading->BaseLevel();
+
+    // Only the levels above the resident ones, the texture keeps sampling those until the upload is done
+    if (_uploading->stream)
+    {
+        const TextureSlot &slot = _textures[_uploading->handle];
+        _uploadingID = slot.glID;
+        _uploadLevels = slot.residentLevel - base;
+
+        GLCheck(glBindTexture(GL_TEXTURE_2D, _uploadingID));
+        for (int level = 0; level < _uploadLevels; level++)
+        {
+            const int w = _uploading->LevelWidth(level), h = _uploading->LevelHeight(level);
+            GLCheck(glCompressedTexImage2D(GL_TEXTURE_2D, base + level, _uploadingFormat, w, h, 0, (int)_uploading->blocks.levels[level].size, nullptr));
+        }
+        return;
+    }
+
+    _uploadLevels = _uploading->LevelCount();
+
+    GLCheck(glGenTextures(1, &_uploadingID));
+    GLCheck(glBindTexture(GL_TEXTURE_2D, _uploadingID));
+
+    // Trilinear
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, base + _uploadLevels - 1));
+
+    for (int level = 0; level < _uploadLevels; level++)
+    {
+        const int w = _uploading->LevelWidth(level), h = _uploading->LevelHeight(level);
+
+        if (_uploading->compressed)
+        {
+            GLCheck(glCompressedTexImage2D(GL_TEXTURE_2D, base + level, _uploadingFormat, w, h, 0, (int)_uploading->blocks.levels[level].size, nullptr));
+        }
+        else
+        {
+            GLCheck(glTexImage2D(GL_TEXTURE_2D, base + level, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+        }
+    }
+}
+
+// Copies the next band of rows of the current level into a PBO of the ring and lets the driver pull it asynchronously.
+// Compressed levels move in whole block rows (4 texel rows each).
+size_t TextureLoader::UploadRows(size_t budget)
+{
+    const int width = _uploading->LevelWidth(_uploadLevel);
+    const int height = _uploading->LevelHeight(_uploadLevel);
+    const unsigned char* pixels = _uploading->LevelPixels(_uploadLevel);
+    const bool compressed = _uploading->compressed;
+    const int glLevel = _uploading->BaseLevel() + _uploadLevel;
+
+    const int rowUnit = compressed ? 4 : 1;
+    const size_t unitBytes = compressed ? (size_t)((width + 3) / 4) * images::BlockBytes(_uploading->blocks.format) : (size_t)width * 4;
+
+    const size_t maxUnits = max<size_t>(1, min(budget, (size_t)TEXTURE_PBO_SIZE) / unitBytes);
+    const size_t units = min(maxUnits, (size_t)(height - _uploadedRows + rowUnit - 1) / rowUnit);
+    const int rows = min((int)units * rowUnit, height - _uploadedRows);
+    const size_t bytes = units * unitBytes;
+    const unsigned char* src = pixels + (_uploadedRows / rowUnit) * unitBytes;
+
+    GLCheck(glBindTexture(GL_TEXTURE_2D, _uploadingID));
+    GLCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbos[_nextPbo]));
+
+    // Orphan the previous storage so we never wait on a transfer still in flight
+    GLCheck(glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW));
+    void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (dst)
+    {
+        memcpy(dst, src, bytes);
+        GLCheck(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+        src = nullptr; // Offset 0 into the bound PBO
+    }
+    else
+    {
+        GLCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    }
+
+    if (compressed)
+    {
+        GLCheck(glCompressedTexSubImage2D(GL_TEXTURE_2D, glLevel, 0, _uploadedRows, width, rows, _uploadingFormat, (int)bytes, src));
+    }
+    else
+    {
+        GLCheck(glTexSubImage2D(GL_TEXTURE_2D, glLevel, 0, _uploadedRows, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, src));
+    }
+
+    GLCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    _nextPbo = (_nextPbo + 1) % TEXTURE_PBO_COUNT;
+    _uploadedRows += rows;
+
+    if (_uploadedRows == height)
+    {
+        _uploadLevel++;
+        _uploadedRows = 0;
+    }
+
+    if (_uploadLevel == _uploadLevels)
+    {
+        TextureSlot &slot = _textures[_uploading->handle];
+
+        if (_uploading->stream)
+        {
+            size_t added = 0;
+            for (int level = 0; level < _uploadLevels; level++) added += _uploading->blocks.levels[level].size;
+
+            slot.residentLevel = _uploading->BaseLevel();
+            slot.bytes += added;
+            slot.streaming = false;
+
+            GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, slot.residentLevel));
+
+            _residentBytes += added;
+            _streamsInFlight--;
+        }
+        else
+        {
+            slot.glID = _uploadingID;
+            slot.bytes = _uploading->TotalBytes();
+            slot.ready = true;
+            slot.loading = false;
+
+            slot.width = _uploading->width;
+            slot.height = _uploading->height;
+            slot.levels = _uploading->BaseLevel() + _uploading->LevelCount();
+            slot.format = _uploadingFormat;
+            slot.blockFormat = _uploading->blocks.format;
+            slot.residentLevel = _uploading->BaseLevel();
+            slot.streamable = _streaming && _uploading->compressed;
+
+            slot.tailLevel = slot.levels - 1;
+            while (slot.tailLevel > 0 && max(slot.width >> (slot.tailLevel - 1), slot.height >> (slot.tailLevel - 1)) <= TEXTURE_STREAM_TAIL)
+                slot.tailLevel--;
+
+            _residentBytes += slot.bytes;
+            _pending--;
+        }
+
+        _uploadingID = 0;
+        _uploading.reset();
+
+        Evict();
+    }
+
+    return bytes;
+}
+
+size_t TextureLoader::LevelBytes(const TextureSlot &slot, int level) const
+{
+    return images::LevelBytes(slot.blockFormat, max(1, slot.width >> level), max(1, slot.height >> level));
+}
+
+size_t TextureLoader::BytesFrom(const TextureSlot &slot, int level) const
+{
+    size_t bytes = 0;
+    for (; level < slot.levels; level++) bytes += LevelBytes(slot, level);
+    return bytes;
+}
+
+// Turns this frame's requests into level loads and drops. Requests are coarsened by a bias common to every
+// texture until what they ask for fits the budget. Textures nobody asked for keep their levels until the
+// budget runs out, and requested ones only shed levels two at a time so a texture on the edge doesn't thrash.
+void TextureLoader::Stream()
+{
+    if (!_streaming) return;
+
+    size_t fixedBytes = 0;
+    _streamed.clear();
+    for (TextureHandle handle = 0; handle < _textures.size(); handle++)
+    {
+        const TextureSlot &slot = _textures[handle];
+        if (!slot.used || !slot.ready || slot.alias != INVALID_TEXTURE) continue;
+
+        if (slot.streamable) _streamed.push_back(handle);
+        else fixedBytes += slot.bytes;
+    }
+
+    auto target = [&](const TextureSlot &slot, int bias)
+    {
+        return slot.requestedLevel < 0 ? slot.tailLevel : min(slot.requestedLevel + bias, slot.tailLevel);
+    };
+
+    _mipBias = 0;
+    for (; _mipBias < 16; _mipBias++)
+    {
+        size_t bytes = fixedBytes;
+        for (TextureHandle handle : _streamed) bytes += BytesFrom(_textures[handle], target(_textures[handle], _mipBias));
+
+        if (bytes <= _memoryBudget) break;
+    }
+
+    for (TextureHandle handle : _streamed)
+    {
+        TextureSlot &slot = _textures[handle];
+        const int level = target(slot, _mipBias);
+        const bool requested = slot.requestedLevel >= 0;
+        slot.requestedLevel = -1;
+
+        if (slot.streaming) continue;
+
+        if (level < slot.residentLevel)
+        {
+            if (_streamsInFlight < TEXTURE_STREAM_JOBS) StreamIn(handle, level);
+        }
+        else if (level > slot.residentLevel && (_residentBytes > _memoryBudget || (requested && level >= slot.residentLevel + 2)))
+        {
+            DropLevels(slot, level);
+        }
+    }
+}
+
+void TextureLoader::StreamIn(TextureHandle handle, int level)
+{
+    TextureSlot &slot = _textures[handle];
+    slot.streaming = true;
+    _streamsInFlight++;
+
+    const int maxDimension = max(max(1, slot.width >> level), max(1, slot.height >> level));
+    const uint32_t generation = slot.generation;
+    const string path = slot.path;
+    _pool.Submit([this, handle, generation, path, maxDimension] { DecodeLevels(handle, generation, path, maxDimension); });
+}
+
+// Frees the storage of the levels finer than 'level', they're outside [BASE_LEVEL, MAX_LEVEL] from now on.
+void TextureLoader::DropLevels(TextureSlot &slot, int level)
+{
+    GLCheck(glBindTexture(GL_TEXTURE_2D, slot.glID));
+    GLCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level));
+
+    for (int drop = slot.residentLevel; drop < level; drop++)
+    {
+        GLCheck(glCompressedTexImage2D(GL_TEXTURE_2D, drop, slot.format, 0, 0, 0, 0, nullptr));
+
+        const size_t bytes = LevelBytes(slot, drop);
+        slot.bytes -= bytes;
+        _residentBytes -= bytes;
+    }
+
+    slot.residentLevel = level;
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+
+#include "modules/ThreadPool.h"
+#include "modules/MipMaps.h"
+#include "modules/BlockCompression.h"
+
+#define TEXTURE_PBO_COUNT 3
+#define TEXTURE_PBO_SIZE (4 * 1024 * 1024)
+
+#define TEXTURE_CACHE_EXT ".dds"
+#define TEXTURE_MEMORY_BUDGET (512ull * 1024 * 1024)
+
+#define TEXTURE_STREAM_TAIL 64 // Streamed textures always keep the levels no larger than this resident
+#define TEXTURE_STREAM_JOBS 4
+
+typedef unsigned int TextureHandle;
+
+#define INVALID_TEXTURE ((TextureHandle)-1)
+
+// Auto -> BC1 for opaque images, BC3 when they carry alpha.
+enum class TextureCompression { None, Auto, BC7 };
+
+struct TextureStreamStats
+{
+    int textures;       // Resident, aliases not counted
+    int streamed;       // Of those, with levels coming and going
+    int partial;        // Streamed textures missing their finest levels
+    int inFlight;       // Level loads on the workers or uploading
+
+    int mipBias;        // Extra levels dropped from every request to stay within the budget
+
+    size_t residentBytes;
+    size_t fullBytes;   // What the resident textures would take with every level
+    size_t budget;
+};
+
+// Decodes images (and builds their mip chain) on worker threads and streams them to GL through a ring of
+// pixel unpack buffers, uploading at most 'uploadBudget' bytes per Update() call. Until a texture is
+// complete its handle resolves to a placeholder, so callers can bind it right away.
+//
+// With compression enabled the first load encodes the chain and caches it next to the source
+// ("<path>.dds"), later loads read the cache and skip the PNG decode entirely.
+//
+// Compressed textures are streamed: they start with their mip tail only, and each frame the finest level
+// asked through RequestCoverage()/RequestLevel() is read from the cache on a worker and uploaded, while
+// levels nobody needs anymore are dropped. Requests are coarsened by a common bias to fit the budget.
+//
+// Load()/Release() are reference counted. Textures are shared by canonical path, and files with the same
+// content (hash) share a single decode and GL object. Released textures stay resident until the memory
+// budget is exceeded, then the least recently released ones are evicted.
+class TextureLoader
+{
+    public:
+        // Needs a current GL context.
+        TextureLoader(unsigned int workers = 0, TextureCompression compression = TextureCompression::Auto, bool streaming = true);
+        ~TextureLoader();
+
+        TextureLoader(const TextureLoader&) = delete;
+        TextureLoader& operator=(const TextureLoader&) = delete;
+
+        TextureHandle Load(const char* path);
+        void Release(TextureHandle handle);
+
+        // Called once per frame from the GL thread, after this frame's requests.
+        void Update(size_t uploadBudget = TEXTURE_PBO_SIZE);
+
+        // Finest level needed this frame to cover 'pixels' on screen, assuming the UVs span the texture once.
+        void RequestCoverage(TextureHandle handle, float pixels);
+        void RequestLevel(TextureHandle handle, int level);
+
+        unsigned int get_glID(TextureHandle handle) const;
+        inline unsigned int get_placeholder() const { return _placeholder; }
+        bool IsReady(TextureHandle handle) const;
+        inline size_t get_pending() const { return _pending; }
+        inline TextureCompression get_compression() const { return _compression; }
+
+        inline size_t get_residentBytes() const { return _residentBytes; }
+        inline size_t get_memoryBudget() const { return _memoryBudget; }
+        void set_memoryBudget(size_t bytes);
+
+        TextureStreamStats get_streamStats() const;
+
+        // Compressed textures whose cache couldn't be saved, they get encoded again on every load.
+        inline int get_cacheWriteFailures() const { return _cacheWriteFailures; }
+
+        void Bind(TextureHandle handle, unsigned short slot = 0) const;
+
+    private:
+        struct DecodedImage
+        {
+            TextureHandle handle = 0;
+            uint32_t generation = 0;
+            bool stream = false; // Finer levels for a texture that's already resident
+
+            TextureHandle aliasOf = INVALID_TEXTURE; // Same content as an already claimed texture, nothing decoded
+            uint32_t aliasGeneration = 0;
+            uint64_t contentHash = 0;
+
+            int width = 0, height = 0;
+            unsigned char* pixels = nullptr; // RGBA8, owned by stb_image
+            images::MipChain mips;
+
+            bool compressed = false;
+            images::CompressedImage blocks;
+
+            inline bool IsValid() const { return pixels || compressed || aliasOf != INVALID_TEXTURE; }
+            inline int LevelCount() const { return compressed ? (int)blocks.levels.size() : (int)mips.levels.size() + 1; }
+            inline int BaseLevel() const { return compressed ? blocks.baseLevel : 0; }
+
+            const unsigned char* LevelPixels(int level) const;
+            int LevelWidth(int level) const;
+            int LevelHeight(int level) const;
+            size_t TotalBytes() const;
+
+            ~DecodedImage();
+        };
+
+        struct TextureSlot
+        {
+            std::string path; // Canonical
+            uint64_t contentHash = 0;
+            unsigned int glID = 0;
+            size_t bytes = 0;
+
+            int width = 0, height = 0, levels = 0; // Of the full image
+            unsigned int format = 0;
+            images::BlockFormat blockFormat = images::BlockFormat::BC1;
+
+            int residentLevel = 0;   // Finest level on the GL side (its base level)
+            int tailLevel = 0;
+            int requestedLevel = -1; // This frame's request, -1 if none
+
+            int refs = 0;
+            uint64_t lastRelease = 0;
+            TextureHandle alias = INVALID_TEXTURE; // Holds a reference on the slot that owns the GL object
+
+            uint32_t generation = 0; // Bumped every time the slot is freed, so stale claims can be told apart
+
+            bool used = false;
+            bool loading = false;
+            bool ready = false;
+            bool streamable = false;
+            bool streaming = false;
+        };
+
+        struct ContentClaim
+        {
+            TextureHandle handle;
+            uint32_t generation;
+        };
+
+        TextureCompression _compression;
+        const bool _streaming;
+
+        unsigned int _placeholder = 0;
+        unsigned int _pbos[TEXTURE_PBO_COUNT] = {};
+        unsigned int _nextPbo = 0;
+
+        std::vector<TextureSlot> _textures;
+        std::vector<TextureHandle> _freeSlots;
+        std::unordered_map<std::string, TextureHandle> _byPath;
+        size_t _pending = 0;
+
+        size_t _residentBytes = 0;
+        size_t _memoryBudget = TEXTURE_MEMORY_BUDGET;
+        uint64_t _releaseClock = 0;
+
+        int _streamsInFlight = 0;
+        int _mipBias = 0;
+        std::vector<TextureHandle> _streamed; // Reused by Stream(), a settled frame doesn't allocate
+
+        std::atomic<int> _cacheWriteFailures { 0 };
+
+        std::mutex _contentMutex;
+        std::unordered_map<uint64_t, ContentClaim> _byContent; // Claimed by the decode workers
+
+        std::mutex _decodedMutex;
+        std::deque<std::unique_ptr<DecodedImage>> _decoded; // Oldest first
+
+        std::unique_ptr<DecodedImage> _uploading;
+        unsigned int _uploadingID = 0;
+        unsigned int _uploadingFormat = 0;
+        int _uploadLevel = 0;
+        int _uploadLevels = 0;
+        int _uploadedRows = 0;
+
+        ThreadPool _pool; // Declared last so it joins before anything the jobs touch is destroyed
+
+        void Decode(TextureHandle handle, uint32_t generation, const std::string &path);
+        void DecodeLevels(TextureHandle handle, uint32_t generation, const std::string &path, int maxDimension);
+        bool LoadCache(const std::string &path, DecodedImage* image, int maxDimension);
+        bool ClaimContent(DecodedImage* image, uint32_t generation);
+        void UnclaimContent(const DecodedImage* image);
+        void Compress(const std::string &path, DecodedImage* image);
+
+        void Resolve(std::unique_ptr<DecodedImage> image);
+        void FreeSlot(TextureHandle handle);
+        void Evict();
+
+        TextureSlot& Owner(TextureHandle handle);
+        size_t LevelBytes(const TextureSlot &slot, int level) const;
+        size_t BytesFrom(const TextureSlot &slot, int level) const;
+        void Stream();
+        void StreamIn(TextureHandle handle, int level);
+        void DropLevels(TextureSlot &slot, int level);
+
+        void BeginUpload(std::unique_ptr<DecodedImage> image);
+        size_t UploadRows(size_t budget);
+};
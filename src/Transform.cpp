@@ -1,34 +1,40 @@
 #include "Transform.h"
 
+#include <algorithm>
+#include <atomic>
+
 
 using namespace std;
 
+#if TRANSFORM_STATS
+    static atomic<uint64_t> localRebuilds(0), inverseRebuilds(0), localSkipped(0), inverseSkipped(0);
+#endif
+
 
 Transform::Transform() 
 {
     _scale = Vector3<float>(1, 1, 1); 
-    RefreshLocalMatrices(); 
 }
 
-Transform::Transform(Vector3<float> position, Vector3<float> rotation, Vector3<float> scale) : _position(position), _rotation(rotation), _scale(scale)  
+Transform::Transform(Vector3<float> position, Vector3<float> rotation, Vector3<float> scale) : _position(position), _scale(scale), _orientation(Quaternion<float>::FromEuler(rotation))
 { 
-    RefreshLocalMatrices(); 
 }
 
 Vector3<float> Transform::RotationMatrixToEuler(const Matrix4x4<float> &mat)
 {
     Vector3<float> euler;
 
-    euler.x = asinf(-mat[2][1]);
-    if (cosf(euler.x) > 1e-6)
+    // Inverse of RX * RY * RZ, the order set_rotation() composes in
+    euler.y = asinf(std::max(-1.0f, std::min(1.0f, -mat[0][2])));
+    if (cosf(euler.y) > 1e-6)
     {
-        euler.y = atan2f(mat[2][0], mat[2][2]);
-        euler.z = atan2f(mat[0][1], mat[1][1]);
+        euler.x = atan2f(mat[1][2], mat[2][2]);
+        euler.z = atan2f(mat[0][1], mat[0][0]);
     }
     else
     {
-        euler.y = 0.0f;
-        euler.z = atan2f(-mat[1][0], mat[0][0]);
+        euler.x = 0.0f;
+        euler.z = atan2f(-mat[1][0], mat[1][1]);
     }
 
     euler *= RAD2DEG;
@@ -39,19 +45,25 @@ Vector3<float> Transform::RotationMatrixToEuler(const Matrix4x4<float> &mat)
 void Transform::set_position(const Vector3<float> position)
 {
     this->_position = position;
-    RefreshLocalMatrices();
+    Invalidate();
 }
 
 void Transform::set_rotation(const Vector3<float> rotation)
 {
-    this->_rotation = rotation;
-    RefreshLocalMatrices();
+    _orientation = Quaternion<float>::FromEuler(rotation);
+    Invalidate();
+}
+
+void Transform::set_orientation(const Quaternion<float> orientation)
+{
+    _orientation = orientation.Normalized();
+    Invalidate();
 }
 
 void Transform::set_scale(const Vector3<float> scale)
 {
     this->_scale = scale;
-    RefreshLocalMatrices();
+    Invalidate();
 }
 
 
@@ -60,15 +72,14 @@ void Transform::Translate(float deltaX, float deltaY, float deltaZ)
     _position.x += deltaX;
     _position.y += deltaY;
     _position.z += deltaZ;
-    RefreshLocalMatrices();
+    Invalidate();
 }
 
 void Transform::Rotate(float thetaX, float thetaY, float thetaZ)
 {
-    _rotation.x += thetaX;
-    _rotation.y += thetaY;
-    _rotation.z += thetaZ;
-    RefreshLocalMatrices();
+    // Renormalized every step so continuous rotation doesn't drift off unit length
+    _orientation = (_orientation * Quaternion<float>::FromEuler({ thetaX, thetaY, thetaZ })).Normalized();
+    Invalidate();
 }
 
 void Transform::Scale(float scaleX, float scaleY, float scaleZ)
@@ -76,7 +87,7 @@ void Transform::Scale(float scaleX, float scaleY, float scaleZ)
     _scale.x *= scaleX;
     _scale.y *= scaleY;
     _scale.z *= scaleZ;
-    RefreshLocalMatrices();
+    Invalidate();
 }
 
 
@@ -86,7 +97,7 @@ Matrix4x4<float> Transform::LookAt(Vector3<float> to, Vector3<float> tmpY)
     zAxis.Normalize();
 
     tmpY.Normalize();
-    Vector3<float> xAxis = Vector3<float>::Cross(tmpY, zAxis);
+    Vector3<float> xAxis = Vector3<float>::Cross(tmpY, zAxis).Normalized();
     Vector3<float> yAxis = Vector3<float>::Cross(zAxis, xAxis);
 
     Matrix4x4<float> lookAtMatrix(
@@ -96,35 +107,79 @@ Matrix4x4<float> Transform::LookAt(Vector3<float> to, Vector3<float> tmpY)
         _position.x, _position.y, _position.z,  1
     );
 
-    set_rotation(RotationMatrixToEuler(lookAtMatrix));
+    set_orientation(Quaternion<float>::FromMatrix(lookAtMatrix));
 
     return lookAtMatrix;
 }
 
-void Transform::RefreshLocalMatrices()
+TransformStats Transform::get_stats()
 {
-    Matrix4x4<float> scaling(S_MATRIX(_scale.x, _scale.y, _scale.z));
-    _localToWorld = scaling;
+    TransformStats stats = {};
+    #if TRANSFORM_STATS
+        stats.localRebuilds = localRebuilds.load(memory_order_relaxed);
+        stats.inverseRebuilds = inverseRebuilds.load(memory_order_relaxed);
+        stats.localSkipped = localSkipped.load(memory_order_relaxed);
+        stats.inverseSkipped = inverseSkipped.load(memory_order_relaxed);
+    #endif
+    return stats;
+}
 
-    if (_rotation.x != 0)
-    {
-        Matrix4x4<float> rotX(RX_MATRIXf(_rotation.x * DEG2RAD));
-        _localToWorld *= rotX;
-    }
-    if (_rotation.y != 0)
-    {
-        Matrix4x4<float> rotY(RY_MATRIXf(_rotation.y * DEG2RAD));
-        _localToWorld *= rotY;
-    }
-    if (_rotation.z != 0)
+void Transform::ResetStats()
+{
+    #if TRANSFORM_STATS
+        localRebuilds = inverseRebuilds = localSkipped = inverseSkipped = 0;
+    #endif
+}
+
+// A matrix still dirty when it gets flagged again is a rebuild the eager version would have wasted
+void Transform::Invalidate()
+{
+    #if TRANSFORM_STATS
+        if (_localDirty) localSkipped.fetch_add(1, memory_order_relaxed);
+        if (_inverseDirty) inverseSkipped.fetch_add(1, memory_order_relaxed);
+    #endif
+
+    _localDirty = _inverseDirty = true;
+    _version++;
+}
+
+void Transform::RefreshLocalToWorld() const
+{
+    // Scale * Rotation, the scale just weights the rotation rows
+    const Matrix4x4<float> rotation = _orientation.ToMatrix();
+    const float scale[3] = { _scale.x, _scale.y, _scale.z };
+
+    for (int i = 0; i < 3; i++)
     {
-        Matrix4x4<float> rotZ(RZ_MATRIXf(_rotation.z * DEG2RAD));
-        _localToWorld *= rotZ;
+        _localToWorld[i][0] = rotation[i][0] * scale[i];
+        _localToWorld[i][1] = rotation[i][1] * scale[i];
+        _localToWorld[i][2] = rotation[i][2] * scale[i];
+        _localToWorld[i][3] = 0;
     }
 
     _localToWorld[3][0] = _position.x;
     _localToWorld[3][1] = _position.y;
     _localToWorld[3][2] = _position.z;
+    _localToWorld[3][3] = 1;
+
+    _localDirty = false;
 
-    _worldToLocal = _localToWorld.Inverted();
-}
\ No newline at end of file
+    #if TRANSFORM_STATS
+        localRebuilds.fetch_add(1, memory_order_relaxed);
+    #endif
+}
+
+void Transform::RefreshWorldToLocal() const
+{
+    const Matrix4x4<float> &localToWorld = LocalToWorld();
+
+    // TRS, so the closed forms apply, without scale the rotation just transposes back
+    const bool rigid = _scale.x == 1 && _scale.y == 1 && _scale.z == 1;
+    _worldToLocal = rigid ? localToWorld.InvertedRigid() : localToWorld.InvertedAffine();
+
+    _inverseDirty = false;
+
+    #if TRANSFORM_STATS
+        inverseRebuilds.fetch_add(1, memory_order_relaxed);
+    #endif
+}
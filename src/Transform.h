@@ -2,9 +2,26 @@
 
 #include <iostream>
 #include <iomanip>
+#include <cstdint>
 
 #include "modules/LinearAlgebra.h"
 
+// Counts matrix rebuilds, and the ones the dirty flags saved, across every Transform. Off by default, the
+// counters are atomics bumped on every edit and rebuild. The UI and LinearAlgebraBench builds opt in with
+// -DTRANSFORM_STATS=1, passed to Transform.cpp too or get_stats() stays at zero.
+#ifndef TRANSFORM_STATS
+    #define TRANSFORM_STATS 0
+#endif
+
+struct TransformStats
+{
+    uint64_t localRebuilds, inverseRebuilds;    // Matrices actually rebuilt
+    uint64_t localSkipped, inverseSkipped;      // Edits whose rebuild never ran: edited again, or never read, before
+};
+
+// Setters only store the new TRS and flag the matrices, LocalToWorld() and WorldToLocal() rebuild theirs
+// on first access. The rebuild happens inside the const getters, so a Transform that might be dirty must
+// not be read from several threads at once.
 class Transform
 {
     public:
@@ -13,38 +30,55 @@ class Transform
 
         static Vector3<float> RotationMatrixToEuler(const Matrix4x4<float> &mat);
 
-        Matrix4x4<float> LocalToWorld(bool transpose = false) { return transpose ? _localToWorld.Inverted() : _localToWorld; }
-        Matrix4x4<float> WorldToLocal(bool transpose = false) { return transpose ? _worldToLocal.Inverted() : _worldToLocal; }
+        inline const Matrix4x4<float>& LocalToWorld() const { if (_localDirty) RefreshLocalToWorld(); return _localToWorld; }
+        inline const Matrix4x4<float>& WorldToLocal() const { if (_inverseDirty) RefreshWorldToLocal(); return _worldToLocal; }
+
+        inline Matrix4x4<float> LocalToWorld(bool transpose) const { return transpose ? LocalToWorld().Transposed() : LocalToWorld(); }
+        inline Matrix4x4<float> WorldToLocal(bool transpose) const { return transpose ? WorldToLocal().Transposed() : WorldToLocal(); }
+
+        // Bumped by every edit, so dependents (the camera's frustum) can tell they're stale without comparing matrices.
+        inline uint32_t get_version() const { return _version; }
+
+        static TransformStats get_stats();
+        static void ResetStats();
 
         inline Vector3<float> get_position() const { return _position; }
-        inline Vector3<float> get_rotation() const { return _rotation; }
+        inline Vector3<float> get_rotation() const { return RotationMatrixToEuler(_orientation.ToMatrix()); }
+        inline Quaternion<float> get_orientation() const { return _orientation; }
         inline Vector3<float> get_scale() const { return _scale; }
 
         void set_position(const Vector3<float> position);
         void set_rotation(const Vector3<float> rotation);
+        void set_orientation(const Quaternion<float> orientation);
         void set_scale(const Vector3<float> scale);
 
         friend std::ostream& operator<<(std::ostream &s, const Transform &t) 
         {  
-            return std::cout << "Position | " << t._position  << "\n" 
-                             << "Rotation | " << t._rotation  << "\n" 
-                             << "Scale    | " << t._scale     << "\n" 
-                             << "\n"
-                             << "LocalToWorld" << "\n" 
-                             << t._localToWorld << std::endl; 
+            return s << "Position | " << t._position  << "\n" 
+                     << "Rotation | " << t.get_rotation() << "\n" 
+                     << "Scale    | " << t._scale     << "\n" 
+                     << "\n"
+                     << "LocalToWorld" << "\n" 
+                     << t.LocalToWorld() << std::endl; 
         }
 
         void Translate(float deltaX, float deltaY, float deltaZ);
+        // Degrees, around the local axes (x, then y, then z) on top of the current orientation.
         void Rotate(float thetaX, float thetaY, float thetaZ);
         void Scale(float scaleX, float scaleY, float scaleZ);
 
         Matrix4x4<float> LookAt(Vector3<float> to, Vector3<float> tmpY = Vector3<float>(0, 1, 0));
 
     private:
-        Matrix4x4<float> _localToWorld;
-        Matrix4x4<float> _worldToLocal;
+        mutable Matrix4x4<float> _localToWorld;
+        mutable Matrix4x4<float> _worldToLocal;
+        mutable bool _localDirty = true, _inverseDirty = true;
+        uint32_t _version = 0;
 
-        Vector3<float> _position, _rotation, _scale;
+        Vector3<float> _position, _scale;
+        Quaternion<float> _orientation;
 
-        void RefreshLocalMatrices();
+        void Invalidate();
+        void RefreshLocalToWorld() const;
+        void RefreshWorldToLocal() const;
 };
\ No newline at end of file
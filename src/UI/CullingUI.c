@@ -0,0 +1,22 @@
+static void CullingUI(struct nk_context *ctx, const InstanceDrawStats *instances, const InstanceStats *uploads, int meshVisible)
+{
+    if (nk_begin(ctx, "Culling", nk_rect(20, 20, 280, 185), NK_WINDOW_TITLE|NK_WINDOW_MINIMIZABLE|NK_WINDOW_BORDER))
+    {
+        const int objects = (int)(instances->visible + instances->culled) + 1;
+        const int visible = (int)instances->visible + meshVisible;
+        nk_size shown = (nk_size)visible;
+
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Visible %d / %d", visible, objects);
+        nk_progress(ctx, &shown, (nk_size)objects, NK_FIXED);
+
+        nk_layout_row_dynamic(ctx, 20, 2);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Culled %d", objects - visible);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Draw calls %d", (int)instances->drawCalls + meshVisible);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Instanced %d", (int)instances->drawn);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Uploaded %d", (int)uploads->uploaded);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Cull %.3f ms", instances->cullMs);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Submit %.3f ms", instances->drawMs);
+    }
+    nk_end(ctx);
+}
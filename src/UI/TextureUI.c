@@ -0,0 +1,23 @@
+static void TextureUI(struct nk_context *ctx, const TextureStreamStats *stats)
+{
+    const float MB = 1.0f / (1024 * 1024);
+
+    if (nk_begin(ctx, "Textures", nk_rect(800, 495, 280, 185), NK_WINDOW_TITLE|NK_WINDOW_MINIMIZABLE|NK_WINDOW_BORDER))
+    {
+        nk_size resident = (nk_size)(stats->residentBytes >> 10);
+        nk_size budget = (nk_size)(stats->budget >> 10);
+
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Resident %.1f / %.1f MB", stats->residentBytes * MB, stats->budget * MB);
+        nk_progress(ctx, &resident, budget, NK_FIXED);
+
+        nk_layout_row_dynamic(ctx, 20, 2);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Textures %d", stats->textures);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Streamed %d", stats->streamed);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Partial %d", stats->partial);
+        nk_labelf(ctx, NK_TEXT_LEFT, "In flight %d", stats->inFlight);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Mip bias %d", stats->mipBias);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Saved %.1f MB", (stats->fullBytes - stats->residentBytes) * MB);
+    }
+    nk_end(ctx);
+}
@@ -1,4 +1,4 @@
-static void TransformUI(struct nk_context *ctx)
+static void TransformUI(struct nk_context *ctx, const TransformStats *stats, const PickHit *pick, const Transform *picked, float pickMs)
 {
 
     float dragSpeed = 0.5f;
@@ -43,6 +43,14 @@ static void TransformUI(struct nk_context *ctx)
             nk_property_float(ctx, "#Speed ", 0, &speed, 500, 0.1f, 0.1f);
             nk_layout_row_end(ctx);
 
+            // Null unless built with TRANSFORM_STATS
+            if (stats)
+            {
+                nk_layout_row_dynamic(ctx, 20, 2);
+                nk_labelf(ctx, NK_TEXT_LEFT, "Rebuilt %llu / %llu", (unsigned long long)stats->localRebuilds, (unsigned long long)stats->inverseRebuilds);
+                nk_labelf(ctx, NK_TEXT_LEFT, "Skipped %llu / %llu", (unsigned long long)stats->localSkipped, (unsigned long long)stats->inverseSkipped);
+            }
+
             nk_layout_row_dynamic(ctx, 5, 1);
 
             nk_tree_pop(ctx);
@@ -68,6 +76,37 @@ static void TransformUI(struct nk_context *ctx)
             nk_layout_row_dynamic(ctx, 2, 1);
         }
 
+        if (nk_tree_push(ctx, NK_TREE_TAB, "Selection", NK_MAXIMIZED))
+        {
+            nk_layout_row_dynamic(ctx, 20, 2);
+            if (pick->Hit())
+            {
+                nk_labelf(ctx, NK_TEXT_LEFT, "Object %d", pick->object);
+                nk_labelf(ctx, NK_TEXT_LEFT, "Triangle %d", pick->triangle);
+                nk_labelf(ctx, NK_TEXT_LEFT, "UV %.3f %.3f", pick->u, pick->v);
+                nk_labelf(ctx, NK_TEXT_LEFT, "Distance %.3f", pick->distance);
+
+                nk_layout_row_dynamic(ctx, 20, 1);
+                nk_labelf(ctx, NK_TEXT_LEFT, "Hit  %.3f  %.3f  %.3f", pick->point.x, pick->point.y, pick->point.z);
+            }
+            else nk_label(ctx, "Nothing picked", NK_TEXT_LEFT);
+
+            if (picked)
+            {
+                const Vector3<float> position = picked->get_position(), rotation = picked->get_rotation(), scale = picked->get_scale();
+
+                nk_layout_row_dynamic(ctx, 20, 1);
+                nk_labelf(ctx, NK_TEXT_LEFT, "Position  %.2f  %.2f  %.2f", position.x, position.y, position.z);
+                nk_labelf(ctx, NK_TEXT_LEFT, "Rotation  %.2f  %.2f  %.2f", rotation.x, rotation.y, rotation.z);
+                nk_labelf(ctx, NK_TEXT_LEFT, "Scale     %.2f  %.2f  %.2f", scale.x, scale.y, scale.z);
+            }
+
+            nk_layout_row_dynamic(ctx, 20, 1);
+            nk_labelf(ctx, NK_TEXT_LEFT, "Pick time %.3f ms", pickMs);
+
+            nk_tree_pop(ctx);
+        }
+
         if (nk_tree_push(ctx, NK_TREE_TAB, "Shader", NK_MAXIMIZED))
         {
             static char path[64];
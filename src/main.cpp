@@ -1,5 +1,6 @@
 #include <iostream>
 #include <vector>
+#include <algorithm>
 
 #include <GL/glew.h>
 
@@ -30,47 +31,34 @@
 
 #define UI_MENUS
 
+#include "GLDebug.h"
+#include "Camera.h"
+#include "TextureLoader.h"
+#include "Picking.h"
+#include "SceneGraph.h"
+#include "InstanceBuffer.h"
+
 #ifdef UI_MENUS
     #include "UI/TransformUI.c"
+    #include "UI/TextureUI.c"
+    #include "UI/CullingUI.c"
 #endif
 
-#include "Camera.h"
-
 #include "modules/LinearAlgebra.h"
+#include "modules/Vector3Stream.h"
+#include "modules/BVH.h"
 #include "modules/FileLoaders.h"
+#include "modules/AssetPackage.h"
 
+#define ASSET_PACKAGE "assets.pak"
 
-using namespace std;
-
-static void FatalError(const string &msg)
-{
-    cout << "[FATAL ERROR] " << msg << "\n"
-         << "Press any key to exit... " << endl;
-
-    char s;
-    cin >> s ;
-
-    SDL_Quit();
-    exit(1);
-}
-
-#define GLCheck(x) GLClearErrors(); x; GLPrintErrors(__FILE__, #x, __LINE__);
+// Copies of the mesh around it, all drawn in one instanced call. 317 gives about 100k
+#define FOREST_SIDE 100
+#define FOREST_SPACING 4.0f
+#define FOREST_TILE 16          // Added tile by tile, so what the camera sees comes in few long runs
 
-static void GLClearErrors() { while (glGetError() != GL_NO_ERROR); }
 
-static void GLPrintErrors(const char* file, const char* func, int line)
-{
-    bool onError = false;
-
-    GLenum error;
-    while ((error = glGetError()) != GL_NO_ERROR)
-    {
-        cout << "[OPENGL ERROR] " << file << " - line: " << line << " " << func << " (Error code " << error << ")." << endl;
-        onError = true;
-    }
-
-    if (onError) FatalError("OpenGL error detected");
-}
+using namespace std;
 
 static void CompileShader(const char* src, unsigned int id)
 {
@@ -92,34 +80,55 @@ static void CompileShader(const char* src, unsigned int id)
     }
 }
 
-static unsigned int LoadTexture(const char* path, unsigned short slot = 0)
+static unsigned int CreateProgram(const char* vertexSrc, const char* fragmentSrc)
 {
-    stbi_set_flip_vertically_on_load(1);
-    int imgW, imgH, comp;
-    unsigned char* image = stbi_load(path, &imgW, &imgH, &comp, STBI_rgb_alpha);
-    cout << "\n" << imgW << "x" << imgH << "\n" << *image << endl;
+    unsigned int vertexID, fragmentID, glProgramID;
 
-    GLCheck(glActiveTexture(GL_TEXTURE0 + slot));
+    vertexID = glCreateShader(GL_VERTEX_SHADER);
+    CompileShader(vertexSrc, vertexID);
 
-    unsigned int texID = 0;
-    
-    GLCheck(glGenTextures(1, &texID));
-    GLCheck(glBindTexture(GL_TEXTURE_2D, texID));
+    fragmentID =glCreateShader(GL_FRAGMENT_SHADER);
+    CompileShader(fragmentSrc, fragmentID);
+
+    glProgramID = glCreateProgram();
+    GLCheck(glAttachShader(glProgramID, vertexID));
+    GLCheck(glAttachShader(glProgramID, fragmentID));
+    GLCheck(glLinkProgram(glProgramID));
+
+    int status;
+    GLCheck(glGetProgramiv(glProgramID, GL_LINK_STATUS, &status));
+    if (status == GL_FALSE)
+    {
+        int len;
+        GLCheck(glGetProgramiv(glProgramID, GL_INFO_LOG_LENGTH, &len));
+        
+        vector<char> log(len);
+        GLCheck(glGetProgramInfoLog(glProgramID, len, &len, &log[0]));
+
+        cout << "[PROGRAM INFO LOG]" << &log[0] << endl;
+
+        GLCheck(glDeleteProgram(glProgramID));
+        GLCheck(glDeleteShader(vertexID));
+        GLCheck(glDeleteShader(fragmentID));
+
+        FatalError("Program shader failed at stratup.");
+    }
     
-    GLCheck(glTextureParameteri(texID, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-    GLCheck(glTextureParameteri(texID, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-    GLCheck(glTextureParameteri(texID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-    GLCheck(glTextureParameteri(texID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GLCheck(glDetachShader(glProgramID, vertexID));
+    GLCheck(glDeleteShader(vertexID));
 
-    GLCheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, imgW, imgH, 0, GL_RGBA, GL_UNSIGNED_BYTE, image));
+    GLCheck(glDetachShader(glProgramID, fragmentID));
+    GLCheck(glDeleteShader(fragmentID));
 
-    stbi_image_free(image);
-    return texID;
+    return glProgramID;
 }
 
-
-int main()
+int main(int argc, char* argv[])
 {
+    // Cook mode: test.exe --pack <package> <files...>
+    if (argc > 2 && string(argv[1]) == "--pack")
+        return assets::AssetPackage::Write(argv[2], vector<string>(argv + 3, argv + argc)) ? 0 : 1;
+
     int width, height;
     SDL_Window* window;
     SDL_GLContext context;
@@ -158,10 +167,27 @@ int main()
     GLCheck(glClearColor(0.4, 0.1, 0.7, 1.0));
     GLCheck(glEnable(GL_DEPTH_TEST));
 
+    assets::AssetPackage::Default().Mount(ASSET_PACKAGE);
+
+    const char* meshPath = "objs/buso.obj";
     std::vector<float> v;
     std::vector<unsigned int> t;
     unsigned int numVerts, numTris;
-    fLoaders::OBJLoader("objs/buso.obj", &v, &t, &numVerts, &numTris);
+    fLoaders::OBJLoader(meshPath, &v, &t, &numVerts, &numTris);
+
+    // Ray casts (picking) against the mesh, cached next to it
+    BVH meshBVH;
+    meshBVH.LoadOrBuild(meshPath, v.data(), t.data(), numTris);
+
+    // Bounding sphere of the mesh, drives how much of its texture has to be resident
+    Vector3Stream<float> positions;
+    positions.Gather(v.data(), numVerts);
+
+    Vector3<float> boundsMin, boundsMax;
+    positions.MinMax(&boundsMin, &boundsMax);
+    const Vector3<float> boundsCenter = (boundsMin + boundsMax) * 0.5f;
+    const float boundsRadius = (boundsMax - boundsMin).Magnitud() * 0.5f;
+    const AABB<float> meshBounds(boundsMin, boundsMax);
 
     unsigned int vaoID = 0, vboID = 0, iboID = 0;
 
@@ -187,15 +213,35 @@ int main()
         layout (location=0) in vec3 position;
         layout (location=1) in vec2 uv;
 
-        uniform mat4 u_Model;
-        uniform mat4 u_View;
-        uniform mat4 u_Proj;
+        uniform mat4 u_MVP;
+
+        out vec2 v_UV;
+
+        void main()
+        {
+            gl_Position = u_MVP * vec4(position, 1.0);
+            v_UV = uv;
+        }
+    )glsl";
+
+    // Same, with the model matrix per instance (see InstanceBuffer)
+    const char* instancedVertexSrc = R"glsl(
+        #version 330
+        layout (location=0) in vec3 position;
+        layout (location=1) in vec2 uv;
+        layout (location=2) in vec4 i_Model0;
+        layout (location=3) in vec4 i_Model1;
+        layout (location=4) in vec4 i_Model2;
+
+        uniform mat4 u_ViewProjection;
 
         out vec2 v_UV;
 
         void main()
         {
-            gl_Position = u_Proj * u_View * u_Model * vec4(position, 1.0);
+            vec4 local = vec4(position, 1.0);
+            vec3 world = vec3(dot(local, i_Model0), dot(local, i_Model1), dot(local, i_Model2));
+            gl_Position = u_ViewProjection * vec4(world, 1.0);
             v_UV = uv;
         }
     )glsl";
@@ -216,43 +262,8 @@ int main()
         }
     )glsl";
 
-    unsigned int vertexID, fragmentID, glProgramID;
-
-    vertexID = glCreateShader(GL_VERTEX_SHADER);
-    CompileShader(vertexSrc, vertexID);
-
-    fragmentID =glCreateShader(GL_FRAGMENT_SHADER);
-    CompileShader(fragmentSrc, fragmentID);
-
-    glProgramID = glCreateProgram();
-    GLCheck(glAttachShader(glProgramID, vertexID));
-    GLCheck(glAttachShader(glProgramID, fragmentID));
-    GLCheck(glLinkProgram(glProgramID));
-
-    int status;
-    GLCheck(glGetProgramiv(glProgramID, GL_LINK_STATUS, &status));
-    if (status == GL_FALSE)
-    {
-        int len;
-        GLCheck(glGetProgramiv(glProgramID, GL_INFO_LOG_LENGTH, &len));
-        
-        vector<char> log(len);
-        GLCheck(glGetProgramInfoLog(glProgramID, len, &len, &log[0]));
-
-        cout << "[PROGRAM INFO LOG]" << &log[0] << endl;
-
-        GLCheck(glDeleteProgram(glProgramID));
-        GLCheck(glDeleteShader(vertexID));
-        GLCheck(glDeleteShader(fragmentID));
-
-        FatalError("Program shader failed at stratup.");
-    }
-    
-    GLCheck(glDetachShader(glProgramID, vertexID));
-    GLCheck(glDeleteShader(vertexID));
-
-    GLCheck(glDetachShader(glProgramID, fragmentID));
-    GLCheck(glDeleteShader(fragmentID));
+    const unsigned int glProgramID = CreateProgram(vertexSrc, fragmentSrc);
+    const unsigned int instancedProgramID = CreateProgram(instancedVertexSrc, fragmentSrc);
 
     GLCheck(glUseProgram(glProgramID));
 
@@ -264,21 +275,17 @@ int main()
 
     Transform transform;
 
+    Picking picking;
+    picking.Add(&meshBVH, &transform);
+    PickHit selection;
     
-    int modelLocation = glGetUniformLocation(glProgramID, "u_Model");
-    if (modelLocation == -1) cout << "No matching uniform" << endl;
-    glUniformMatrix4fv(modelLocation, 1, GL_FALSE, transform.LocalToWorld().toPtr());
-
-    int viewLocation = glGetUniformLocation(glProgramID, "u_View");
-    if (viewLocation == -1) cout << "No matching unifrom" << endl;
-    glUniformMatrix4fv(viewLocation, 1, GL_FALSE, cam.WorldToCamera().toPtr());
+    // Model * View * Projection fused on the CPU, one upload per draw instead of three matrices per vertex
+    int mvpLocation = glGetUniformLocation(glProgramID, "u_MVP");
+    if (mvpLocation == -1) cout << "No matching uniform" << endl;
 
-    int projLocation = glGetUniformLocation(glProgramID, "u_Proj");
-    if (projLocation == -1) cout << "No matching unifrom" << endl;
-    glUniformMatrix4fv(projLocation, 1, GL_FALSE, cam.ProjectionMatrix().toPtr());
 
-
-    unsigned int texID = LoadTexture("imgs/Buso_Diff.png");
+    TextureLoader textures;
+    TextureHandle diffuseTex = textures.Load("imgs/Buso_Diff.png");
 
     int colorLocation = glGetUniformLocation(glProgramID, "u_Color");
     if (colorLocation == -1) cout << "No matching uniform" << endl;
@@ -288,6 +295,59 @@ int main()
     if (diffLocation == -1) cout << "No matching uniform" << endl;
     GLCheck(glUniform1i(diffLocation, 0));
 
+    // Forest: the same vertices with the instance matrices on top, placed through a scene graph
+    unsigned int forestVaoID = 0;
+
+    GLCheck(glGenVertexArrays(1, &forestVaoID));
+    GLCheck(glBindVertexArray(forestVaoID));
+
+    GLCheck(glBindBuffer(GL_ARRAY_BUFFER, vboID));
+
+    GLCheck(glEnableVertexAttribArray(0));
+    GLCheck(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0));
+
+    GLCheck(glEnableVertexAttribArray(1));
+    GLCheck(glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (const void*)(3 * sizeof(float))));
+
+    GLCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID));
+
+    InstanceBuffer forestInstances;
+    forestInstances.Attach();
+    forestInstances.set_meshBounds(meshBounds);
+
+    SceneGraph forest;
+    vector<SceneNode> forestNodes;
+    vector<Instance> forestTrees;
+    forest.Reserve(FOREST_SIDE * FOREST_SIDE);
+    forestInstances.Reserve(FOREST_SIDE * FOREST_SIDE);
+    for (int tileZ = 0; tileZ < FOREST_SIDE; tileZ += FOREST_TILE)
+    {
+        for (int tileX = 0; tileX < FOREST_SIDE; tileX += FOREST_TILE)
+        {
+            for (int z = tileZ; z < min(tileZ + FOREST_TILE, FOREST_SIDE); z++)
+            {
+                for (int x = tileX; x < min(tileX + FOREST_TILE, FOREST_SIDE); x++)
+                {
+                    // The middle one is left to the picked mesh
+                    if (x == FOREST_SIDE / 2 && z == FOREST_SIDE / 2) continue;
+
+                    const Vector3<float> position((x - FOREST_SIDE / 2) * FOREST_SPACING, 0, (z - FOREST_SIDE / 2) * FOREST_SPACING);
+                    forestNodes.push_back(forest.Add(INVALID_SCENE_NODE, position, Quaternion<float>::FromEuler({ 0, float((x * 37 + z * 91) % 360), 0 })));
+                    forestTrees.push_back(forestInstances.Add(Matrix4x4<float>()));
+                }
+            }
+        }
+    }
+
+    GLCheck(glUseProgram(instancedProgramID));
+
+    int viewProjectionLocation = glGetUniformLocation(instancedProgramID, "u_ViewProjection");
+    if (viewProjectionLocation == -1) cout << "No matching uniform" << endl;
+
+    int instancedDiffLocation = glGetUniformLocation(instancedProgramID, "u_Diffuse");
+    if (instancedDiffLocation == -1) cout << "No matching uniform" << endl;
+    GLCheck(glUniform1i(instancedDiffLocation, 0));
+
 
     unsigned int lastTime = 0, currentTime = 0;
     float deltaTime = 0;
@@ -307,6 +367,11 @@ int main()
                 case SDL_QUIT:
                     running = false;
                     break;
+
+                case SDL_MOUSEBUTTONDOWN:
+                    if (event.button.button == SDL_BUTTON_LEFT && !nk_window_is_any_hovered(ctx))
+                        selection = picking.Pick(cam, (float)event.button.x, (float)event.button.y);
+                    break;
             }
             nk_sdl_handle_event(&event);
         }
@@ -318,16 +383,44 @@ int main()
         GLCheck(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
         GLCheck(glBindVertexArray(vaoID));
-        GLCheck(glGenBuffers(1, &iboID));
         GLCheck(glUseProgram(glProgramID));
-        GLCheck(glBindTexture(GL_TEXTURE_2D, texID));
-        GLCheck(glUniformMatrix4fv(modelLocation, 1, GL_FALSE, transform.LocalToWorld().toPtr()));
+        const Vector3<float> scale = transform.get_scale();
+        const Vector3<float> worldCenter = transform.get_position() + transform.LocalToWorld() * boundsCenter;
+        textures.RequestCoverage(diffuseTex, cam.ProjectedSize(worldCenter, boundsRadius * max(scale.x, max(scale.y, scale.z))));
+        textures.Update();
+        textures.Bind(diffuseTex, 0);
+        const Matrix4x4<float> mvp = Matrix4x4<float>::Chain(transform.LocalToWorld(), cam.WorldToCamera(), cam.ProjectionMatrix());
+        GLCheck(glUniformMatrix4fv(mvpLocation, 1, GL_FALSE, mvp.data()));
         GLCheck(glEnable(GL_DEPTH_TEST));
 
-        GLCheck(glDrawElements(GL_TRIANGLES, numTris * 3,  GL_UNSIGNED_INT, nullptr));
+        // The camera only rebuilds its planes after it moved or its lens changed
+        const Frustum<float> &frustum = cam.ViewFrustum();
+        const bool meshVisible = frustum.Classify(meshBounds.Transformed(transform.LocalToWorld())) != Containment::Outside;
+        if (meshVisible)
+        {
+            GLCheck(glDrawElements(GL_TRIANGLES, numTris * 3,  GL_UNSIGNED_INT, nullptr));
+        }
+
+        // Only matrices the scene graph actually changed get sent again
+        forest.Update();
+        if (forest.get_lastUpdate().updated > 0)
+            for (size_t i = 0; i < forestNodes.size(); i++) forestInstances.Set(forestTrees[i], forest.WorldMatrix(forestNodes[i]));
+        forestInstances.Upload();
+
+        GLCheck(glBindVertexArray(forestVaoID));
+        GLCheck(glUseProgram(instancedProgramID));
+        const Matrix4x4<float> viewProjection = Matrix4x4<float>::Chain(cam.WorldToCamera(), cam.ProjectionMatrix());
+        GLCheck(glUniformMatrix4fv(viewProjectionLocation, 1, GL_FALSE, viewProjection.data()));
+        forestInstances.Draw(numTris * 3, frustum);
 
         #ifdef UI_MENUS
-            TransformUI(ctx);
+            const TransformStats transformStats = Transform::get_stats();
+            TransformUI(ctx, TRANSFORM_STATS ? &transformStats : nullptr, &selection, picking.get_transform(selection.object), picking.get_lastPickMs());
+
+            const TextureStreamStats streamStats = textures.get_streamStats();
+            TextureUI(ctx, &streamStats);
+
+            CullingUI(ctx, &forestInstances.get_lastDraw(), &forestInstances.get_lastUpload(), meshVisible);
         #endif
         nk_sdl_render(NK_ANTI_ALIASING_ON, MAX_VERTEX_MEMORY, MAX_ELEMENT_MEMORY);
 
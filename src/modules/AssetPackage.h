@@ -0,0 +1,399 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// Single file asset package (.pak)
+//
+//  [PackageHeader]
+//  [PackageEntry x slotCount]  Open addressing hash table, keyed by the FNV-1a hash of the normalized path.
+//  [Names]                     Normalized paths, not null terminated.
+//  [Blobs]                     Every blob starts at a PACKAGE_ALIGNMENT boundary.
+//
+// Mounting maps the whole file in memory, lookups return spans that point straight into the mapping.
+
+#define PACKAGE_MAGIC 0x4B505253 // "SRPK"
+#define PACKAGE_VERSION 1
+#define PACKAGE_ALIGNMENT 64
+
+namespace assets
+{
+    struct Span
+    {
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+    };
+
+    struct PackageHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t slotCount;
+        uint64_t tocOffset;
+        uint64_t namesOffset;
+        uint64_t dataOffset;
+        uint64_t fileSize;
+    };
+
+    struct PackageEntry
+    {
+        uint64_t hash;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t nameOffset;
+        uint32_t nameLength; // 0 -> empty slot
+    };
+
+    // Forward slashes only and without the leading "./", so "objs\\cube.obj" and "./objs/cube.obj" share a key.
+    static inline std::string NormalizePath(const char* path)
+    {
+        std::string p(path);
+        for (char &c : p) if (c == '\\') c = '/';
+        while (p.compare(0, 2, "./") == 0) p.erase(0, 2);
+
+        return p;
+    }
+
+    // FNV-1a
+    static inline uint64_t HashBytes(const void* data, size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    static inline uint64_t HashPath(const char* str, size_t len) { return HashBytes(str, len); }
+
+    // Normalized path with "." and ".." segments resolved (and case folded on Windows), one per file.
+    static inline std::string CanonicalPath(const char* path)
+    {
+        const std::string p = NormalizePath(path);
+
+        std::vector<std::string> segments;
+        size_t begin = 0;
+        while (begin <= p.size())
+        {
+            size_t end = p.find('/', begin);
+            if (end == std::string::npos) end = p.size();
+
+            const std::string segment = p.substr(begin, end - begin);
+            if (segment == ".." && !segments.empty() && segments.back() != "..") segments.pop_back();
+            else if (!segment.empty() && segment != ".") segments.push_back(segment);
+
+            begin = end + 1;
+        }
+
+        std::string canonical = (!p.empty() && p[0] == '/') ? "/" : "";
+        for (size_t i = 0; i < segments.size(); i++)
+            canonical += (i ? "/" : "") + segments[i];
+
+        #ifdef _WIN32
+            for (char &c : canonical) c = (char)tolower((unsigned char)c);
+        #endif
+
+        return canonical;
+    }
+
+    class AssetPackage
+    {
+        public:
+            AssetPackage() { }
+            ~AssetPackage() { Unmount(); }
+
+            AssetPackage(const AssetPackage&) = delete;
+            AssetPackage& operator=(const AssetPackage&) = delete;
+
+            // Package used by the file loaders, every lookup falls back to the file system while it's unmounted.
+            static AssetPackage& Default()
+            {
+                static AssetPackage package;
+                return package;
+            }
+
+            inline bool IsMounted() const { return _base != nullptr; }
+            inline uint32_t get_entryCount() const { return IsMounted() ? Header()->entryCount : 0; }
+
+            bool Mount(const char* path)
+            {
+                Unmount();
+
+                if (!MapFile(path)) return false;
+
+                const PackageHeader* header = Header();
+                bool valid = _size >= sizeof(PackageHeader)
+                          && header->magic == PACKAGE_MAGIC
+                          && header->version == PACKAGE_VERSION
+                          && header->fileSize == _size
+                          && header->slotCount != 0 && (header->slotCount & (header->slotCount - 1)) == 0
+                          && header->tocOffset <= _size && (uint64_t)header->slotCount * sizeof(PackageEntry) <= _size - header->tocOffset
+                          && header->namesOffset <= _size && header->dataOffset <= _size;
+
+                if (!valid)
+                {
+                    std::cout << "[AssetPackage] Invalid package (.\\" << path << ")." << std::endl;
+                    Unmount();
+                    return false;
+                }
+
+                std::cout << "[AssetPackage] Mounted " << path << " (" << header->entryCount << " assets)." << std::endl;
+                return true;
+            }
+
+            void Unmount()
+            {
+                if (!_base) return;
+
+                #ifdef _WIN32
+                    UnmapViewOfFile(_base);
+                    CloseHandle(_mapping);
+                    CloseHandle(_file);
+                    _mapping = nullptr;
+                    _file = INVALID_HANDLE_VALUE;
+                #else
+                    munmap((void*)_base, _size);
+                #endif
+
+                _base = nullptr;
+                _size = 0;
+            }
+
+            bool Find(const char* path, Span* span) const
+            {
+                if (!IsMounted()) return false;
+
+                const std::string key = NormalizePath(path);
+                const uint64_t hash = HashPath(key.c_str(), key.size());
+
+                const PackageHeader* header = Header();
+                const PackageEntry* toc = (const PackageEntry*)(_base + header->tocOffset);
+                const uint32_t mask = header->slotCount - 1;
+
+                for (uint32_t i = 0, slot = (uint32_t)hash & mask; i < header->slotCount; i++, slot = (slot + 1) & mask)
+                {
+                    const PackageEntry &entry = toc[slot];
+                    if (entry.nameLength == 0) return false;
+
+                    if (entry.hash != hash || entry.nameLength != key.size()) continue;
+
+                    // Entries come straight from the file, every range is checked without sums that could wrap
+                    if ((uint64_t)entry.nameOffset + entry.nameLength > _size - header->namesOffset) return false;
+
+                    if (memcmp(_base + header->namesOffset + entry.nameOffset, key.c_str(), key.size()) == 0)
+                    {
+                        if (!(entry.offset <= _size && entry.size <= _size - entry.offset)) return false;
+
+                        span->data = _base + entry.offset;
+                        span->size = (size_t)entry.size;
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            // Cook step, packs 'files' (stored under their normalized path) into a single package at 'path'.
+            static bool Write(const char* path, const std::vector<std::string> &files)
+            {
+                std::vector<std::string> keys;
+                std::vector<std::vector<char>> blobs;
+
+                for (auto const &file : files)
+                {
+                    std::string key = NormalizePath(file.c_str());
+
+                    std::ifstream in(key, std::ios::binary);
+                    if (!in)
+                    {
+                        std::cout << "[AssetPackage] Couldn't read the file (.\\" << file << ")." << std::endl;
+                        return false;
+                    }
+
+                    keys.push_back(key);
+                    blobs.emplace_back((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+                }
+
+                uint32_t slotCount = 1;
+                while (slotCount < keys.size() * 2) slotCount <<= 1;
+
+                PackageHeader header = {};
+                header.magic = PACKAGE_MAGIC;
+                header.version = PACKAGE_VERSION;
+                header.entryCount = (uint32_t)keys.size();
+                header.slotCount = slotCount;
+                header.tocOffset = sizeof(PackageHeader);
+                header.namesOffset = header.tocOffset + (uint64_t)slotCount * sizeof(PackageEntry);
+
+                std::string names;
+                std::vector<PackageEntry> toc(slotCount);
+                std::vector<uint64_t> offsets(keys.size());
+
+                uint64_t namesSize = 0;
+                for (auto const &key : keys) namesSize += key.size();
+
+                header.dataOffset = AlignOffset(header.namesOffset + namesSize);
+
+                uint64_t offset = header.dataOffset;
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    const uint64_t hash = HashPath(keys[i].c_str(), keys[i].size());
+
+                    uint32_t slot = (uint32_t)hash & (slotCount - 1);
+                    while (toc[slot].nameLength != 0)
+                    {
+                        if (toc[slot].hash == hash && names.compare(toc[slot].nameOffset, toc[slot].nameLength, keys[i]) == 0)
+                        {
+                            std::cout << "[AssetPackage] Duplicated asset (" << keys[i] << ")." << std::endl;
+                            return false;
+                        }
+                        slot = (slot + 1) & (slotCount - 1);
+                    }
+
+                    toc[slot].hash = hash;
+                    toc[slot].offset = offset;
+                    toc[slot].size = blobs[i].size();
+                    toc[slot].nameOffset = (uint32_t)names.size();
+                    toc[slot].nameLength = (uint32_t)keys[i].size();
+
+                    names += keys[i];
+                    offsets[i] = offset;
+                    offset = AlignOffset(offset + blobs[i].size());
+                }
+                header.fileSize = offset;
+
+                std::ofstream out(path, std::ios::binary | std::ios::trunc);
+                if (!out)
+                {
+                    std::cout << "[AssetPackage] Couldn't create the package (.\\" << path << ")." << std::endl;
+                    return false;
+                }
+
+                out.write((const char*)&header, sizeof(header));
+                out.write((const char*)toc.data(), toc.size() * sizeof(PackageEntry));
+                out.write(names.data(), names.size());
+
+                for (size_t i = 0; i < blobs.size(); i++)
+                {
+                    Pad(out, offsets[i]);
+                    out.write(blobs[i].data(), blobs[i].size());
+                }
+                Pad(out, header.fileSize);
+
+                return (bool)out;
+            }
+
+        private:
+            const unsigned char* _base = nullptr;
+            size_t _size = 0;
+
+            #ifdef _WIN32
+                HANDLE _file = INVALID_HANDLE_VALUE;
+                HANDLE _mapping = nullptr;
+            #endif
+
+            inline const PackageHeader* Header() const { return (const PackageHeader*)_base; }
+
+            static inline uint64_t AlignOffset(uint64_t offset) { return (offset + PACKAGE_ALIGNMENT - 1) & ~(uint64_t)(PACKAGE_ALIGNMENT - 1); }
+
+            static void Pad(std::ofstream &out, uint64_t offset)
+            {
+                static const char zeros[PACKAGE_ALIGNMENT] = {};
+                uint64_t pos = (uint64_t)out.tellp();
+                if (pos < offset) out.write(zeros, offset - pos);
+            }
+
+            bool MapFile(const char* path)
+            {
+                #ifdef _WIN32
+                    _file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+                    if (_file == INVALID_HANDLE_VALUE) return false;
+
+                    LARGE_INTEGER size;
+                    if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+                    {
+                        CloseHandle(_file);
+                        _file = INVALID_HANDLE_VALUE;
+                        return false;
+                    }
+
+                    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                    void* view = _mapping ? MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+                    if (!view)
+                    {
+                        if (_mapping) CloseHandle(_mapping);
+                        CloseHandle(_file);
+                        _mapping = nullptr;
+                        _file = INVALID_HANDLE_VALUE;
+                        return false;
+                    }
+
+                    _base = (const unsigned char*)view;
+                    _size = (size_t)size.QuadPart;
+                #else
+                    int fd = open(path, O_RDONLY);
+                    if (fd < 0) return false;
+
+                    struct stat st;
+                    if (fstat(fd, &st) != 0 || st.st_size == 0)
+                    {
+                        close(fd);
+                        return false;
+                    }
+
+                    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    close(fd);
+                    if (view == MAP_FAILED) return false;
+
+                    _base = (const unsigned char*)view;
+                    _size = (size_t)st.st_size;
+                #endif
+
+                return true;
+            }
+    };
+
+    // Resolves 'path' against the default package, loose files are read into 'storage' and the span points there.
+    static inline bool ReadAsset(const char* path, Span* span, std::vector<unsigned char>* storage)
+    {
+        if (AssetPackage::Default().Find(path, span)) return true;
+
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) return false;
+
+        storage->resize((size_t)file.tellg());
+        file.seekg(0);
+        file.read((char*)storage->data(), storage->size());
+        if (!file) return false;
+
+        span->data = storage->data();
+        span->size = storage->size();
+        return true;
+    }
+}
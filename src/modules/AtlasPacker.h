@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <climits>
+#include <algorithm>
+
+// Skyline bottom-left rectangle packer. Positions are rounded up to 'align' so sub-images stay
+// texel aligned down the mip chain (and on block boundaries for compressed atlases).
+
+namespace images
+{
+    class SkylinePacker
+    {
+        public:
+            SkylinePacker(int width, int height, int align = 1) : _width(width), _height(height), _align(align)
+            {
+                _skyline.push_back({ 0, 0, width });
+            }
+
+            inline int get_width() const { return _width; }
+            inline int get_height() const { return _height; }
+
+            bool Insert(int width, int height, int* x, int* y)
+            {
+                width = AlignUp(width);
+                height = AlignUp(height);
+
+                int bestIndex = -1, bestY = INT_MAX, bestWaste = INT_MAX;
+                for (size_t i = 0; i < _skyline.size(); i++)
+                {
+                    int top, waste;
+                    if (!Fits(i, width, height, &top, &waste)) continue;
+
+                    if (top < bestY || (top == bestY && waste < bestWaste))
+                    {
+                        bestIndex = (int)i;
+                        bestY = top;
+                        bestWaste = waste;
+                    }
+                }
+
+                if (bestIndex < 0) return false;
+
+                *x = _skyline[bestIndex].x;
+                *y = bestY;
+                AddLevel(bestIndex, *x, bestY + height, width);
+
+                return true;
+            }
+
+        private:
+            struct Segment { int x, y, width; };
+
+            std::vector<Segment> _skyline;
+            int _width, _height, _align;
+
+            inline int AlignUp(int v) const { return (v + _align - 1) / _align * _align; }
+
+            // Height the rect would rest at when its left edge sits on segment 'index', plus the area wasted below it.
+            bool Fits(size_t index, int width, int height, int* top, int* waste) const
+            {
+                const int x = _skyline[index].x;
+                if (x + width > _width) return false;
+
+                int y = 0, remaining = width;
+                for (size_t i = index; remaining > 0; i++)
+                {
+                    if (i == _skyline.size()) return false;
+
+                    y = std::max(y, _skyline[i].y);
+                    remaining -= _skyline[i].width;
+                }
+                if (y + height > _height) return false;
+
+                *waste = 0;
+                remaining = width;
+                for (size_t i = index; remaining > 0; i++)
+                {
+                    const int span = std::min(remaining, _skyline[i].width);
+                    *waste += (y - _skyline[i].y) * span;
+                    remaining -= span;
+                }
+
+                *top = y;
+                return true;
+            }
+
+            void AddLevel(int index, int x, int y, int width)
+            {
+                _skyline.insert(_skyline.begin() + index, { x, y, width });
+
+                // Trim (or drop) the segments now covered by the new one
+                for (size_t i = index + 1; i < _skyline.size(); )
+                {
+                    Segment &segment = _skyline[i];
+                    const int covered = x + width - segment.x;
+                    if (covered <= 0) break;
+
+                    if (covered < segment.width)
+                    {
+                        segment.x += covered;
+                        segment.width -= covered;
+                        break;
+                    }
+                    _skyline.erase(_skyline.begin() + i);
+                }
+
+                // Merge neighbours at the same height
+                for (size_t i = 0; i + 1 < _skyline.size(); )
+                {
+                    if (_skyline[i].y == _skyline[i + 1].y)
+                    {
+                        _skyline[i].width += _skyline[i + 1].width;
+                        _skyline.erase(_skyline.begin() + i + 1);
+                    }
+                    else i++;
+                }
+            }
+    };
+}
@@ -0,0 +1,719 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#include "SIMD.h"
+#include "LinearAlgebra.h"
+#include "BatchTransform.h"
+#include "Geometry.h"
+#include "RayTriangle.h"
+#include "AssetPackage.h"
+#include "ThreadPool.h"
+
+#define BVH_BINS 16
+#define BVH_MAX_LEAF 8
+#define BVH_MAX_DEPTH 64
+#define BVH_TRAVERSAL_COST 1.0f     // One node step, in triangle tests
+#define BVH_TASK_SIZE 4096          // Subtrees with at least this many triangles are built on the pool
+#define BVH_SLAB_SLACK 1.0000004f   // 1 + 2 gamma(3), keeps the box test conservative against rounding (Ize 2013)
+#define BVH_PADDING 16              // Degenerate triangles after the last leaf, a full register can always be loaded
+
+#define BVH_CACHE_EXT ".bvh"
+#define BVH_MAGIC 0x31485642        // "BVH1"
+
+#if defined(SR_AVX)
+    #define BVH_WIDTH 8
+#else
+    #define BVH_WIDTH 4
+#endif
+
+// 32 bytes, two per cache line. Inner nodes have their children next to each other at 'index' and
+// 'index + 1', leaves own the triangles [index, index + count) of BVH::get_triangles().
+struct BVHNode
+{
+    float min[3];
+    uint32_t index;
+    float max[3];
+    uint32_t count;
+
+    inline bool IsLeaf() const { return count > 0; }
+};
+
+// Binary nodes collapsed into Width children, bounds in SoA so a single slab test covers all of them.
+// bounds[0..2] are the min x, y, z and bounds[3..5] the max. Leaf children are stored inline (count > 0),
+// empty slots have inverted bounds and are never hit.
+template<int Width>
+struct alignas(32) BVHWideNode
+{
+    float bounds[6][Width];
+    uint32_t index[Width];
+    uint32_t count[Width];
+};
+
+struct BVHFileHeader
+{
+    uint32_t magic, width;
+    uint32_t triangleCount, nodeCount;
+    uint64_t sourceHash;
+};
+
+// Binned SAH bounding volume hierarchy over a triangle mesh (OBJLoader output). Built as a binary tree
+// of 32 byte nodes, which is what gets cached, and collapsed into BVH_WIDTH wide nodes for traversal:
+// 8 with AVX, 4 otherwise. Leaves are contiguous ranges of a reordered TriangleStream and run the batch
+// Moller-Trumbore kernel, so t, u and v have the same bits Ray::IntersectTriangle gives.
+class BVH
+{
+    public:
+        inline const TriangleStream& get_triangles() const { return _triangles; }
+        inline const std::vector<uint32_t>& get_triangleIndex() const { return _triangleIndex; }
+        inline const std::vector<BVHNode>& get_nodes() const { return _nodes; }
+        inline const std::vector<BVHWideNode<BVH_WIDTH>>& get_wideNodes() const { return _wideNodes; }
+
+        inline size_t get_triangleCount() const { return _triangleIndex.size(); }
+        inline bool empty() const { return _nodes.empty(); }
+
+        inline AABB<float> Bounds() const
+        {
+            if (_nodes.empty()) return AABB<float>();
+            const BVHNode &root = _nodes[0];
+            return AABB<float>(Vector3<float>(root.min[0], root.min[1], root.min[2]), Vector3<float>(root.max[0], root.max[1], root.max[2]));
+        }
+
+        void Clear()
+        {
+            _triangles.Clear();
+            _triangleIndex.clear();
+            _nodes.clear();
+            _wideNodes.clear();
+            _sourceHash = 0;
+        }
+
+        // Subtrees of at least BVH_TASK_SIZE triangles are split across 'pool'.
+        void Build(const float* verts, const unsigned int* tris, size_t triCount, int stride = 8, int offset = 0, ThreadPool* pool = nullptr)
+        {
+            Clear();
+            if (triCount == 0) return;
+
+            TriangleStream source;
+            source.FromMesh(verts, tris, triCount, stride, offset);
+            _sourceHash = HashTriangles(source);
+
+            // Bounds of the triangles the kernel actually tests (v0 + edge), not of the original corners
+            BuildState state;
+            state.prims.resize(triCount);
+            for (size_t i = 0; i < triCount; i++)
+            {
+                const Vector3<float> a = source.Corner(i, 0), b = source.Corner(i, 1), c = source.Corner(i, 2);
+                Prim &prim = state.prims[i];
+                prim.index = (uint32_t)i;
+                prim.min[0] = std::min(std::min(a.x, b.x), c.x); prim.max[0] = std::max(std::max(a.x, b.x), c.x);
+                prim.min[1] = std::min(std::min(a.y, b.y), c.y); prim.max[1] = std::max(std::max(a.y, b.y), c.y);
+                prim.min[2] = std::min(std::min(a.z, b.z), c.z); prim.max[2] = std::max(std::max(a.z, b.z), c.z);
+                prim.unused = 0;
+            }
+
+            _nodes.resize(triCount * 2 - 1);
+            state.nodes = _nodes.data();
+            state.pool = pool;
+
+            BuildNode(state, 0, 0, (uint32_t)triCount, 0);
+            _nodes.resize(state.nodeCount);
+
+            _triangleIndex.resize(triCount);
+            for (size_t i = 0; i < triCount; i++) _triangleIndex[i] = state.prims[i].index;
+
+            Reorder(source);
+            Collapse();
+        }
+
+        // Closest hit along the ray (RAY_T_MIN < t < tMax), 'hit->triangle' is the triangle index in the source mesh.
+        bool Intersect(const Ray<float> &ray, RayHit* hit, float tMax = std::numeric_limits<float>::infinity()) const
+        {
+            if (_wideNodes.empty()) return false;
+
+            struct Entry { uint32_t index, count; float t; };
+            Entry stack[BVH_MAX_DEPTH * BVH_WIDTH];
+            int top = 0;
+            stack[top++] = { 0, 0, 0.0f };
+
+            SlabRay slab;
+            const float dir[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+            const float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+            for (int axis = 0; axis < 3; axis++)
+            {
+                slab.origin[axis] = origin[axis];
+                slab.invDir[axis] = 1.0f / dir[axis];
+                slab.nearBound[axis] = std::signbit(dir[axis]) ? axis + 3 : axis;
+                slab.farBound[axis] = std::signbit(dir[axis]) ? axis : axis + 3;
+            }
+
+            LeafHit best;
+            best.t = tMax;
+
+            #ifdef SR_BATCH_LANES
+                batch::lanes::Lanes o[3], d[3];
+                batch::SetLanes(ray.origin, o);
+                batch::SetLanes(ray.direction, d);
+            #endif
+
+            while (top > 0)
+            {
+                const Entry entry = stack[--top];
+                if (!(entry.t < best.t)) continue;
+
+                if (entry.count)
+                {
+                    #ifdef SR_BATCH_LANES
+                        IntersectLeaf(o, d, entry.index, entry.count, &best);
+                    #else
+                        IntersectLeaf(ray, entry.index, entry.count, &best);
+                    #endif
+                    continue;
+                }
+
+                const BVHWideNode<BVH_WIDTH> &node = _wideNodes[entry.index];
+                alignas(32) float tNear[BVH_WIDTH];
+                unsigned hits = SlabTest(node, slab, best.t, tNear);
+
+                // Children pushed farthest first so the nearest one is popped next
+                Entry sorted[BVH_WIDTH];
+                int sortedCount = 0;
+                while (hits)
+                {
+                    const int c = CountTrailingZeros(hits);
+                    hits &= hits - 1;
+
+                    const Entry child = { node.index[c], node.count[c], tNear[c] };
+                    int j = sortedCount++;
+                    for (; j > 0 && sorted[j - 1].t < child.t; j--) sorted[j] = sorted[j - 1];
+                    sorted[j] = child;
+                }
+                for (int j = 0; j < sortedCount; j++) stack[top++] = sorted[j];
+            }
+
+            if (best.triangle < 0) return false;
+
+            hit->t = best.t; hit->u = best.u; hit->v = best.v;
+            hit->triangle = (int)_triangleIndex[best.triangle];
+            return true;
+        }
+
+        // Binary nodes and the leaf order, the wide nodes and the triangles are rebuilt on Load().
+        bool Save(const char* path) const
+        {
+            if (_nodes.empty())
+            {
+                std::cout << "[BVH] Nothing to save (.\\" << path << ")." << std::endl;
+                return false;
+            }
+
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            if (!file)
+            {
+                std::cout << "[BVH] Couldn't create the file (.\\" << path << ")." << std::endl;
+                return false;
+            }
+
+            BVHFileHeader header = {};
+            header.magic = BVH_MAGIC;
+            header.width = sizeof(BVHNode);
+            header.triangleCount = (uint32_t)_triangleIndex.size();
+            header.nodeCount = (uint32_t)_nodes.size();
+            header.sourceHash = _sourceHash;
+
+            file.write((const char*)&header, sizeof(header));
+            file.write((const char*)_nodes.data(), _nodes.size() * sizeof(BVHNode));
+            file.write((const char*)_triangleIndex.data(), _triangleIndex.size() * sizeof(uint32_t));
+
+            return (bool)file;
+        }
+
+        // Fails (and leaves the BVH empty) when the file wasn't built from this same mesh.
+        bool Load(const char* path, const float* verts, const unsigned int* tris, size_t triCount, int stride = 8, int offset = 0)
+        {
+            Clear();
+
+            assets::Span file;
+            std::vector<unsigned char> fileStorage;
+            if (!assets::ReadAsset(path, &file, &fileStorage)) return false;
+
+            if (file.size < sizeof(BVHFileHeader)) return false;
+            BVHFileHeader header;
+            memcpy(&header, file.data, sizeof(header));
+
+            const size_t expected = sizeof(header) + (size_t)header.nodeCount * sizeof(BVHNode) + (size_t)header.triangleCount * sizeof(uint32_t);
+            if (header.magic != BVH_MAGIC || header.width != sizeof(BVHNode) || header.triangleCount != triCount
+                || header.nodeCount == 0 || header.nodeCount > triCount * 2 - 1 || file.size != expected)
+            {
+                std::cout << "[BVH] Unsupported or corrupt file (.\\" << path << ")." << std::endl;
+                return false;
+            }
+
+            TriangleStream source;
+            source.FromMesh(verts, tris, triCount, stride, offset);
+            if (HashTriangles(source) != header.sourceHash) return false;
+
+            _nodes.resize(header.nodeCount);
+            _triangleIndex.resize(header.triangleCount);
+            memcpy(_nodes.data(), file.data + sizeof(header), _nodes.size() * sizeof(BVHNode));
+            memcpy(_triangleIndex.data(), file.data + sizeof(header) + _nodes.size() * sizeof(BVHNode), _triangleIndex.size() * sizeof(uint32_t));
+
+            // Children stored after their parent, every node reached exactly once and inner ones no deeper than
+            // Build() splits: CollapseNode() terminates and the Intersect() stack can't overflow
+            std::vector<int> depth(_nodes.size(), -1);
+            depth[0] = 0;
+            for (uint32_t i = 0; i < (uint32_t)_nodes.size(); i++)
+            {
+                const BVHNode &node = _nodes[i];
+                bool valid = depth[i] >= 0;
+                if (valid && node.IsLeaf()) valid = (uint64_t)node.index + node.count <= triCount;
+                else if (valid)
+                {
+                    valid = node.index > i && (uint64_t)node.index + 1 < _nodes.size() && depth[i] < BVH_MAX_DEPTH
+                         && depth[node.index] < 0 && depth[node.index + 1] < 0;
+                    if (valid) depth[node.index] = depth[node.index + 1] = depth[i] + 1;
+                }
+                if (valid) continue;
+
+                std::cout << "[BVH] Unsupported or corrupt file (.\\" << path << ")." << std::endl;
+                Clear();
+                return false;
+            }
+            for (uint32_t index : _triangleIndex)
+            {
+                if (index < triCount) continue;
+
+                std::cout << "[BVH] Unsupported or corrupt file (.\\" << path << ")." << std::endl;
+                Clear();
+                return false;
+            }
+
+            _sourceHash = header.sourceHash;
+            Reorder(source);
+            Collapse();
+            return true;
+        }
+
+        // Reads "<meshPath>.bvh" when it's packaged or not older than the mesh, otherwise builds and writes it.
+        // Returns true when the cache was used.
+        bool LoadOrBuild(const char* meshPath, const float* verts, const unsigned int* tris, size_t triCount, int stride = 8, int offset = 0, ThreadPool* pool = nullptr)
+        {
+            const std::string cachePath = std::string(meshPath) + BVH_CACHE_EXT;
+
+            struct stat source, cache;
+            const bool stale = stat(cachePath.c_str(), &cache) == 0 && stat(meshPath, &source) == 0 && cache.st_mtime < source.st_mtime;
+            if (!stale && Load(cachePath.c_str(), verts, tris, triCount, stride, offset)) return true;
+
+            Build(verts, tris, triCount, stride, offset, pool);
+            if (!_nodes.empty()) Save(cachePath.c_str());
+            return false;
+        }
+
+    private:
+        TriangleStream _triangles;
+        std::vector<uint32_t> _triangleIndex; // Leaf order -> source mesh triangle
+        std::vector<BVHNode> _nodes;
+        std::vector<BVHWideNode<BVH_WIDTH>> _wideNodes;
+        uint64_t _sourceHash = 0;
+
+        // Triangle bounds laid out like BVHNode, the index rides in the w lane of 'min' (masked off before any
+        // box math, it would be a denormal). Partitioned in place while building, so they end up in leaf order.
+        struct alignas(16) Prim
+        {
+            float min[3];
+            uint32_t index;
+            float max[3];
+            float unused;
+
+            inline float Centroid(int axis) const { return (min[axis] + max[axis]) * 0.5f; }
+        };
+
+        struct BuildState
+        {
+            std::vector<Prim> prims;
+            BVHNode* nodes = nullptr;
+            std::atomic<uint32_t> nodeCount { 1 };
+            ThreadPool* pool = nullptr;
+        };
+
+        struct alignas(16) Bin
+        {
+            float min[4], max[4];
+            uint32_t count;
+
+            inline void Reset()
+            {
+                count = 0;
+                for (int a = 0; a < 4; a++) min[a] = std::numeric_limits<float>::infinity(), max[a] = -std::numeric_limits<float>::infinity();
+            }
+
+            #if defined(SR_SSE2)
+                inline void Grow(__m128 lo, __m128 hi)
+                {
+                    _mm_store_ps(min, _mm_min_ps(_mm_load_ps(min), lo));
+                    _mm_store_ps(max, _mm_max_ps(_mm_load_ps(max), hi));
+                }
+                inline void Grow(const Bin &bin) { Grow(_mm_load_ps(bin.min), _mm_load_ps(bin.max)); }
+            #else
+                inline void Grow(const float lo[3], const float hi[3])
+                {
+                    for (int a = 0; a < 3; a++) min[a] = std::min(min[a], lo[a]), max[a] = std::max(max[a], hi[a]);
+                }
+                inline void Grow(const Bin &bin) { Grow(bin.min, bin.max); }
+            #endif
+        };
+
+        struct SlabRay
+        {
+            float origin[3], invDir[3];
+            int nearBound[3], farBound[3];
+        };
+
+        struct LeafHit
+        {
+            float t, u = 0, v = 0;
+            int triangle = -1;
+        };
+
+        static inline float HalfArea(const float min[3], const float max[3])
+        {
+            const float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+            return dx * dy + dy * dz + dz * dx;
+        }
+
+        static inline int CountTrailingZeros(unsigned bits)
+        {
+            #if defined(__GNUC__)
+                return __builtin_ctz(bits);
+            #else
+                int n = 0;
+                while (!(bits & 1)) bits >>= 1, n++;
+                return n;
+            #endif
+        }
+
+        static uint64_t HashTriangles(const TriangleStream &tris)
+        {
+            const Vector3Stream<float>* streams[3] = { &tris.v0, &tris.edge1, &tris.edge2 };
+
+            uint64_t hash = 0;
+            for (const Vector3Stream<float>* stream : streams)
+            {
+                const float* axes[3] = { stream->get_x(), stream->get_y(), stream->get_z() };
+                for (const float* axis : axes) hash = (hash ^ assets::HashBytes(axis, stream->size() * sizeof(float))) * 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        static inline int BinIndex(float centroid, float cmin, float scale) { return std::min((int)((centroid - cmin) * scale), BVH_BINS - 1); }
+
+        static void BuildNode(BuildState &state, uint32_t nodeIndex, uint32_t first, uint32_t count, int depth)
+        {
+            Prim* prims = state.prims.data() + first;
+
+            BVHNode &node = state.nodes[nodeIndex];
+            Bin bounds, centroids;
+            bounds.Reset();
+            centroids.Reset();
+
+            #if defined(SR_SSE2)
+                const __m128 half = _mm_set1_ps(0.5f), xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    const __m128 lo = _mm_and_ps(_mm_load_ps(prims[i].min), xyz), hi = _mm_load_ps(prims[i].max);
+                    const __m128 centroid = _mm_mul_ps(_mm_add_ps(lo, hi), half);
+                    bounds.Grow(lo, hi);
+                    centroids.Grow(centroid, centroid);
+                }
+            #else
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    const float centroid[3] = { prims[i].Centroid(0), prims[i].Centroid(1), prims[i].Centroid(2) };
+                    bounds.Grow(prims[i].min, prims[i].max);
+                    centroids.Grow(centroid, centroid);
+                }
+            #endif
+
+            for (int a = 0; a < 3; a++) node.min[a] = bounds.min[a], node.max[a] = bounds.max[a];
+            node.index = first;
+            node.count = count;
+            if (count <= 1 || depth >= BVH_MAX_DEPTH) return;
+
+            // Binned SAH, the three axes in one pass: best plane among BVH_BINS - 1 candidates per axis
+            alignas(16) float scale[4] = { 0, 0, 0, 0 };
+            for (int a = 0; a < 3; a++)
+            {
+                const float extent = centroids.max[a] - centroids.min[a];
+                scale[a] = extent > 0 ? BVH_BINS / extent : 0.0f;
+            }
+
+            Bin bins[3][BVH_BINS];
+            for (auto &axisBins : bins)
+                for (Bin &bin : axisBins) bin.Reset();
+
+            #if defined(SR_SSE2)
+                const __m128 cmin = _mm_load_ps(centroids.min), scale4 = _mm_load_ps(scale);
+                const __m128i lastBin = _mm_set1_epi32(BVH_BINS - 1);
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    const __m128 lo = _mm_and_ps(_mm_load_ps(prims[i].min), xyz), hi = _mm_load_ps(prims[i].max);
+                    const __m128 centroid = _mm_mul_ps(_mm_add_ps(lo, hi), half);
+
+                    // Same operations as BinIndex(), indices are 0..BVH_BINS so a 16 bit min is enough
+                    alignas(16) int index[4];
+                    _mm_store_si128((__m128i*)index, _mm_min_epi16(_mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(centroid, cmin), scale4)), lastBin));
+                    for (int a = 0; a < 3; a++)
+                    {
+                        Bin &bin = bins[a][index[a]];
+                        bin.count++;
+                        bin.Grow(lo, hi);
+                    }
+                }
+            #else
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    for (int a = 0; a < 3; a++)
+                    {
+                        Bin &bin = bins[a][BinIndex(prims[i].Centroid(a), centroids.min[a], scale[a])];
+                        bin.count++;
+                        bin.Grow(prims[i].min, prims[i].max);
+                    }
+                }
+            #endif
+
+            int bestAxis = -1, bestBin = 0;
+            float bestCost = std::numeric_limits<float>::infinity();
+            for (int a = 0; a < 3; a++)
+            {
+                if (scale[a] == 0) continue;
+
+                // Right to left sweep for what's right of each plane, then left to right for the costs
+                float rightArea[BVH_BINS - 1];
+                uint32_t rightCount[BVH_BINS - 1];
+                Bin right = bins[a][BVH_BINS - 1];
+                for (int b = BVH_BINS - 2; b >= 0; b--)
+                {
+                    rightArea[b] = right.count ? HalfArea(right.min, right.max) : 0.0f;
+                    rightCount[b] = right.count;
+                    right.count += bins[a][b].count;
+                    right.Grow(bins[a][b]);
+                }
+
+                Bin left = bins[a][0];
+                for (int b = 0; b < BVH_BINS - 1; b++)
+                {
+                    if (b > 0)
+                    {
+                        left.count += bins[a][b].count;
+                        left.Grow(bins[a][b]);
+                    }
+                    if (!left.count || !rightCount[b]) continue;
+
+                    const float cost = HalfArea(left.min, left.max) * left.count + rightArea[b] * rightCount[b];
+                    if (cost < bestCost) bestCost = cost, bestAxis = a, bestBin = b;
+                }
+            }
+
+            uint32_t split;
+            if (bestAxis < 0)
+            {
+                // Every centroid in the same spot, only worth splitting (anywhere) if the leaf would be too big
+                if (count <= BVH_MAX_LEAF) return;
+                split = count / 2;
+            }
+            else
+            {
+                const float area = HalfArea(node.min, node.max);
+                const float splitCost = BVH_TRAVERSAL_COST + (area > 0 ? bestCost / area : 0.0f);
+                if (count <= BVH_MAX_LEAF && splitCost >= (float)count) return;
+
+                const float cmin = centroids.min[bestAxis], axisScale = scale[bestAxis];
+                split = (uint32_t)(std::partition(prims, prims + count, [&](const Prim &prim)
+                {
+                    return BinIndex(prim.Centroid(bestAxis), cmin, axisScale) <= bestBin;
+                }) - prims);
+                if (split == 0 || split == count) split = count / 2;
+            }
+
+            const uint32_t children = state.nodeCount.fetch_add(2);
+            node.index = children;
+            node.count = 0;
+
+            const uint32_t ranges[2][2] = { { first, split }, { first + split, count - split } };
+            auto buildChild = [&](size_t c) { BuildNode(state, children + (uint32_t)c, ranges[c][0], ranges[c][1], depth + 1); };
+
+            if (state.pool && count >= BVH_TASK_SIZE) state.pool->ParallelFor(2, buildChild);
+            else { buildChild(0); buildChild(1); }
+        }
+
+        // Triangles in leaf order, plus the padding the leaf kernel reads past the last one
+        void Reorder(const TriangleStream &source)
+        {
+            _triangles.Clear();
+            _triangles.Reserve(_triangleIndex.size() + BVH_PADDING);
+            for (uint32_t index : _triangleIndex)
+            {
+                _triangles.v0.PushBack(source.v0.Get(index));
+                _triangles.edge1.PushBack(source.edge1.Get(index));
+                _triangles.edge2.PushBack(source.edge2.Get(index));
+            }
+
+            const Vector3<float> zero(0, 0, 0);
+            for (int i = 0; i < BVH_PADDING; i++) _triangles.PushBack(zero, zero, zero);
+        }
+
+        void Collapse()
+        {
+            _wideNodes.clear();
+            _wideNodes.reserve(_nodes.size() / 2 + 1);
+            CollapseNode(0);
+        }
+
+        // Opens the inner child with the largest surface area until the node is full or only leaves are left.
+        uint32_t CollapseNode(uint32_t nodeIndex)
+        {
+            uint32_t children[BVH_WIDTH];
+            int childCount = 0;
+
+            const BVHNode &node = _nodes[nodeIndex];
+            if (node.IsLeaf()) children[childCount++] = nodeIndex;
+            else children[childCount++] = node.index, children[childCount++] = node.index + 1;
+
+            while (childCount < BVH_WIDTH)
+            {
+                int open = -1;
+                float openArea = -1;
+                for (int c = 0; c < childCount; c++)
+                {
+                    const BVHNode &child = _nodes[children[c]];
+                    const float area = HalfArea(child.min, child.max);
+                    if (!child.IsLeaf() && area > openArea) open = c, openArea = area;
+                }
+                if (open < 0) break;
+
+                const uint32_t inner = children[open];
+                children[open] = _nodes[inner].index;
+                children[childCount++] = _nodes[inner].index + 1;
+            }
+
+            const uint32_t wideIndex = (uint32_t)_wideNodes.size();
+            _wideNodes.emplace_back();
+
+            uint32_t index[BVH_WIDTH], count[BVH_WIDTH];
+            for (int c = 0; c < BVH_WIDTH; c++)
+            {
+                BVHWideNode<BVH_WIDTH> &wide = _wideNodes[wideIndex];
+                if (c >= childCount)
+                {
+                    for (int a = 0; a < 3; a++) wide.bounds[a][c] = std::numeric_limits<float>::infinity(), wide.bounds[a + 3][c] = -std::numeric_limits<float>::infinity();
+                    index[c] = count[c] = 0;
+                    continue;
+                }
+
+                const BVHNode &child = _nodes[children[c]];
+                for (int a = 0; a < 3; a++) wide.bounds[a][c] = child.min[a], wide.bounds[a + 3][c] = child.max[a];
+                count[c] = child.count;
+                index[c] = child.IsLeaf() ? child.index : CollapseNode(children[c]); // May reallocate _wideNodes
+            }
+
+            BVHWideNode<BVH_WIDTH> &wide = _wideNodes[wideIndex];
+            for (int c = 0; c < BVH_WIDTH; c++) wide.index[c] = index[c], wide.count[c] = count[c];
+            return wideIndex;
+        }
+
+        // Entry distance of every child and the mask of the ones the ray crosses before 'tMax'.
+        static inline unsigned SlabTest(const BVHWideNode<BVH_WIDTH> &node, const SlabRay &ray, float tMax, float* tNear)
+        {
+            #if defined(SR_AVX)
+                __m256 tn = _mm256_setzero_ps(), tf = _mm256_set1_ps(tMax);
+                for (int a = 0; a < 3; a++)
+                {
+                    const __m256 o = _mm256_set1_ps(ray.origin[a]), inv = _mm256_set1_ps(ray.invDir[a]);
+                    tn = _mm256_max_ps(tn, _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[ray.nearBound[a]]), o), inv));
+                    tf = _mm256_min_ps(tf, _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[ray.farBound[a]]), o), inv));
+                }
+                tf = _mm256_mul_ps(tf, _mm256_set1_ps(BVH_SLAB_SLACK));
+                _mm256_store_ps(tNear, tn);
+                return ~(unsigned)_mm256_movemask_ps(_mm256_cmp_ps(tf, tn, _CMP_LT_OQ)) & 0xFF;
+            #elif defined(SR_SSE2)
+                __m128 tn = _mm_setzero_ps(), tf = _mm_set1_ps(tMax);
+                for (int a = 0; a < 3; a++)
+                {
+                    const __m128 o = _mm_set1_ps(ray.origin[a]), inv = _mm_set1_ps(ray.invDir[a]);
+                    tn = _mm_max_ps(tn, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[ray.nearBound[a]]), o), inv));
+                    tf = _mm_min_ps(tf, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[ray.farBound[a]]), o), inv));
+                }
+                tf = _mm_mul_ps(tf, _mm_set1_ps(BVH_SLAB_SLACK));
+                _mm_store_ps(tNear, tn);
+                return ~(unsigned)_mm_movemask_ps(_mm_cmplt_ps(tf, tn)) & 0xF;
+            #else
+                unsigned mask = 0;
+                for (int c = 0; c < BVH_WIDTH; c++)
+                {
+                    float tn = 0.0f, tf = tMax;
+                    for (int a = 0; a < 3; a++)
+                    {
+                        const float n = (node.bounds[ray.nearBound[a]][c] - ray.origin[a]) * ray.invDir[a];
+                        const float f = (node.bounds[ray.farBound[a]][c] - ray.origin[a]) * ray.invDir[a];
+                        tn = n > tn ? n : tn;
+                        tf = f < tf ? f : tf;
+                    }
+                    tNear[c] = tn;
+                    if (!(tf * BVH_SLAB_SLACK < tn)) mask |= 1u << c;
+                }
+                return mask;
+            #endif
+        }
+
+        #ifdef SR_BATCH_LANES
+            // A register of the leaf's triangles per step, lanes past its end masked off (they read the padding).
+            inline void IntersectLeaf(const batch::lanes::Lanes o[3], const batch::lanes::Lanes d[3], uint32_t first, uint32_t count, LeafHit* best) const
+            {
+                using namespace batch::lanes;
+
+                for (uint32_t i = first; i < first + count; i += SR_BATCH_LANES)
+                {
+                    Lanes v0[3], e1[3], e2[3], t, u, v;
+                    batch::LoadLanes(_triangles.v0, i, v0);
+                    batch::LoadLanes(_triangles.edge1, i, e1);
+                    batch::LoadLanes(_triangles.edge2, i, e2);
+
+                    const uint32_t remaining = first + count - i;
+                    const unsigned valid = remaining >= SR_BATCH_LANES ? ~0u : (1u << remaining) - 1;
+                    const unsigned hits = batch::IntersectLanes(o, d, v0, e1, e2, Set(best->t), &t, &u, &v) & valid;
+                    if (!hits) continue;
+
+                    alignas(64) float ts[SR_BATCH_LANES], us[SR_BATCH_LANES], vs[SR_BATCH_LANES];
+                    Store(ts, t); Store(us, u); Store(vs, v);
+                    for (int lane = 0; lane < SR_BATCH_LANES; lane++)
+                    {
+                        if (!((hits >> lane) & 1) || !(ts[lane] < best->t)) continue;
+                        best->t = ts[lane]; best->u = us[lane]; best->v = vs[lane];
+                        best->triangle = (int)(i + lane);
+                    }
+                }
+            }
+        #else
+            inline void IntersectLeaf(const Ray<float> &ray, uint32_t first, uint32_t count, LeafHit* best) const
+            {
+                for (uint32_t i = first; i < first + count; i++)
+                {
+                    float t, u, v;
+                    if (!ray.IntersectTriangle(_triangles.v0.Get(i), _triangles.edge1.Get(i), _triangles.edge2.Get(i), best->t, &t, &u, &v)) continue;
+                    best->t = t; best->u = u; best->v = v;
+                    best->triangle = (int)i;
+                }
+            }
+        #endif
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+
+#include "SIMD.h"
+#include "LinearAlgebra.h"
+
+// Matrix4x4<float> applied to whole SoA streams (x[], y[], z[]) at once, for skinning, bound updates and
+// rasterization. Widest lanes the build allows (AVX-512, AVX, SSE2) with a scalar tail doing the same
+// operations in the same order, so every element gets the same bits whatever lane it falls in.
+// Outputs may be the inputs (in place), other overlaps are not allowed. No alignment required.
+
+namespace batch
+{
+    namespace lanes
+    {
+        #if defined(SR_AVX512)
+            #define SR_BATCH_LANES 16
+            typedef __m512 Lanes;
+            static inline Lanes Load(const float* p) { return _mm512_loadu_ps(p); }
+            static inline void Store(float* p, Lanes v) { _mm512_storeu_ps(p, v); }
+            static inline Lanes Set(float v) { return _mm512_set1_ps(v); }
+            static inline Lanes Add(Lanes a, Lanes b) { return _mm512_add_ps(a, b); }
+            static inline Lanes Sub(Lanes a, Lanes b) { return _mm512_sub_ps(a, b); }
+            static inline Lanes Mul(Lanes a, Lanes b) { return _mm512_mul_ps(a, b); }
+            static inline Lanes Div(Lanes a, Lanes b) { return _mm512_div_ps(a, b); }
+            static inline Lanes Sqrt(Lanes a) { return _mm512_sqrt_ps(a); }
+            static inline Lanes Min(Lanes a, Lanes b) { return _mm512_min_ps(a, b); }
+            static inline Lanes Max(Lanes a, Lanes b) { return _mm512_max_ps(a, b); }
+            static inline unsigned LessMask(Lanes a, Lanes b) { return (unsigned)_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+        #elif defined(SR_AVX)
+            #define SR_BATCH_LANES 8
+            typedef __m256 Lanes;
+            static inline Lanes Load(const float* p) { return _mm256_loadu_ps(p); }
+            static inline void Store(float* p, Lanes v) { _mm256_storeu_ps(p, v); }
+            static inline Lanes Set(float v) { return _mm256_set1_ps(v); }
+            static inline Lanes Add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+            static inline Lanes Sub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+            static inline Lanes Mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+            static inline Lanes Div(Lanes a, Lanes b) { return _mm256_div_ps(a, b); }
+            static inline Lanes Sqrt(Lanes a) { return _mm256_sqrt_ps(a); }
+            static inline Lanes Min(Lanes a, Lanes b) { return _mm256_min_ps(a, b); }
+            static inline Lanes Max(Lanes a, Lanes b) { return _mm256_max_ps(a, b); }
+            static inline unsigned LessMask(Lanes a, Lanes b) { return (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+        #elif defined(SR_SSE2)
+            #define SR_BATCH_LANES 4
+            typedef __m128 Lanes;
+            static inline Lanes Load(const float* p) { return _mm_loadu_ps(p); }
+            static inline void Store(float* p, Lanes v) { _mm_storeu_ps(p, v); }
+            static inline Lanes Set(float v) { return _mm_set1_ps(v); }
+            static inline Lanes Add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+            static inline Lanes Sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+            static inline Lanes Mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+            static inline Lanes Div(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+            static inline Lanes Sqrt(Lanes a) { return _mm_sqrt_ps(a); }
+            static inline Lanes Min(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+            static inline Lanes Max(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+            static inline unsigned LessMask(Lanes a, Lanes b) { return (unsigned)_mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+        #endif
+    }
+
+    // Points as (x, y, z, 1) * mat, w ignored. Enough for any affine matrix.
+    static inline void TransformPoints(const Matrix4x4<float> &mat, const float* xs, const float* ys, const float* zs,
+                                float* outX, float* outY, float* outZ, size_t count)
+    {
+        size_t i = 0;
+
+        #ifdef SR_BATCH_LANES
+            using namespace lanes;
+
+            Lanes m[4][3];
+            for (int r = 0; r < 4; r++)
+                for (int c = 0; c < 3; c++)
+                    m[r][c] = Set(mat[r][c]);
+
+            for (; i + SR_BATCH_LANES <= count; i += SR_BATCH_LANES)
+            {
+                const Lanes x = Load(xs + i), y = Load(ys + i), z = Load(zs + i);
+
+                Store(outX + i, Add(Add(Add(Mul(x, m[0][0]), Mul(y, m[1][0])), Mul(z, m[2][0])), m[3][0]));
+                Store(outY + i, Add(Add(Add(Mul(x, m[0][1]), Mul(y, m[1][1])), Mul(z, m[2][1])), m[3][1]));
+                Store(outZ + i, Add(Add(Add(Mul(x, m[0][2]), Mul(y, m[1][2])), Mul(z, m[2][2])), m[3][2]));
+            }
+        #endif
+
+        // Counted down, 'i < count' trips -Waggressive-loop-optimizations once a constant count is inlined
+        for (size_t n = count - i; n--; i++)
+        {
+            const float x = xs[i], y = ys[i], z = zs[i];
+
+            outX[i] = ((x * mat[0][0] + y * mat[1][0]) + z * mat[2][0]) + mat[3][0];
+            outY[i] = ((x * mat[0][1] + y * mat[1][1]) + z * mat[2][1]) + mat[3][1];
+            outZ[i] = ((x * mat[0][2] + y * mat[1][2]) + z * mat[2][2]) + mat[3][2];
+        }
+    }
+
+    // Points through a projective matrix, divided by w (TransformVector for whole streams). 'outW' receives
+    // w before the divide when given, clipping needs it.
+    static inline void ProjectPoints(const Matrix4x4<float> &mat, const float* xs, const float* ys, const float* zs,
+                              float* outX, float* outY, float* outZ, float* outW, size_t count)
+    {
+        size_t i = 0;
+
+        #ifdef SR_BATCH_LANES
+            using namespace lanes;
+
+            Lanes m[4][4];
+            for (int r = 0; r < 4; r++)
+                for (int c = 0; c < 4; c++)
+                    m[r][c] = Set(mat[r][c]);
+
+            for (; i + SR_BATCH_LANES <= count; i += SR_BATCH_LANES)
+            {
+                const Lanes x = Load(xs + i), y = Load(ys + i), z = Load(zs + i);
+
+                const Lanes w = Add(Add(Add(Mul(x, m[0][3]), Mul(y, m[1][3])), Mul(z, m[2][3])), m[3][3]);
+                if (outW) Store(outW + i, w);
+
+                Store(outX + i, Div(Add(Add(Add(Mul(x, m[0][0]), Mul(y, m[1][0])), Mul(z, m[2][0])), m[3][0]), w));
+                Store(outY + i, Div(Add(Add(Add(Mul(x, m[0][1]), Mul(y, m[1][1])), Mul(z, m[2][1])), m[3][1]), w));
+                Store(outZ + i, Div(Add(Add(Add(Mul(x, m[0][2]), Mul(y, m[1][2])), Mul(z, m[2][2])), m[3][2]), w));
+            }
+        #endif
+
+        for (; i < count; i++)
+        {
+            const float x = xs[i], y = ys[i], z = zs[i];
+
+            const float w = ((x * mat[0][3] + y * mat[1][3]) + z * mat[2][3]) + mat[3][3];
+            if (outW) outW[i] = w;
+
+            outX[i] = (((x * mat[0][0] + y * mat[1][0]) + z * mat[2][0]) + mat[3][0]) / w;
+            outY[i] = (((x * mat[0][1] + y * mat[1][1]) + z * mat[2][1]) + mat[3][1]) / w;
+            outZ[i] = (((x * mat[0][2] + y * mat[1][2]) + z * mat[2][2]) + mat[3][2]) / w;
+        }
+    }
+
+    // Normals through the inverse transpose of 'mat' (computed once here), so non uniform scale keeps them
+    // perpendicular to their surface. Renormalized unless told otherwise.
+    static inline void TransformNormals(const Matrix4x4<float> &mat, const float* xs, const float* ys, const float* zs,
+                                 float* outX, float* outY, float* outZ, size_t count, bool normalize = true)
+    {
+        const Matrix4x4<float> normalMat = mat.InvertedAffine().Transposed();
+
+        size_t i = 0;
+
+        #ifdef SR_BATCH_LANES
+            using namespace lanes;
+
+            Lanes m[3][3];
+            for (int r = 0; r < 3; r++)
+                for (int c = 0; c < 3; c++)
+                    m[r][c] = Set(normalMat[r][c]);
+
+            const Lanes one = Set(1.0f);
+
+            for (; i + SR_BATCH_LANES <= count; i += SR_BATCH_LANES)
+            {
+                const Lanes x = Load(xs + i), y = Load(ys + i), z = Load(zs + i);
+
+                Lanes nx = Add(Add(Mul(x, m[0][0]), Mul(y, m[1][0])), Mul(z, m[2][0]));
+                Lanes ny = Add(Add(Mul(x, m[0][1]), Mul(y, m[1][1])), Mul(z, m[2][1]));
+                Lanes nz = Add(Add(Mul(x, m[0][2]), Mul(y, m[1][2])), Mul(z, m[2][2]));
+
+                if (normalize)
+                {
+                    const Lanes invLength = Div(one, Sqrt(Add(Add(Mul(nx, nx), Mul(ny, ny)), Mul(nz, nz))));
+                    nx = Mul(nx, invLength);
+                    ny = Mul(ny, invLength);
+                    nz = Mul(nz, invLength);
+                }
+
+                Store(outX + i, nx);
+                Store(outY + i, ny);
+                Store(outZ + i, nz);
+            }
+        #endif
+
+        for (; i < count; i++)
+        {
+            const float x = xs[i], y = ys[i], z = zs[i];
+
+            float nx = (x * normalMat[0][0] + y * normalMat[1][0]) + z * normalMat[2][0];
+            float ny = (x * normalMat[0][1] + y * normalMat[1][1]) + z * normalMat[2][1];
+            float nz = (x * normalMat[0][2] + y * normalMat[1][2]) + z * normalMat[2][2];
+
+            if (normalize)
+            {
+                const float invLength = 1.0f / std::sqrt((nx * nx + ny * ny) + nz * nz);
+                nx *= invLength;
+                ny *= invLength;
+                nz *= invLength;
+            }
+
+            outX[i] = nx;
+            outY[i] = ny;
+            outZ[i] = nz;
+        }
+    }
+}
@@ -0,0 +1,387 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "SIMD.h"
+#include "MipMaps.h"
+#include "ThreadPool.h"
+
+// BC1 / BC3 / BC7 (mode 6) encoders for RGBA8 images.
+// Endpoints come from the inset bounding box of the block, oriented along the channel covariance,
+// and every texel picks the nearest palette entry (SSE2 across 4 texels at a time).
+
+namespace images
+{
+    enum class BlockFormat { BC1, BC3, BC7 };
+
+    struct BlockLevel
+    {
+        int width, height;
+        size_t offset, size; // Into CompressedImage::blocks
+    };
+
+    struct CompressedImage
+    {
+        BlockFormat format = BlockFormat::BC1;
+        int width = 0, height = 0;   // Of mip 0, even when it wasn't loaded
+        int baseLevel = 0;           // Mip index of levels[0], streamed loads skip the finest ones
+        std::vector<BlockLevel> levels;
+        std::vector<unsigned char> blocks;
+        uint64_t sourceHash = 0; // Content hash of the image it was encoded from, 0 if unknown
+    };
+
+    static inline size_t BlockBytes(BlockFormat format) { return format == BlockFormat::BC1 ? 8 : 16; }
+
+    static inline size_t LevelBytes(BlockFormat format, int width, int height)
+    {
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+    }
+
+    // Texels of one 4x4 block split by channel.
+    struct BlockTexels
+    {
+        alignas(16) float c[4][16];
+    };
+
+    static inline void LoadBlock(const unsigned char* rgba, int width, int height, int bx, int by, BlockTexels* texels)
+    {
+        for (int y = 0; y < 4; y++)
+        {
+            const int sy = std::min(by * 4 + y, height - 1);
+            for (int x = 0; x < 4; x++)
+            {
+                const int sx = std::min(bx * 4 + x, width - 1);
+                const unsigned char* p = rgba + ((size_t)sy * width + sx) * 4;
+
+                for (int c = 0; c < 4; c++) texels->c[c][y * 4 + x] = p[c];
+            }
+        }
+    }
+
+    // Index of the nearest palette entry for each texel, distances weighted per channel.
+    static inline void SelectIndices(const BlockTexels &texels, const float (*palette)[4], int paletteSize, const float weights[4], unsigned char indices[16])
+    {
+        int i = 0;
+
+        #ifdef SR_SSE2
+            for (; i < 16; i += 4)
+            {
+                __m128 best = _mm_set1_ps(3.0e38f);
+                __m128i bestIndex = _mm_setzero_si128();
+
+                for (int k = 0; k < paletteSize; k++)
+                {
+                    __m128 dist = _mm_setzero_ps();
+                    for (int c = 0; c < 4; c++)
+                    {
+                        if (weights[c] == 0) continue;
+
+                        __m128 d = _mm_sub_ps(_mm_load_ps(&texels.c[c][i]), _mm_set1_ps(palette[k][c]));
+                        dist = _mm_add_ps(dist, _mm_mul_ps(_mm_mul_ps(d, d), _mm_set1_ps(weights[c])));
+                    }
+
+                    __m128i closer = _mm_castps_si128(_mm_cmplt_ps(dist, best));
+                    best = _mm_min_ps(dist, best);
+                    bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, bestIndex));
+                }
+
+                alignas(16) int32_t lanes[4];
+                _mm_store_si128((__m128i*)lanes, bestIndex);
+                for (int l = 0; l < 4; l++) indices[i + l] = (unsigned char)lanes[l];
+            }
+        #endif
+
+        for (; i < 16; i++)
+        {
+            float best = 3.0e38f;
+            for (int k = 0; k < paletteSize; k++)
+            {
+                float dist = 0;
+                for (int c = 0; c < 4; c++)
+                {
+                    float d = texels.c[c][i] - palette[k][c];
+                    dist += d * d * weights[c];
+                }
+
+                if (dist < best)
+                {
+                    best = dist;
+                    indices[i] = (unsigned char)k;
+                }
+            }
+        }
+    }
+
+    // Inset bounding box endpoints, flipped per channel when it runs against the dominant channel.
+    static inline void FindEndpoints(const BlockTexels &texels, int channels, float e0[4], float e1[4])
+    {
+        float mean[4] = {}, lo[4], hi[4];
+        int axis = 0;
+
+        for (int c = 0; c < channels; c++)
+        {
+            lo[c] = hi[c] = texels.c[c][0];
+            for (int i = 0; i < 16; i++)
+            {
+                mean[c] += texels.c[c][i];
+                lo[c] = std::min(lo[c], texels.c[c][i]);
+                hi[c] = std::max(hi[c], texels.c[c][i]);
+            }
+            mean[c] /= 16;
+
+            if (hi[c] - lo[c] > hi[axis] - lo[axis]) axis = c;
+        }
+
+        for (int c = 0; c < channels; c++)
+        {
+            float cov = 0;
+            for (int i = 0; i < 16; i++) cov += (texels.c[c][i] - mean[c]) * (texels.c[axis][i] - mean[axis]);
+
+            const float inset = (hi[c] - lo[c]) / 16;
+            e0[c] = hi[c] - inset;
+            e1[c] = lo[c] + inset;
+
+            if (cov < 0) std::swap(e0[c], e1[c]);
+        }
+    }
+
+    static inline uint16_t PackRGB565(const float c[4])
+    {
+        int r = std::min(31, std::max(0, (int)(c[0] * 31 / 255 + 0.5f)));
+        int g = std::min(63, std::max(0, (int)(c[1] * 63 / 255 + 0.5f)));
+        int b = std::min(31, std::max(0, (int)(c[2] * 31 / 255 + 0.5f)));
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    static inline void UnpackRGB565(uint16_t v, float c[4])
+    {
+        int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+        c[0] = (float)((r << 3) | (r >> 2));
+        c[1] = (float)((g << 2) | (g >> 4));
+        c[2] = (float)((b << 3) | (b >> 2));
+        c[3] = 255;
+    }
+
+    static inline void EncodeColorBlock(const BlockTexels &texels, unsigned char out[8])
+    {
+        static const float weights[4] = { 1, 1, 1, 0 };
+
+        float e0[4], e1[4];
+        FindEndpoints(texels, 3, e0, e1);
+
+        uint16_t c0 = PackRGB565(e0), c1 = PackRGB565(e1);
+        if (c0 < c1) std::swap(c0, c1);
+
+        unsigned char indices[16] = {};
+        if (c0 != c1)
+        {
+            float palette[4][4];
+            UnpackRGB565(c0, palette[0]);
+            UnpackRGB565(c1, palette[1]);
+            for (int c = 0; c < 4; c++)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            SelectIndices(texels, palette, 4, weights, indices);
+        }
+
+        uint32_t bits = 0;
+        for (int i = 0; i < 16; i++) bits |= (uint32_t)indices[i] << (i * 2);
+
+        out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+        out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+        memcpy(out + 4, &bits, 4);
+    }
+
+    static inline void EncodeAlphaBlock(const BlockTexels &texels, unsigned char out[8])
+    {
+        static const float weights[4] = { 0, 0, 0, 1 };
+
+        float a0 = texels.c[3][0], a1 = texels.c[3][0];
+        for (int i = 1; i < 16; i++)
+        {
+            a0 = std::max(a0, texels.c[3][i]);
+            a1 = std::min(a1, texels.c[3][i]);
+        }
+
+        const int hi = (int)a0, lo = (int)a1;
+
+        unsigned char indices[16] = {};
+        if (hi != lo)
+        {
+            float palette[8][4] = {};
+            palette[0][3] = (float)hi;
+            palette[1][3] = (float)lo;
+            for (int k = 2; k < 8; k++) palette[k][3] = (float)(((8 - k) * hi + (k - 1) * lo) / 7);
+
+            SelectIndices(texels, palette, 8, weights, indices);
+        }
+
+        uint64_t bits = 0;
+        for (int i = 0; i < 16; i++) bits |= (uint64_t)indices[i] << (i * 3);
+
+        out[0] = (unsigned char)hi;
+        out[1] = (unsigned char)lo;
+        for (int i = 0; i < 6; i++) out[2 + i] = (unsigned char)(bits >> (i * 8));
+    }
+
+    struct BitWriter
+    {
+        unsigned char* bytes;
+        int pos = 0;
+
+        BitWriter(unsigned char* out) : bytes(out) { memset(bytes, 0, 16); }
+
+        void Put(uint32_t value, int count)
+        {
+            for (int i = 0; i < count; i++, pos++)
+                if (value & (1u << i)) bytes[pos >> 3] |= (unsigned char)(1u << (pos & 7));
+        }
+    };
+
+    // Mode 6: one subset, RGBA 7.7.7.7 endpoints with a unique p-bit each and 4 bit indices.
+    static inline void EncodeBC7Block(const BlockTexels &texels, unsigned char out[16])
+    {
+        static const float weights[4] = { 1, 1, 1, 1 };
+        static const int interpolation[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        float e[2][4];
+        FindEndpoints(texels, 4, e[0], e[1]);
+
+        int q[2][4], p[2];
+        for (int n = 0; n < 2; n++)
+        {
+            float bestErr = 3.0e38f;
+            for (int bit = 0; bit < 2; bit++)
+            {
+                int candidate[4];
+                float err = 0;
+                for (int c = 0; c < 4; c++)
+                {
+                    candidate[c] = std::min(127, std::max(0, (int)((e[n][c] - bit) / 2 + 0.5f)));
+                    float d = (float)(candidate[c] * 2 + bit) - e[n][c];
+                    err += d * d;
+                }
+
+                if (err < bestErr)
+                {
+                    bestErr = err;
+                    p[n] = bit;
+                    memcpy(q[n], candidate, sizeof(candidate));
+                }
+            }
+        }
+
+        float palette[16][4];
+        for (int k = 0; k < 16; k++)
+            for (int c = 0; c < 4; c++)
+            {
+                int v0 = q[0][c] * 2 + p[0], v1 = q[1][c] * 2 + p[1];
+                palette[k][c] = (float)(((64 - interpolation[k]) * v0 + interpolation[k] * v1 + 32) >> 6);
+            }
+
+        unsigned char indices[16];
+        SelectIndices(texels, palette, 16, weights, indices);
+
+        // The anchor index is stored without its top bit, keep it below 8 by swapping the endpoints
+        if (indices[0] & 8)
+        {
+            std::swap(q[0], q[1]);
+            std::swap(p[0], p[1]);
+            for (int i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+        }
+
+        BitWriter bits(out);
+        bits.Put(1 << 6, 7);
+        for (int c = 0; c < 4; c++)
+        {
+            bits.Put(q[0][c], 7);
+            bits.Put(q[1][c], 7);
+        }
+        bits.Put(p[0], 1);
+        bits.Put(p[1], 1);
+
+        bits.Put(indices[0], 3);
+        for (int i = 1; i < 16; i++) bits.Put(indices[i], 4);
+    }
+
+    static inline void EncodeBlock(BlockFormat format, const BlockTexels &texels, unsigned char* out)
+    {
+        switch (format)
+        {
+            case BlockFormat::BC1:
+                EncodeColorBlock(texels, out);
+                break;
+            case BlockFormat::BC3:
+                EncodeAlphaBlock(texels, out);
+                EncodeColorBlock(texels, out + 8);
+                break;
+            case BlockFormat::BC7:
+                EncodeBC7Block(texels, out);
+                break;
+        }
+    }
+
+    static inline void CompressLevel(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* out, ThreadPool* pool)
+    {
+        const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        const size_t blockBytes = BlockBytes(format);
+
+        auto encodeRow = [&](size_t by)
+        {
+            BlockTexels texels;
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                LoadBlock(rgba, width, height, bx, (int)by, &texels);
+                EncodeBlock(format, texels, out + (by * blocksX + bx) * blockBytes);
+            }
+        };
+
+        if (pool) pool->ParallelFor(blocksY, encodeRow);
+        else for (int by = 0; by < blocksY; by++) encodeRow(by);
+    }
+
+    static inline bool HasAlpha(const unsigned char* rgba, int width, int height)
+    {
+        for (size_t i = 0, n = (size_t)width * height; i < n; i++)
+            if (rgba[i * 4 + 3] != 255) return true;
+
+        return false;
+    }
+
+    // Compresses level 0 plus its mip chain (if any) into 'image', block rows are spread over 'pool'.
+    static inline void CompressImage(BlockFormat format, const unsigned char* level0, int width, int height, const MipChain* mips, CompressedImage* image, ThreadPool* pool = nullptr)
+    {
+        image->format = format;
+        image->width = width;
+        image->height = height;
+        image->baseLevel = 0;
+        image->levels.clear();
+
+        size_t total = 0;
+        image->levels.push_back({ width, height, total, LevelBytes(format, width, height) });
+        total += image->levels.back().size;
+
+        if (mips)
+            for (auto const &level : mips->levels)
+            {
+                image->levels.push_back({ level.width, level.height, total, LevelBytes(format, level.width, level.height) });
+                total += image->levels.back().size;
+            }
+
+        image->blocks.resize(total);
+
+        for (size_t i = 0; i < image->levels.size(); i++)
+        {
+            const BlockLevel &level = image->levels[i];
+            const unsigned char* src = i == 0 ? level0 : mips->pixels.data() + mips->levels[i - 1].offset;
+
+            CompressLevel(format, src, level.width, level.height, image->blocks.data() + level.offset, pool);
+        }
+    }
+}
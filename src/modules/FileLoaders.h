@@ -1,3 +1,5 @@
+#pragma once
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -5,10 +7,13 @@
 #include <map>
 #include <vector>
 
+#include "AssetPackage.h"
+#include "BlockCompression.h"
+
 
 namespace fLoaders
 {
-    static const std::string GetFileExt(const char* path)
+    static inline const std::string GetFileExt(const char* path)
     {
         const std::string p(path);
         std::size_t extBegin = p.find_last_of(".");
@@ -22,7 +27,7 @@ namespace fLoaders
 
     typedef std::map<std::string, unsigned int> AttribsIndex;
 
-    static bool OBJLoader(const char* path, std::vector<float>* vertsPtr, std::vector<unsigned int>* trisPtr, unsigned int* vertexCount, unsigned int* triCount)
+    static inline bool OBJLoader(const char* path, std::vector<float>* vertsPtr, std::vector<unsigned int>* trisPtr, unsigned int* vertexCount, unsigned int* triCount)
     {
         if (GetFileExt(path) != "obj")
         {
@@ -30,8 +35,9 @@ namespace fLoaders
             return false;
         }
 
-        std::ifstream obj(path); // FILE CONTENT
-        if (!obj)
+        assets::Span obj; // FILE CONTENT
+        std::vector<unsigned char> objStorage;
+        if (!assets::ReadAsset(path, &obj, &objStorage))
         {
             std::cout << "[OBJLoader] Couldn't load the expecify file (.\\" << path << ")." << std::endl;
             return false;
@@ -45,8 +51,16 @@ namespace fLoaders
         // Iterate over the content of the .obj file an extract vertex coords (v), UVs (vt), vertex normals (vn), and faces (f)
         // TODO - Get polygon/group name. Handle groups.
         std::string line;
-        while (std::getline(obj, line))
+        const char* cursor = (const char*)obj.data;
+        const char* end = cursor + obj.size;
+        while (cursor < end)
         {
+            const char* eol = (const char*)memchr(cursor, '\n', end - cursor);
+            if (!eol) eol = end;
+
+            line.assign(cursor, (eol > cursor && eol[-1] == '\r') ? eol - 1 : eol);
+            cursor = eol + 1;
+
             if (line.substr(0,2) == "vt")
             {
                 float u, v;
@@ -159,4 +173,208 @@ namespace fLoaders
 
         return true; // OBJ Loaded
     }
-}
\ No newline at end of file
+
+    // DDS (DirectDraw Surface) - Block compressed textures, only the formats produced by BlockCompression.h.
+    // Rows are stored bottom-up (GL upload order), as written by DDSWriter.
+
+    #define DDS_MAGIC 0x20534444 // "DDS "
+    #define DDS_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+    #define DDS_SOURCE_HASH_TAG DDS_FOURCC('S', 'R', 'H', '1') // reserved1[0], followed by the hash in reserved1[1..2]
+
+    #define DDS_MAX_DIMENSION 16384 // Past any GL_MAX_TEXTURE_SIZE, larger headers are garbage
+
+    #define DXGI_FORMAT_BC1_UNORM 71
+    #define DXGI_FORMAT_BC3_UNORM 77
+    #define DXGI_FORMAT_BC7_UNORM 98
+
+    struct DDSPixelFormat
+    {
+        uint32_t size, flags, fourCC, rgbBitCount;
+        uint32_t rMask, gMask, bMask, aMask;
+    };
+
+    struct DDSHeader
+    {
+        uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount;
+        uint32_t reserved1[11];
+        DDSPixelFormat pixelFormat;
+        uint32_t caps, caps2, caps3, caps4, reserved2;
+    };
+
+    struct DDSHeaderDX10
+    {
+        uint32_t dxgiFormat, resourceDimension, miscFlag, arraySize, miscFlags2;
+    };
+
+    // 'maxDimension' skips the levels larger than it (the last one is always kept), 0 loads them all.
+    // Packaged files are used in place. Loose ones only have their headers read, then the levels that are kept.
+    static inline bool DDSLoader(const char* path, images::CompressedImage* image, int maxDimension = 0)
+    {
+        unsigned char head[4 + sizeof(DDSHeader) + sizeof(DDSHeaderDX10)] = {};
+        size_t fileSize;
+
+        assets::Span dds;
+        std::ifstream file;
+        const bool packaged = assets::AssetPackage::Default().Find(path, &dds);
+        if (packaged)
+        {
+            fileSize = dds.size;
+            memcpy(head, dds.data, std::min(fileSize, sizeof(head)));
+        }
+        else
+        {
+            file.open(path, std::ios::binary | std::ios::ate);
+            if (!file) return false;
+
+            fileSize = (size_t)file.tellg();
+            file.seekg(0);
+            file.read((char*)head, std::min(fileSize, sizeof(head)));
+            if (!file) return false;
+        }
+
+        uint32_t magic;
+        memcpy(&magic, head, sizeof(magic));
+        if (fileSize < 4 + sizeof(DDSHeader) || magic != DDS_MAGIC)
+        {
+            std::cout << "[DDSLoader] Not a .dds file (.\\" << path << ")." << std::endl;
+            return false;
+        }
+
+        DDSHeader header;
+        memcpy(&header, head + 4, sizeof(header));
+        size_t offset = 4 + sizeof(DDSHeader);
+
+        const uint32_t fourCC = header.pixelFormat.fourCC;
+        if (fourCC == DDS_FOURCC('D', 'X', 'T', '1')) image->format = images::BlockFormat::BC1;
+        else if (fourCC == DDS_FOURCC('D', 'X', 'T', '5')) image->format = images::BlockFormat::BC3;
+        else if (fourCC == DDS_FOURCC('D', 'X', '1', '0') && fileSize >= offset + sizeof(DDSHeaderDX10))
+        {
+            DDSHeaderDX10 dx10;
+            memcpy(&dx10, head + offset, sizeof(dx10));
+            offset += sizeof(DDSHeaderDX10);
+
+            if (dx10.dxgiFormat == DXGI_FORMAT_BC1_UNORM) image->format = images::BlockFormat::BC1;
+            else if (dx10.dxgiFormat == DXGI_FORMAT_BC3_UNORM) image->format = images::BlockFormat::BC3;
+            else if (dx10.dxgiFormat == DXGI_FORMAT_BC7_UNORM) image->format = images::BlockFormat::BC7;
+            else return false;
+        }
+        else
+        {
+            std::cout << "[DDSLoader] Unsupported pixel format (.\\" << path << ")." << std::endl;
+            return false;
+        }
+
+        if (header.width == 0 || header.height == 0 || header.width > DDS_MAX_DIMENSION || header.height > DDS_MAX_DIMENSION)
+        {
+            std::cout << "[DDSLoader] Invalid size " << header.width << "x" << header.height << " (.\\" << path << ")." << std::endl;
+            return false;
+        }
+
+        image->width = (int)header.width;
+        image->height = (int)header.height;
+        image->baseLevel = 0;
+        image->levels.clear();
+
+        image->sourceHash = 0;
+        if (header.reserved1[0] == DDS_SOURCE_HASH_TAG)
+            image->sourceHash = (uint64_t)header.reserved1[1] | ((uint64_t)header.reserved1[2] << 32);
+
+        // A count past the 1x1 level would only describe more 1x1 levels
+        const int levelCount = (int)std::min(std::max(1u, header.mipMapCount), (uint32_t)images::MipCount(image->width, image->height));
+
+        int w = image->width, h = image->height;
+        size_t total = 0;
+        for (int i = 0; i < levelCount; i++)
+        {
+            image->levels.push_back({ w, h, total, images::LevelBytes(image->format, w, h) });
+            total += image->levels.back().size;
+
+            w = std::max(1, w / 2);
+            h = std::max(1, h / 2);
+        }
+
+        if (fileSize < offset + total)
+        {
+            std::cout << "[DDSLoader] Truncated file (.\\" << path << ")." << std::endl;
+            return false;
+        }
+
+        if (maxDimension > 0)
+        {
+            while (image->baseLevel + 1 < (int)image->levels.size()
+                   && std::max(image->levels[image->baseLevel].width, image->levels[image->baseLevel].height) > maxDimension)
+                image->baseLevel++;
+
+            const size_t skipped = image->levels[image->baseLevel].offset;
+            image->levels.erase(image->levels.begin(), image->levels.begin() + image->baseLevel);
+            for (auto &level : image->levels) level.offset -= skipped;
+
+            offset += skipped;
+            total -= skipped;
+        }
+
+        if (packaged)
+        {
+            image->blocks.assign(dds.data + offset, dds.data + offset + total);
+            return true;
+        }
+
+        image->blocks.resize(total);
+        file.seekg(offset);
+        file.read((char*)image->blocks.data(), total);
+        return (bool)file;
+    }
+
+    static inline bool DDSWriter(const char* path, const images::CompressedImage &image)
+    {
+        if (image.baseLevel != 0)
+        {
+            std::cout << "[DDSWriter] Image is missing its finest levels (.\\" << path << ")." << std::endl;
+            return false;
+        }
+
+        std::ofstream dds(path, std::ios::binary | std::ios::trunc);
+        if (!dds)
+        {
+            std::cout << "[DDSWriter] Couldn't create the file (.\\" << path << ")." << std::endl;
+            return false;
+        }
+
+        DDSHeader header = {};
+        header.size = sizeof(DDSHeader);
+        header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // CAPS | HEIGHT | WIDTH | PIXELFORMAT | MIPMAPCOUNT | LINEARSIZE
+        header.height = image.height;
+        header.width = image.width;
+        header.pitchOrLinearSize = (uint32_t)image.levels[0].size;
+        header.depth = 1;
+        header.mipMapCount = (uint32_t)image.levels.size();
+        header.reserved1[0] = DDS_SOURCE_HASH_TAG;
+        header.reserved1[1] = (uint32_t)image.sourceHash;
+        header.reserved1[2] = (uint32_t)(image.sourceHash >> 32);
+        header.pixelFormat.size = sizeof(DDSPixelFormat);
+        header.pixelFormat.flags = 0x4; // FOURCC
+        header.caps = 0x1000 | (image.levels.size() > 1 ? 0x400008 : 0); // TEXTURE (| MIPMAP | COMPLEX)
+
+        DDSHeaderDX10 dx10 = {};
+        switch (image.format)
+        {
+            case images::BlockFormat::BC1: header.pixelFormat.fourCC = DDS_FOURCC('D', 'X', 'T', '1'); break;
+            case images::BlockFormat::BC3: header.pixelFormat.fourCC = DDS_FOURCC('D', 'X', 'T', '5'); break;
+            case images::BlockFormat::BC7:
+                header.pixelFormat.fourCC = DDS_FOURCC('D', 'X', '1', '0');
+                dx10.dxgiFormat = DXGI_FORMAT_BC7_UNORM;
+                dx10.resourceDimension = 3; // TEXTURE2D
+                dx10.arraySize = 1;
+                break;
+        }
+
+        const uint32_t magic = DDS_MAGIC;
+        dds.write((const char*)&magic, sizeof(magic));
+        dds.write((const char*)&header, sizeof(header));
+        if (image.format == images::BlockFormat::BC7) dds.write((const char*)&dx10, sizeof(dx10));
+        dds.write((const char*)image.blocks.data(), image.blocks.size());
+
+        return (bool)dds;
+    }
+}
@@ -0,0 +1,376 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <type_traits>
+
+#include "SIMD.h"
+#include "LinearAlgebra.h"
+#include "BatchTransform.h"
+#include "Vector3Stream.h"
+
+// Bounding volumes and the planes to test them against. Everything follows the row vector convention of
+// LinearAlgebra.h: points go through matrices as p * M.
+
+#define RAY_T_MIN 1e-6
+#define RAY_DET_EPSILON 1e-12
+
+enum class Containment : uint8_t { Outside = 0, Intersecting = 1, Inside = 2 };
+
+template<typename T>
+struct AABB
+{
+    public:
+        Vector3<T> min, max;
+
+        AABB() { }
+        AABB(const Vector3<T> &min, const Vector3<T> &max) : min(min), max(max) { }
+
+        static AABB FromCenterExtents(const Vector3<T> &center, const Vector3<T> &extents) { return AABB(center - extents, center + extents); }
+        static AABB FromPoints(const Vector3Stream<T> &points)
+        {
+            AABB box;
+            points.MinMax(&box.min, &box.max);
+            return box;
+        }
+
+        inline Vector3<T> Center() const { return (min + max) * T(0.5); }
+        inline Vector3<T> Extents() const { return (max - min) * T(0.5); }
+        inline Vector3<T> Size() const { return max - min; }
+
+        void Expand(const Vector3<T> &point)
+        {
+            min = Vector3<T>(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+            max = Vector3<T>(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+        }
+        void Expand(const AABB &box) { Expand(box.min); Expand(box.max); }
+
+        inline bool Contains(const Vector3<T> &p) const
+        {
+            return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y && p.z >= min.z && p.z <= max.z;
+        }
+        inline bool Overlaps(const AABB &box) const
+        {
+            return min.x <= box.max.x && max.x >= box.min.x && min.y <= box.max.y && max.y >= box.min.y && min.z <= box.max.z && max.z >= box.min.z;
+        }
+
+        // Tight box around this one once moved by an affine matrix (Arvo): the center goes through the
+        // matrix, the extents through its absolute values.
+        AABB Transformed(const Matrix4x4<T> &mat) const
+        {
+            const Vector3<T> c = Center(), e = Extents();
+
+            Vector3<T> center(mat[3][0], mat[3][1], mat[3][2]), extents;
+            const T cs[3] = { c.x, c.y, c.z }, es[3] = { e.x, e.y, e.z };
+            for (int i = 0; i < 3; i++)
+            {
+                center.x += cs[i] * mat[i][0]; extents.x += es[i] * std::abs(mat[i][0]);
+                center.y += cs[i] * mat[i][1]; extents.y += es[i] * std::abs(mat[i][1]);
+                center.z += cs[i] * mat[i][2]; extents.z += es[i] * std::abs(mat[i][2]);
+            }
+
+            return FromCenterExtents(center, extents);
+        }
+
+        inline friend std::ostream& operator<<(std::ostream &s, const AABB &b) { return s << "[" << b.min << " - " << b.max << "]"; }
+};
+
+template<typename T>
+struct Sphere
+{
+    public:
+        Vector3<T> center;
+        T radius;
+
+        Sphere() : radius(T(0)) { }
+        Sphere(const Vector3<T> &center, T radius) : center(center), radius(radius) { }
+
+        // Encloses the box, not the tightest sphere around the points inside it.
+        static Sphere FromAABB(const AABB<T> &box) { return Sphere(box.Center(), box.Extents().Magnitud()); }
+
+        inline bool Contains(const Vector3<T> &p) const { const Vector3<T> d = p - center; return Vector3<T>::Dot(d, d) <= radius * radius; }
+        inline bool Overlaps(const Sphere &s) const
+        {
+            const Vector3<T> d = s.center - center;
+            return Vector3<T>::Dot(d, d) <= (radius + s.radius) * (radius + s.radius);
+        }
+
+        // Moved by an affine matrix, the radius grows with the largest axis scale.
+        Sphere Transformed(const Matrix4x4<T> &mat) const
+        {
+            const T sx = Vector3<T>(mat[0][0], mat[0][1], mat[0][2]).Magnitud();
+            const T sy = Vector3<T>(mat[1][0], mat[1][1], mat[1][2]).Magnitud();
+            const T sz = Vector3<T>(mat[2][0], mat[2][1], mat[2][2]).Magnitud();
+
+            const Vector3<T> c(
+                center.x * mat[0][0] + center.y * mat[1][0] + center.z * mat[2][0] + mat[3][0],
+                center.x * mat[0][1] + center.y * mat[1][1] + center.z * mat[2][1] + mat[3][1],
+                center.x * mat[0][2] + center.y * mat[1][2] + center.z * mat[2][2] + mat[3][2]
+            );
+            return Sphere(c, radius * std::max(sx, std::max(sy, sz)));
+        }
+
+        inline friend std::ostream& operator<<(std::ostream &s, const Sphere &sp) { return s << "[" << sp.center << ", r " << sp.radius << "]"; }
+};
+
+// Points p with Dot(normal, p) + d >= 0 are in front of (inside) the plane.
+template<typename T>
+struct Plane
+{
+    public:
+        Vector3<T> normal;
+        T d;
+
+        Plane() : normal(T(0), T(1), T(0)), d(T(0)) { }
+        Plane(const Vector3<T> &normal, T d) : normal(normal), d(d) { }
+        Plane(T a, T b, T c, T d) : normal(a, b, c), d(d) { }
+
+        static Plane FromPointNormal(const Vector3<T> &point, const Vector3<T> &normal)
+        {
+            const Vector3<T> n = normal.Normalized();
+            return Plane(n, -Vector3<T>::Dot(n, point));
+        }
+        // Counter clockwise a, b, c seen from the front.
+        static Plane FromPoints(const Vector3<T> &a, const Vector3<T> &b, const Vector3<T> &c)
+        {
+            return FromPointNormal(a, Vector3<T>::Cross(b - a, c - a));
+        }
+
+        inline T Distance(const Vector3<T> &p) const { return Vector3<T>::Dot(normal, p) + d; }
+
+        Plane Normalized() const
+        {
+            const T mag = normal.Magnitud();
+            return Plane(normal / mag, d / mag);
+        }
+
+        inline friend std::ostream& operator<<(std::ostream &s, const Plane &p) { return s << "[" << p.normal << ", " << p.d << "]"; }
+};
+
+template<typename T>
+struct Ray
+{
+    public:
+        Vector3<T> origin, direction;
+
+        Ray() : direction(T(0), T(0), T(-1)) { }
+        Ray(const Vector3<T> &origin, const Vector3<T> &direction) : origin(origin), direction(direction) { }
+
+        inline Vector3<T> At(T t) const { return origin + direction * t; }
+
+        // Moller-Trumbore against the triangle v0, v0 + edge1, v0 + edge2, either winding. Hits count when
+        // RAY_T_MIN < t < tMax; (u, v) are the barycentrics of edge1 and edge2. The batch kernels run the
+        // same operations in the same order, so they report the same bits.
+        bool IntersectTriangle(const Vector3<T> &v0, const Vector3<T> &edge1, const Vector3<T> &edge2, T tMax, T* t, T* u, T* v) const
+        {
+            const Vector3<T> &d = direction;
+
+            const T px = d.y * edge2.z - d.z * edge2.y, py = d.z * edge2.x - d.x * edge2.z, pz = d.x * edge2.y - d.y * edge2.x;
+            const T det = (edge1.x * px + edge1.y * py) + edge1.z * pz;
+            if (det < T(RAY_DET_EPSILON) && det > -T(RAY_DET_EPSILON)) return false;
+            const T invDet = T(1) / det;
+
+            const T tx = origin.x - v0.x, ty = origin.y - v0.y, tz = origin.z - v0.z;
+            const T hitU = ((tx * px + ty * py) + tz * pz) * invDet;
+            if (hitU < 0 || hitU > 1) return false;
+
+            const T qx = ty * edge1.z - tz * edge1.y, qy = tz * edge1.x - tx * edge1.z, qz = tx * edge1.y - ty * edge1.x;
+            const T hitV = ((d.x * qx + d.y * qy) + d.z * qz) * invDet;
+            if (hitV < 0 || hitU + hitV > 1) return false;
+
+            const T hitT = ((edge2.x * qx + edge2.y * qy) + edge2.z * qz) * invDet;
+            if (!(hitT > T(RAY_T_MIN)) || !(hitT < tMax)) return false;
+
+            *t = hitT; *u = hitU; *v = hitV;
+            return true;
+        }
+
+        inline friend std::ostream& operator<<(std::ostream &s, const Ray &r) { return s << "[" << r.origin << " -> " << r.direction << "]"; }
+};
+
+enum FrustumPlane { FRUSTUM_LEFT, FRUSTUM_RIGHT, FRUSTUM_BOTTOM, FRUSTUM_TOP, FRUSTUM_NEAR, FRUSTUM_FAR, FRUSTUM_PLANES };
+
+// Six inward facing, normalized planes.
+template<typename T>
+struct Frustum
+{
+    public:
+        Plane<T> planes[FRUSTUM_PLANES];
+
+        // Gribb & Hartmann, from a world to clip matrix such as Chain(WorldToCamera(), ProjectionMatrix()).
+        // GL clip space (-w <= x, y, z <= w); with row vectors each clip coordinate is a column.
+        static Frustum FromMatrix(const Matrix4x4<T> &mat)
+        {
+            auto column = [&mat](int c, T sign) {
+                return Plane<T>(mat[0][3] + sign * mat[0][c], mat[1][3] + sign * mat[1][c], mat[2][3] + sign * mat[2][c], mat[3][3] + sign * mat[3][c]);
+            };
+
+            Frustum frustum;
+            frustum.planes[FRUSTUM_LEFT] = column(0, T(1)).Normalized();
+            frustum.planes[FRUSTUM_RIGHT] = column(0, T(-1)).Normalized();
+            frustum.planes[FRUSTUM_BOTTOM] = column(1, T(1)).Normalized();
+            frustum.planes[FRUSTUM_TOP] = column(1, T(-1)).Normalized();
+            frustum.planes[FRUSTUM_NEAR] = column(2, T(1)).Normalized();
+            frustum.planes[FRUSTUM_FAR] = column(2, T(-1)).Normalized();
+            return frustum;
+        }
+
+        inline bool Contains(const Vector3<T> &p) const
+        {
+            for (const Plane<T> &plane : planes)
+                if (plane.Distance(p) < 0) return false;
+            return true;
+        }
+
+        // Same arithmetic, in the same order, as batch::ClassifyAABBs.
+        Containment Classify(const Vector3<T> &center, const Vector3<T> &extents) const
+        {
+            bool inside = true;
+            for (const Plane<T> &plane : planes)
+            {
+                const T distance = ((center.x * plane.normal.x + center.y * plane.normal.y) + center.z * plane.normal.z) + plane.d;
+                const T radius = (extents.x * std::abs(plane.normal.x) + extents.y * std::abs(plane.normal.y)) + extents.z * std::abs(plane.normal.z);
+
+                if (distance + radius < 0) return Containment::Outside;
+                if (distance - radius < 0) inside = false;
+            }
+            return inside ? Containment::Inside : Containment::Intersecting;
+        }
+        inline Containment Classify(const AABB<T> &box) const { return Classify(box.Center(), box.Extents()); }
+
+        // Same arithmetic, in the same order, as batch::ClassifySpheres.
+        Containment Classify(const Sphere<T> &sphere) const
+        {
+            bool inside = true;
+            for (const Plane<T> &plane : planes)
+            {
+                const T distance = ((sphere.center.x * plane.normal.x + sphere.center.y * plane.normal.y) + sphere.center.z * plane.normal.z) + plane.d;
+
+                if (distance + sphere.radius < 0) return Containment::Outside;
+                if (distance - sphere.radius < 0) inside = false;
+            }
+            return inside ? Containment::Inside : Containment::Intersecting;
+        }
+};
+
+namespace batch
+{
+    #ifdef SR_BATCH_LANES
+        // Four lanes of outside / partial bits (low and high nibble of the index) to four Containment bytes
+        struct ContainmentTable
+        {
+            uint32_t bytes[256];
+
+            constexpr ContainmentTable() : bytes()
+            {
+                for (unsigned index = 0; index < 256; index++)
+                    for (unsigned lane = 0; lane < 4; lane++)
+                    {
+                        const unsigned outside = (index >> lane) & 1, partial = (index >> (lane + 4)) & 1;
+                        const unsigned value = outside ? (unsigned)Containment::Outside : partial ? (unsigned)Containment::Intersecting : (unsigned)Containment::Inside;
+                        bytes[index] |= value << (lane * 8);
+                    }
+            }
+        };
+
+        static inline void WriteContainment(unsigned outside, unsigned partial, Containment* out)
+        {
+            static constexpr ContainmentTable table;
+            for (int lane = 0; lane < SR_BATCH_LANES; lane += 4)
+            {
+                const uint32_t bytes = table.bytes[((outside >> lane) & 0xF) | (((partial >> lane) & 0xF) << 4)];
+                memcpy(out + lane, &bytes, 4);
+            }
+        }
+    #endif
+
+    // Boxes as SoA center / extent streams against a frustum, one Containment per box in 'out'. A register
+    // of boxes (16 with AVX-512, 8 with AVX, 4 with SSE2) goes through the six planes at once, the result
+    // matches Frustum::Classify box by box.
+    static inline void ClassifyAABBs(const Frustum<float> &frustum, const float* cx, const float* cy, const float* cz,
+                              const float* ex, const float* ey, const float* ez, Containment* out, size_t count)
+    {
+        size_t i = 0;
+
+        #ifdef SR_BATCH_LANES
+            using namespace lanes;
+
+            Lanes n[FRUSTUM_PLANES][4], a[FRUSTUM_PLANES][3];
+            for (int p = 0; p < FRUSTUM_PLANES; p++)
+            {
+                const Plane<float> &plane = frustum.planes[p];
+                n[p][0] = Set(plane.normal.x); n[p][1] = Set(plane.normal.y); n[p][2] = Set(plane.normal.z); n[p][3] = Set(plane.d);
+                a[p][0] = Set(std::abs(plane.normal.x)); a[p][1] = Set(std::abs(plane.normal.y)); a[p][2] = Set(std::abs(plane.normal.z));
+            }
+            const Lanes zero = Set(0.0f);
+
+            for (; i + SR_BATCH_LANES <= count; i += SR_BATCH_LANES)
+            {
+                const Lanes x = Load(cx + i), y = Load(cy + i), z = Load(cz + i);
+                const Lanes w = Load(ex + i), h = Load(ey + i), dp = Load(ez + i);
+
+                unsigned outside = 0, partial = 0;
+                for (int p = 0; p < FRUSTUM_PLANES; p++)
+                {
+                    const Lanes distance = Add(Add(Add(Mul(x, n[p][0]), Mul(y, n[p][1])), Mul(z, n[p][2])), n[p][3]);
+                    const Lanes radius = Add(Add(Mul(w, a[p][0]), Mul(h, a[p][1])), Mul(dp, a[p][2]));
+
+                    outside |= LessMask(Add(distance, radius), zero);
+                    partial |= LessMask(Sub(distance, radius), zero);
+                }
+
+                WriteContainment(outside, partial, out + i);
+            }
+        #endif
+
+        // Counted down, 'i < count' trips -Waggressive-loop-optimizations once a constant count is inlined
+        for (size_t left = count - i; left--; i++)
+            out[i] = frustum.Classify(Vector3<float>(cx[i], cy[i], cz[i]), Vector3<float>(ex[i], ey[i], ez[i]));
+    }
+
+    static inline void ClassifyAABBs(const Frustum<float> &frustum, const Vector3Stream<float> &centers, const Vector3Stream<float> &extents, Containment* out)
+    {
+        ClassifyAABBs(frustum, centers.get_x(), centers.get_y(), centers.get_z(), extents.get_x(), extents.get_y(), extents.get_z(), out, centers.size());
+    }
+
+    // Spheres as SoA center / radius streams, same layout of results as ClassifyAABBs.
+    static inline void ClassifySpheres(const Frustum<float> &frustum, const float* cx, const float* cy, const float* cz,
+                                const float* radii, Containment* out, size_t count)
+    {
+        size_t i = 0;
+
+        #ifdef SR_BATCH_LANES
+            using namespace lanes;
+
+            Lanes n[FRUSTUM_PLANES][4];
+            for (int p = 0; p < FRUSTUM_PLANES; p++)
+            {
+                const Plane<float> &plane = frustum.planes[p];
+                n[p][0] = Set(plane.normal.x); n[p][1] = Set(plane.normal.y); n[p][2] = Set(plane.normal.z); n[p][3] = Set(plane.d);
+            }
+            const Lanes zero = Set(0.0f);
+
+            for (; i + SR_BATCH_LANES <= count; i += SR_BATCH_LANES)
+            {
+                const Lanes x = Load(cx + i), y = Load(cy + i), z = Load(cz + i), radius = Load(radii + i);
+
+                unsigned outside = 0, partial = 0;
+                for (int p = 0; p < FRUSTUM_PLANES; p++)
+                {
+                    const Lanes distance = Add(Add(Add(Mul(x, n[p][0]), Mul(y, n[p][1])), Mul(z, n[p][2])), n[p][3]);
+
+                    outside |= LessMask(Add(distance, radius), zero);
+                    partial |= LessMask(Sub(distance, radius), zero);
+                }
+
+                WriteContainment(outside, partial, out + i);
+            }
+        #endif
+
+        for (size_t left = count - i; left--; i++)
+            out[i] = frustum.Classify(Sphere<float>(Vector3<float>(cx[i], cy[i], cz[i]), radii[i]));
+    }
+}
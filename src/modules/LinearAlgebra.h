@@ -3,6 +3,10 @@
 #include <iostream>
 #include <iomanip>
 #include <cmath>
+#include <type_traits>
+
+#include "SIMD.h"
+#include "FastMath.h"
 
 #define DEG2RAD 0.01745329251994329576923690768489
 #define RAD2DEG 57.295779513082320876798154814105
@@ -18,7 +22,7 @@ class Vector2
 
         inline static T Dot(const Vector2 &vecA, const Vector2 &vecB) { return vecA.x*vecB.x + vecA.y*vecB.y; }
 
-        inline T Magnitud() const { return sqrtf(x * x + y * y); }
+        inline T Magnitud() const { return std::sqrt(x * x + y * y); }
         Vector2 Normalized() const
         { 
             T mag = Magnitud(); 
@@ -89,7 +93,7 @@ class Vector3
             return Vector3(vecA.y * vecB.z - vecA.z * vecB.y, vecA.z * vecB.x - vecA.x * vecB.z, vecA.x * vecB.y - vecA.y * vecB.x);
         }
 
-        inline T Magnitud() const { return sqrtf(x * x + y * y + z * z); }
+        inline T Magnitud() const { return std::sqrt(x * x + y * y + z * z); }
         Vector3 Normalized() const 
         { 
             T mag = Magnitud(); 
@@ -126,22 +130,24 @@ class Vector3
 #define S_MATRIX(sX, sY, sZ) sX,0,0,0,  0,sY,0,0,  0,0,sZ,0,  0,0,0,1
 
 
+// Row vectors (v * M), translation in the last row. Rows are 16 byte aligned so Matrix4x4<float> loads them
+// straight into SSE registers.
 template<typename T>
 class Matrix4x4
 {
     public:
-        T m[4][4] = { {1,0,0,0},{0,1,0,0},{0,0,1,0},{0,0,0,1} };
+        alignas(16) T m[4][4] = { {1,0,0,0},{0,1,0,0},{0,0,1,0},{0,0,0,1} };
 
-        Matrix4x4() { }
+        constexpr Matrix4x4() { }
 
-        Matrix4x4(T scalar)
+        constexpr Matrix4x4(T scalar)
         {
             m[0][0] *= scalar;
             m[1][1] *= scalar;
             m[2][2] *= scalar;
         }
 
-        Matrix4x4(
+        constexpr Matrix4x4(
             T c00, T c01, T c02, T c03, 
             T c10, T c11, T c12, T c13,
             T c20, T c21, T c22, T c23,
@@ -153,7 +159,9 @@ class Matrix4x4
             m[3][0] = c30; m[3][1] = c31; m[3][2] = c32; m[3][3] = c33;
         }
 
-        static Matrix4x4 Multiply(const Matrix4x4 &matA, const Matrix4x4 &matB)
+        // Scalar reference. The SIMD paths of Multiply() add the same products in the same order, so they
+        // match it bit for bit (as long as the compiler doesn't contract it into FMAs, -ffp-contract=off).
+        static constexpr Matrix4x4 MultiplyScalar(const Matrix4x4 &matA, const Matrix4x4 &matB)
         {
             Matrix4x4 nMat;
 
@@ -180,19 +188,89 @@ class Matrix4x4
             return nMat;
         }
 
-        float* toPtr() const
-        { 
-            float* mat = new T[16]{ 
-                m[0][0], m[0][1], m[0][2], m[0][3],
-                m[1][0], m[1][1], m[1][2], m[1][3],
-                m[2][0], m[2][1], m[2][2], m[2][3],
-                m[3][0], m[3][1], m[3][2], m[3][3],
-            };
+        // Each result row is the rows of B weighted by the matching row of A. AVX does two rows per
+        // iteration, SSE2 one. SR_MATRIX_FMA opts into fused multiply-adds, faster but no longer bit exact.
+        static Matrix4x4 Multiply(const Matrix4x4 &matA, const Matrix4x4 &matB)
+        {
+            if constexpr (std::is_same<T, float>::value)
+            {
+                #if defined(SR_AVX)
+                    Matrix4x4 nMat;
+
+                    const __m256 b0 = _mm256_broadcast_ps((const __m128*)matB.m[0]);
+                    const __m256 b1 = _mm256_broadcast_ps((const __m128*)matB.m[1]);
+                    const __m256 b2 = _mm256_broadcast_ps((const __m128*)matB.m[2]);
+                    const __m256 b3 = _mm256_broadcast_ps((const __m128*)matB.m[3]);
+
+                    for (int i = 0; i < 4; i += 2)
+                    {
+                        const __m256 a = _mm256_loadu_ps(matA.m[i]);
+
+                        __m256 row = _mm256_mul_ps(_mm256_permute_ps(a, 0x00), b0);
+                        #if defined(SR_FMA) && defined(SR_MATRIX_FMA)
+                            row = _mm256_fmadd_ps(_mm256_permute_ps(a, 0x55), b1, row);
+                            row = _mm256_fmadd_ps(_mm256_permute_ps(a, 0xAA), b2, row);
+                            row = _mm256_fmadd_ps(_mm256_permute_ps(a, 0xFF), b3, row);
+                        #else
+                            row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_permute_ps(a, 0x55), b1));
+                            row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_permute_ps(a, 0xAA), b2));
+                            row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_permute_ps(a, 0xFF), b3));
+                        #endif
+
+                        _mm256_storeu_ps(nMat.m[i], row);
+                    }
+
+                    return nMat;
+                #elif defined(SR_SSE2)
+                    Matrix4x4 nMat;
+
+                    const __m128 b0 = _mm_load_ps(matB.m[0]);
+                    const __m128 b1 = _mm_load_ps(matB.m[1]);
+                    const __m128 b2 = _mm_load_ps(matB.m[2]);
+                    const __m128 b3 = _mm_load_ps(matB.m[3]);
+
+                    for (int i = 0; i < 4; i++)
+                    {
+                        __m128 row = _mm_mul_ps(_mm_set1_ps(matA.m[i][0]), b0);
+                        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(matA.m[i][1]), b1));
+                        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(matA.m[i][2]), b2));
+                        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(matA.m[i][3]), b3));
+
+                        _mm_store_ps(nMat.m[i], row);
+                    }
 
-            return mat;
+                    return nMat;
+                #endif
+            }
+
+            return MultiplyScalar(matA, matB);
         }
 
-        inline Matrix4x4 Transposed() const
+        // a * b * c * ... in one call, the running product stays in registers once inlined. A row-by-row fused
+        // version was measured to spill and lose to this.
+        template<typename... Rest>
+        static Matrix4x4 Chain(const Matrix4x4 &first, const Matrix4x4 &second, const Rest&... rest)
+        {
+            return Chain(Multiply(first, second), rest...);
+        }
+
+        static inline Matrix4x4 Chain(const Matrix4x4 &last) { return last; }
+
+        // Compile time version of Chain(), constant matrices (axis swaps, unit scales...) fold into one.
+        // Same operation order as MultiplyScalar(), so also the same bits as Chain() at run time.
+        template<typename... Rest>
+        static constexpr Matrix4x4 ChainScalar(const Matrix4x4 &first, const Rest&... rest)
+        {
+            Matrix4x4 nMat = first;
+            for (int i = 0; i < 4; i++) (RowTimes(nMat.m[i], rest), ...);
+            return nMat;
+        }
+
+        // Row major and contiguous, what glUniformMatrix4fv(..., GL_FALSE, ...) expects for our row vectors.
+        inline const T* data() const { return &m[0][0]; }
+        inline T* data() { return &m[0][0]; }
+
+        constexpr Matrix4x4 Transposed() const
         {
             return {
                 m[0][0], m[1][0], m[2][0], m[3][0],
@@ -287,46 +365,107 @@ class Matrix4x4
             return s;
         }
 
-        inline const T* operator[](uint8_t i) const { return(m[i]); }
-        inline T* operator[](uint8_t i) { return(m[i]); }
-
-        template<typename S>
-        Vector3<S> operator*(const Vector3<S> &vec)
+        // Inverse of a rotation plus translation: the transposed rotation, and the translation rotated back.
+        Matrix4x4 InvertedRigid() const
         {
-            Vector3<S> nVec;
-            nVec.x = vec.x * m[0][0] + vec.y * m[1][0] + vec.z * m[2][0];
-            nVec.y = vec.x * m[0][1] + vec.y * m[1][1] + vec.z * m[2][1];
-            nVec.z = vec.x * m[0][2] + vec.y * m[1][2] + vec.z * m[2][2];
+            if constexpr (std::is_same<T, float>::value)
+            {
+                #if defined(SR_SSE2)
+                    Matrix4x4 nMat;
+
+                    __m128 r0 = _mm_load_ps(m[0]), r1 = _mm_load_ps(m[1]), r2 = _mm_load_ps(m[2]);
+                    __m128 r3 = _mm_set_ps(1, 0, 0, 0);
+                    r0 = _mm_and_ps(r0, SIMDMaskXYZ());
+                    r1 = _mm_and_ps(r1, SIMDMaskXYZ());
+                    r2 = _mm_and_ps(r2, SIMDMaskXYZ());
+                    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+                    StoreAffineInverse(&nMat, r0, r1, r2);
+                    return nMat;
+                #endif
+            }
 
-            return nVec;
+            Matrix4x4 nMat;
+            for (int i = 0; i < 3; i++)
+                for (int j = 0; j < 3; j++)
+                    nMat[i][j] = m[j][i];
+
+            for (int j = 0; j < 3; j++)
+                nMat[3][j] = -((m[3][0] * nMat[0][j] + m[3][1] * nMat[1][j]) + m[3][2] * nMat[2][j]);
+
+            return nMat;
         }
-        inline Matrix4x4 operator*(const Matrix4x4 &mat) { return Multiplicar(*this, mat); }
 
-        void operator*=(const Matrix4x4 &matB)
+        // Inverse of any matrix with a (0, 0, 0, 1) last column: the 3x3 part by cofactors, the translation
+        // moved back through it. Returns identity when singular, like Inverted().
+        Matrix4x4 InvertedAffine() const
         {
-            Matrix4x4<float> matA = *this;
+            if constexpr (std::is_same<T, float>::value)
+            {
+                #if defined(SR_SSE2)
+                    const __m128 a0 = _mm_and_ps(_mm_load_ps(m[0]), SIMDMaskXYZ());
+                    const __m128 a1 = _mm_and_ps(_mm_load_ps(m[1]), SIMDMaskXYZ());
+                    const __m128 a2 = _mm_and_ps(_mm_load_ps(m[2]), SIMDMaskXYZ());
+
+                    // Columns of the inverse, before dividing by the determinant
+                    __m128 c0 = SIMDCross(a1, a2), c1 = SIMDCross(a2, a0), c2 = SIMDCross(a0, a1);
+
+                    const __m128 products = _mm_mul_ps(a0, c0);
+                    const float det = (_mm_cvtss_f32(products) + _mm_cvtss_f32(_mm_shuffle_ps(products, products, 0x55))) + _mm_cvtss_f32(_mm_shuffle_ps(products, products, 0xAA));
+                    if (det == 0) return Matrix4x4();
+
+                    const __m128 invDet = _mm_set1_ps(1.0f / det);
+                    c0 = _mm_mul_ps(c0, invDet);
+                    c1 = _mm_mul_ps(c1, invDet);
+                    c2 = _mm_mul_ps(c2, invDet);
+
+                    __m128 c3 = _mm_set_ps(1, 0, 0, 0);
+                    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+                    Matrix4x4 nMat;
+                    StoreAffineInverse(&nMat, c0, c1, c2);
+                    return nMat;
+                #endif
+            }
 
-            m[0][0] = matA[0][0] * matB[0][0] + matA[0][1] * matB[1][0] + matA[0][2] * matB[2][0] + matA[0][3] * matB[3][0];
-            m[0][1] = matA[0][0] * matB[0][1] + matA[0][1] * matB[1][1] + matA[0][2] * matB[2][1] + matA[0][3] * matB[3][1];
-            m[0][2] = matA[0][0] * matB[0][2] + matA[0][1] * matB[1][2] + matA[0][2] * matB[2][2] + matA[0][3] * matB[3][2];
-            m[0][3] = matA[0][0] * matB[0][3] + matA[0][1] * matB[1][3] + matA[0][2] * matB[2][3] + matA[0][3] * matB[3][3];
+            const T c[3][3] = {
+                { m[1][1] * m[2][2] - m[1][2] * m[2][1], m[1][2] * m[2][0] - m[1][0] * m[2][2], m[1][0] * m[2][1] - m[1][1] * m[2][0] },
+                { m[2][1] * m[0][2] - m[2][2] * m[0][1], m[2][2] * m[0][0] - m[2][0] * m[0][2], m[2][0] * m[0][1] - m[2][1] * m[0][0] },
+                { m[0][1] * m[1][2] - m[0][2] * m[1][1], m[0][2] * m[1][0] - m[0][0] * m[1][2], m[0][0] * m[1][1] - m[0][1] * m[1][0] }
+            };
+
+            const T det = (m[0][0] * c[0][0] + m[0][1] * c[0][1]) + m[0][2] * c[0][2];
+            if (det == 0) return Matrix4x4();
 
-            m[1][0] = matA[1][0] * matB[0][0] + matA[1][1] * matB[1][0] + matA[1][2] * matB[2][0] + matA[1][3] * matB[3][0];
-            m[1][1] = matA[1][0] * matB[0][1] + matA[1][1] * matB[1][1] + matA[1][2] * matB[2][1] + matA[1][3] * matB[3][1];
-            m[1][2] = matA[1][0] * matB[0][2] + matA[1][1] * matB[1][2] + matA[1][2] * matB[2][2] + matA[1][3] * matB[3][2];
-            m[1][3] = matA[1][0] * matB[0][3] + matA[1][1] * matB[1][3] + matA[1][2] * matB[2][3] + matA[1][3] * matB[3][3];
+            const T invDet = T(1) / det;
+
+            Matrix4x4 nMat;
+            for (int i = 0; i < 3; i++)
+                for (int j = 0; j < 3; j++)
+                    nMat[i][j] = c[j][i] * invDet;
 
-            m[2][0] = matA[2][0] * matB[0][0] + matA[2][1] * matB[1][0] + matA[2][2] * matB[2][0] + matA[2][3] * matB[3][0];
-            m[2][1] = matA[2][0] * matB[0][1] + matA[2][1] * matB[1][1] + matA[2][2] * matB[2][1] + matA[2][3] * matB[3][1];
-            m[2][2] = matA[2][0] * matB[0][2] + matA[2][1] * matB[1][2] + matA[2][2] * matB[2][2] + matA[2][3] * matB[3][2];
-            m[2][3] = matA[2][0] * matB[0][3] + matA[2][1] * matB[1][3] + matA[2][2] * matB[2][3] + matA[2][3] * matB[3][3];
+            for (int j = 0; j < 3; j++)
+                nMat[3][j] = -((m[3][0] * nMat[0][j] + m[3][1] * nMat[1][j]) + m[3][2] * nMat[2][j]);
 
-            m[3][0] = matA[3][0] * matB[0][0] + matA[3][1] * matB[1][0] + matA[3][2] * matB[2][0] + matA[3][3] * matB[3][0];
-            m[3][1] = matA[3][0] * matB[0][1] + matA[3][1] * matB[1][1] + matA[3][2] * matB[2][1] + matA[3][3] * matB[3][1];
-            m[3][2] = matA[3][0] * matB[0][2] + matA[3][1] * matB[1][2] + matA[3][2] * matB[2][2] + matA[3][3] * matB[3][2];
-            m[3][3] = matA[3][0] * matB[0][3] + matA[3][1] * matB[1][3] + matA[3][2] * matB[2][3] + matA[3][3] * matB[3][3];
+            return nMat;
         }
 
+        constexpr const T* operator[](uint8_t i) const { return(m[i]); }
+        constexpr T* operator[](uint8_t i) { return(m[i]); }
+
+        template<typename S>
+        Vector3<S> operator*(const Vector3<S> &vec) const
+        {
+            Vector3<S> nVec;
+            nVec.x = vec.x * m[0][0] + vec.y * m[1][0] + vec.z * m[2][0];
+            nVec.y = vec.x * m[0][1] + vec.y * m[1][1] + vec.z * m[2][1];
+            nVec.z = vec.x * m[0][2] + vec.y * m[1][2] + vec.z * m[2][2];
+
+            return nVec;
+        }
+        inline Matrix4x4 operator*(const Matrix4x4 &mat) const { return Multiply(*this, mat); }
+        inline void operator*=(const Matrix4x4 &mat) { *this = Multiply(*this, mat); }
+
         friend std::ostream& operator<<(std::ostream &s, const Matrix4x4 &m)
         {
             std::ios_base::fmtflags prevFormat = s.flags();
@@ -388,4 +527,232 @@ class Matrix4x4
         }
 
         void Inverse() { *this = Inverted(); }
-};
\ No newline at end of file
+
+    private:
+        // row = row * mat, in place, same operation order as MultiplyScalar()
+        static constexpr void RowTimes(T* row, const Matrix4x4 &mat)
+        {
+            const T r0 = row[0], r1 = row[1], r2 = row[2], r3 = row[3];
+            for (int j = 0; j < 4; j++)
+                row[j] = r0 * mat.m[0][j] + r1 * mat.m[1][j] + r2 * mat.m[2][j] + r3 * mat.m[3][j];
+        }
+
+        #if defined(SR_SSE2)
+            static inline __m128 SIMDMaskXYZ() { return _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)); }
+
+            static inline __m128 SIMDCross(__m128 a, __m128 b)
+            {
+                const __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)), bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+                const __m128 aZXY = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2)), bZXY = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+                return _mm_sub_ps(_mm_mul_ps(aYZX, bZXY), _mm_mul_ps(aZXY, bYZX));
+            }
+
+            // Rows of the inverted 3x3 part (w = 0) in, translation row -(t * inverse) computed here.
+            void StoreAffineInverse(Matrix4x4* nMat, __m128 r0, __m128 r1, __m128 r2) const
+            {
+                __m128 t = _mm_mul_ps(_mm_set1_ps(m[3][0]), r0);
+                t = _mm_add_ps(t, _mm_mul_ps(_mm_set1_ps(m[3][1]), r1));
+                t = _mm_add_ps(t, _mm_mul_ps(_mm_set1_ps(m[3][2]), r2));
+
+                _mm_store_ps(nMat->m[0], r0);
+                _mm_store_ps(nMat->m[1], r1);
+                _mm_store_ps(nMat->m[2], r2);
+                // Negated through the sign bit, 0 - t would turn -0 into +0 where the scalar path doesn't
+                t = _mm_xor_ps(t, _mm_castsi128_ps(_mm_set_epi32(0, (int)0x80000000, (int)0x80000000, (int)0x80000000)));
+                _mm_store_ps(nMat->m[3], _mm_or_ps(_mm_and_ps(t, SIMDMaskXYZ()), _mm_set_ps(1, 0, 0, 0)));
+            }
+        #endif
+};
+
+// Unit quaternions for rotations, Hamilton product. a * b rotates by b first, then a, and ToMatrix() gives
+// the row vector matrix used everywhere else, so ToMatrix(a * b) == ToMatrix(b) * ToMatrix(a).
+template<typename T>
+class Quaternion
+{
+    public:
+        alignas(16) T x;
+        T y, z, w;
+
+        Quaternion() : x(T(0)), y(T(0)), z(T(0)), w(T(1)) { }
+        Quaternion(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) { }
+
+        static Quaternion AxisAngle(const Vector3<T> &axis, T radians)
+        {
+            const Vector3<T> n = axis.Normalized() * std::sin(radians / 2);
+            return Quaternion(n.x, n.y, n.z, std::cos(radians / 2));
+        }
+
+        // Degrees, same order as the RX/RY/RZ matrices: around x first, then y, then z.
+        static Quaternion FromEuler(const Vector3<T> &euler)
+        {
+            T sx, cx, sy, cy, sz, cz;
+            if constexpr (std::is_same<T, float>::value)
+            {
+                // The three half angles in one call, lanes x, y, z (the fourth is padding)
+                const float hx = euler.x * float(DEG2RAD) / 2, hy = euler.y * float(DEG2RAD) / 2, hz = euler.z * float(DEG2RAD) / 2;
+                #if defined(SR_SSE2)
+                    __m128 s, c;
+                    fastmath::SinCos4(_mm_set_ps(0, hz, hy, hx), &s, &c);
+                    sx = _mm_cvtss_f32(s); sy = _mm_cvtss_f32(_mm_shuffle_ps(s, s, 1)); sz = _mm_cvtss_f32(_mm_shuffle_ps(s, s, 2));
+                    cx = _mm_cvtss_f32(c); cy = _mm_cvtss_f32(_mm_shuffle_ps(c, c, 1)); cz = _mm_cvtss_f32(_mm_shuffle_ps(c, c, 2));
+                #else
+                    fastmath::SinCos(hx, &sx, &cx);
+                    fastmath::SinCos(hy, &sy, &cy);
+                    fastmath::SinCos(hz, &sz, &cz);
+                #endif
+            }
+            else
+            {
+                const T hx = euler.x * T(DEG2RAD) / 2, hy = euler.y * T(DEG2RAD) / 2, hz = euler.z * T(DEG2RAD) / 2;
+                sx = std::sin(hx); cx = std::cos(hx);
+                sy = std::sin(hy); cy = std::cos(hy);
+                sz = std::sin(hz); cz = std::cos(hz);
+            }
+
+            // qz * qy * qx expanded
+            return Quaternion(
+                sx * cy * cz - cx * sy * sz,
+                cx * sy * cz + sx * cy * sz,
+                cx * cy * sz - sx * sy * cz,
+                cx * cy * cz + sx * sy * sz
+            );
+        }
+
+        // From the rotation part of an orthonormal matrix.
+        static Quaternion FromMatrix(const Matrix4x4<T> &mat)
+        {
+            // Column vector form, the transpose of ours
+            auto r = [&mat](int i, int j) { return mat[j][i]; };
+
+            Quaternion q;
+            const T trace = r(0, 0) + r(1, 1) + r(2, 2);
+            if (trace > 0)
+            {
+                const T s = T(0.5) / std::sqrt(trace + 1);
+                q = Quaternion((r(2, 1) - r(1, 2)) * s, (r(0, 2) - r(2, 0)) * s, (r(1, 0) - r(0, 1)) * s, T(0.25) / s);
+            }
+            else if (r(0, 0) > r(1, 1) && r(0, 0) > r(2, 2))
+            {
+                const T s = 2 * std::sqrt(1 + r(0, 0) - r(1, 1) - r(2, 2));
+                q = Quaternion(T(0.25) * s, (r(0, 1) + r(1, 0)) / s, (r(0, 2) + r(2, 0)) / s, (r(2, 1) - r(1, 2)) / s);
+            }
+            else if (r(1, 1) > r(2, 2))
+            {
+                const T s = 2 * std::sqrt(1 + r(1, 1) - r(0, 0) - r(2, 2));
+                q = Quaternion((r(0, 1) + r(1, 0)) / s, T(0.25) * s, (r(1, 2) + r(2, 1)) / s, (r(0, 2) - r(2, 0)) / s);
+            }
+            else
+            {
+                const T s = 2 * std::sqrt(1 + r(2, 2) - r(0, 0) - r(1, 1));
+                q = Quaternion((r(0, 2) + r(2, 0)) / s, (r(1, 2) + r(2, 1)) / s, T(0.25) * s, (r(1, 0) - r(0, 1)) / s);
+            }
+
+            return q.Normalized();
+        }
+
+        inline static T Dot(const Quaternion &a, const Quaternion &b) { return ((a.x * b.x + a.y * b.y) + a.z * b.z) + a.w * b.w; }
+
+        // Scalar reference and SSE2 path add the same terms in the same order, bit identical.
+        static Quaternion MultiplyScalar(const Quaternion &a, const Quaternion &b)
+        {
+            return Quaternion(
+                ((a.w * b.x + a.x * b.w) + a.y * b.z) - a.z * b.y,
+                ((a.w * b.y - a.x * b.z) + a.y * b.w) + a.z * b.x,
+                ((a.w * b.z + a.x * b.y) - a.y * b.x) + a.z * b.w,
+                ((a.w * b.w - a.x * b.x) - a.y * b.y) - a.z * b.z
+            );
+        }
+
+        static Quaternion Multiply(const Quaternion &a, const Quaternion &b)
+        {
+            if constexpr (std::is_same<T, float>::value)
+            {
+                #if defined(SR_SSE2)
+                    const __m128 vb = _mm_load_ps(&b.x);
+
+                    // b reordered for each of a's components, signs flipped through the sign bit
+                    const __m128 bWZYX = _mm_xor_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(0, 1, 2, 3)), _mm_castsi128_ps(_mm_set_epi32((int)0x80000000, 0, (int)0x80000000, 0)));
+                    const __m128 bZWXY = _mm_xor_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(1, 0, 3, 2)), _mm_castsi128_ps(_mm_set_epi32((int)0x80000000, (int)0x80000000, 0, 0)));
+                    const __m128 bYXWZ = _mm_xor_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 3, 0, 1)), _mm_castsi128_ps(_mm_set_epi32((int)0x80000000, 0, 0, (int)0x80000000)));
+
+                    __m128 r = _mm_mul_ps(_mm_set1_ps(a.w), vb);
+                    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.x), bWZYX));
+                    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.y), bZWXY));
+                    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.z), bYXWZ));
+
+                    Quaternion q;
+                    _mm_store_ps(&q.x, r);
+                    return q;
+                #endif
+            }
+
+            return MultiplyScalar(a, b);
+        }
+
+        // Normalized lerp along the shortest arc, cheap and good enough for small steps.
+        static Quaternion Nlerp(const Quaternion &a, const Quaternion &b, T t)
+        {
+            const T sign = Dot(a, b) < 0 ? T(-1) : T(1);
+            return Quaternion(
+                a.x + (b.x * sign - a.x) * t,
+                a.y + (b.y * sign - a.y) * t,
+                a.z + (b.z * sign - a.z) * t,
+                a.w + (b.w * sign - a.w) * t
+            ).Normalized();
+        }
+
+        // Constant angular speed along the shortest arc, falls back to Nlerp when a and b nearly match.
+        static Quaternion Slerp(const Quaternion &a, const Quaternion &b, T t)
+        {
+            T cosTheta = Dot(a, b);
+            const T sign = cosTheta < 0 ? T(-1) : T(1);
+            cosTheta *= sign;
+
+            if (cosTheta > T(0.9995)) return Nlerp(a, b, t);
+
+            const T theta = std::acos(cosTheta);
+            const T sinTheta = std::sin(theta);
+            const T wa = std::sin((1 - t) * theta) / sinTheta;
+            const T wb = std::sin(t * theta) / sinTheta * sign;
+
+            return Quaternion(a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb, a.w * wa + b.w * wb);
+        }
+
+        Matrix4x4<T> ToMatrix() const
+        {
+            const T xx = x * x, yy = y * y, zz = z * z;
+            const T xy = x * y, xz = x * z, yz = y * z;
+            const T wx = w * x, wy = w * y, wz = w * z;
+
+            return Matrix4x4<T>(
+                1 - 2 * (yy + zz),     2 * (xy + wz),     2 * (xz - wy), 0,
+                    2 * (xy - wz), 1 - 2 * (xx + zz),     2 * (yz + wx), 0,
+                    2 * (xz + wy),     2 * (yz - wx), 1 - 2 * (xx + yy), 0,
+                                0,                 0,                 0, 1
+            );
+        }
+
+        // Same as vec * ToMatrix().
+        Vector3<T> Rotate(const Vector3<T> &vec) const
+        {
+            const Vector3<T> u(x, y, z);
+            const Vector3<T> t = Vector3<T>::Cross(u, vec) * T(2);
+            return vec + t * w + Vector3<T>::Cross(u, t);
+        }
+
+        inline Quaternion Conjugated() const { return Quaternion(-x, -y, -z, w); }
+
+        inline T Magnitud() const { return std::sqrt(Dot(*this, *this)); }
+        Quaternion Normalized() const
+        {
+            T mag = Magnitud();
+            return Quaternion(x / mag, y / mag, z / mag, w / mag);
+        }
+
+        void Normalize() { *this = Normalized(); }
+
+        inline Quaternion operator*(const Quaternion &q) const { return Multiply(*this, q); }
+        inline void operator*=(const Quaternion &q) { *this = Multiply(*this, q); }
+
+        inline friend std::ostream& operator<<(std::ostream &s, const Quaternion<T> &q) { return s << "[" << q.x << ", " << q.y << ", " << q.z << " | " << q.w << "]"; }
+};
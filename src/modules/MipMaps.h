@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+#include "SIMD.h"
+
+// CPU mip chain generation for RGBA8 images, GL free so it can run (and be measured) on any thread.
+
+namespace images
+{
+    struct MipLevel
+    {
+        int width, height;
+        size_t offset; // Into MipChain::pixels
+    };
+
+    // Levels 1..N of an image, level 0 stays with whoever owns the source pixels.
+    struct MipChain
+    {
+        std::vector<unsigned char> pixels;
+        std::vector<MipLevel> levels;
+    };
+
+    static inline int MipCount(int width, int height)
+    {
+        int count = 1;
+        while (width > 1 || height > 1)
+        {
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+            count++;
+        }
+        return count;
+    }
+
+    // 2x2 box filter. With an odd size the last row/column has no pair in floor(size / 2) and is dropped,
+    // a side that's already 1 texel averages it with itself.
+    static inline void DownsampleBox(const unsigned char* src, int srcW, int srcH, unsigned char* dst, int dstW, int dstH)
+    {
+        for (int y = 0; y < dstH; y++)
+        {
+            const unsigned char* row0 = src + (size_t)std::min(2 * y, srcH - 1) * srcW * 4;
+            const unsigned char* row1 = src + (size_t)std::min(2 * y + 1, srcH - 1) * srcW * 4;
+            unsigned char* out = dst + (size_t)y * dstW * 4;
+
+            int x = 0;
+
+            #ifdef SR_SSE2
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i round = _mm_set1_epi16(2);
+
+                // 4 output texels per iteration, rounding matches the scalar path bit for bit
+                for (; 2 * x + 8 <= srcW && x + 4 <= dstW; x += 4)
+                {
+                    __m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+                    __m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16));
+                    __m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+                    __m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16));
+
+                    __m128i v01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+                    __m128i v23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+                    __m128i v45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+                    __m128i v67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+                    __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi64(v01, v23), _mm_unpackhi_epi64(v01, v23));
+                    __m128i s1 = _mm_add_epi16(_mm_unpacklo_epi64(v45, v67), _mm_unpackhi_epi64(v45, v67));
+
+                    s0 = _mm_srli_epi16(_mm_add_epi16(s0, round), 2);
+                    s1 = _mm_srli_epi16(_mm_add_epi16(s1, round), 2);
+
+                    _mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(s0, s1));
+                }
+            #endif
+
+            for (; x < dstW; x++)
+            {
+                const int x0 = std::min(2 * x, srcW - 1) * 4;
+                const int x1 = std::min(2 * x + 1, srcW - 1) * 4;
+
+                for (int c = 0; c < 4; c++)
+                    out[x * 4 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+            }
+        }
+    }
+
+    // 'maxLevels' limits the chain to levels 1..maxLevels, 0 goes all the way down to 1x1.
+    static inline void BuildMipChain(const unsigned char* level0, int width, int height, MipChain* chain, int maxLevels = 0)
+    {
+        chain->levels.clear();
+
+        size_t total = 0;
+        for (int w = width, h = height; (w > 1 || h > 1) && (maxLevels == 0 || (int)chain->levels.size() < maxLevels); )
+        {
+            w = std::max(1, w / 2);
+            h = std::max(1, h / 2);
+
+            chain->levels.push_back({ w, h, total });
+            total += (size_t)w * h * 4;
+        }
+
+        chain->pixels.resize(total);
+
+        const unsigned char* src = level0;
+        int srcW = width, srcH = height;
+        for (auto const &level : chain->levels)
+        {
+            unsigned char* dst = chain->pixels.data() + level.offset;
+            DownsampleBox(src, srcW, srcH, dst, level.width, level.height);
+
+            src = dst;
+            srcW = level.width;
+            srcH = level.height;
+        }
+    }
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+#include "SIMD.h"
+#include "LinearAlgebra.h"
+#include "BatchTransform.h"
+#include "Vector3Stream.h"
+#include "Geometry.h"
+
+struct RayHit
+{
+    float t = std::numeric_limits<float>::infinity();
+    float u = 0, v = 0;
+    int triangle = -1;
+
+    inline bool Hit() const { return triangle >= 0; }
+};
+
+// Triangles in SoA form, ready for Ray::IntersectTriangle: first vertex and the two edges out of it.
+struct TriangleStream
+{
+    public:
+        Vector3Stream<float> v0, edge1, edge2;
+
+        inline size_t size() const { return v0.size(); }
+
+        void Clear() { v0.Clear(); edge1.Clear(); edge2.Clear(); }
+        void Reserve(size_t count) { v0.Reserve(count); edge1.Reserve(count); edge2.Reserve(count); }
+
+        void PushBack(const Vector3<float> &a, const Vector3<float> &b, const Vector3<float> &c)
+        {
+            v0.PushBack(a);
+            edge1.PushBack(b - a);
+            edge2.PushBack(c - a);
+        }
+
+        // From OBJLoader output: interleaved vertices with the position at 'offset', three indices per triangle.
+        void FromMesh(const float* verts, const unsigned int* tris, size_t triCount, int stride = 8, int offset = 0)
+        {
+            Clear();
+            Reserve(triCount);
+
+            auto position = [&](unsigned int index) { const float* p = verts + (size_t)index * stride + offset; return Vector3<float>(p[0], p[1], p[2]); };
+            for (size_t i = 0; i < triCount; i++)
+                PushBack(position(tris[i * 3]), position(tris[i * 3 + 1]), position(tris[i * 3 + 2]));
+        }
+
+        inline Vector3<float> Corner(size_t triangle, int corner) const
+        {
+            const Vector3<float> a = v0.Get(triangle);
+            return corner == 0 ? a : a + (corner == 1 ? edge1 : edge2).Get(triangle);
+        }
+};
+
+namespace batch
+{
+    #ifdef SR_BATCH_LANES
+        // One Moller-Trumbore step over a register of lanes, same operations as Ray::IntersectTriangle. Returns
+        // the lanes that hit closer than 'best' (RAY_T_MIN < t < best).
+        static inline unsigned IntersectLanes(const lanes::Lanes o[3], const lanes::Lanes d[3], const lanes::Lanes v0[3],
+                                              const lanes::Lanes e1[3], const lanes::Lanes e2[3], lanes::Lanes best,
+                                              lanes::Lanes* t, lanes::Lanes* u, lanes::Lanes* v)
+        {
+            using namespace lanes;
+
+            const Lanes zero = Set(0.0f), one = Set(1.0f);
+            const Lanes eps = Set(float(RAY_DET_EPSILON)), negEps = Set(-float(RAY_DET_EPSILON));
+
+            const Lanes px = Sub(Mul(d[1], e2[2]), Mul(d[2], e2[1]));
+            const Lanes py = Sub(Mul(d[2], e2[0]), Mul(d[0], e2[2]));
+            const Lanes pz = Sub(Mul(d[0], e2[1]), Mul(d[1], e2[0]));
+            const Lanes det = Add(Add(Mul(e1[0], px), Mul(e1[1], py)), Mul(e1[2], pz));
+            const Lanes invDet = Div(one, det);
+
+            const Lanes tx = Sub(o[0], v0[0]), ty = Sub(o[1], v0[1]), tz = Sub(o[2], v0[2]);
+            *u = Mul(Add(Add(Mul(tx, px), Mul(ty, py)), Mul(tz, pz)), invDet);
+
+            const Lanes qx = Sub(Mul(ty, e1[2]), Mul(tz, e1[1]));
+            const Lanes qy = Sub(Mul(tz, e1[0]), Mul(tx, e1[2]));
+            const Lanes qz = Sub(Mul(tx, e1[1]), Mul(ty, e1[0]));
+            *v = Mul(Add(Add(Mul(d[0], qx), Mul(d[1], qy)), Mul(d[2], qz)), invDet);
+            *t = Mul(Add(Add(Mul(e2[0], qx), Mul(e2[1], qy)), Mul(e2[2], qz)), invDet);
+
+            const unsigned miss = (LessMask(det, eps) & LessMask(negEps, det))
+                                | LessMask(*u, zero) | LessMask(one, *u)
+                                | LessMask(*v, zero) | LessMask(one, Add(*u, *v));
+
+            return LessMask(Set(float(RAY_T_MIN)), *t) & LessMask(*t, best) & ~miss;
+        }
+
+        static inline void LoadLanes(const Vector3Stream<float> &stream, size_t i, lanes::Lanes out[3])
+        {
+            out[0] = lanes::Load(stream.get_x() + i);
+            out[1] = lanes::Load(stream.get_y() + i);
+            out[2] = lanes::Load(stream.get_z() + i);
+        }
+
+        static inline void SetLanes(const Vector3<float> &vec, lanes::Lanes out[3])
+        {
+            out[0] = lanes::Set(vec.x);
+            out[1] = lanes::Set(vec.y);
+            out[2] = lanes::Set(vec.z);
+        }
+    #endif
+
+    // Closest hit of one ray against every triangle, a register of triangles (4, 8 or 16) per step. Ties
+    // go to the lowest triangle index, like a plain loop over Ray::IntersectTriangle.
+    static inline bool IntersectTriangles(const Ray<float> &ray, const TriangleStream &tris, RayHit* hit, float tMax = std::numeric_limits<float>::infinity())
+    {
+        const size_t count = tris.size();
+        float best = tMax;
+        int bestTriangle = -1;
+        float bestU = 0, bestV = 0;
+
+        size_t i = 0;
+
+        #ifdef SR_BATCH_LANES
+            using namespace lanes;
+
+            Lanes o[3], d[3];
+            SetLanes(ray.origin, o);
+            SetLanes(ray.direction, d);
+            Lanes bestLanes = Set(best);
+
+            for (; i + SR_BATCH_LANES <= count; i += SR_BATCH_LANES)
+            {
+                Lanes v0[3], e1[3], e2[3], t, u, v;
+                LoadLanes(tris.v0, i, v0);
+                LoadLanes(tris.edge1, i, e1);
+                LoadLanes(tris.edge2, i, e2);
+
+                const unsigned hits = IntersectLanes(o, d, v0, e1, e2, bestLanes, &t, &u, &v);
+                if (!hits) continue;
+
+                alignas(64) float ts[SR_BATCH_LANES], us[SR_BATCH_LANES], vs[SR_BATCH_LANES];
+                Store(ts, t); Store(us, u); Store(vs, v);
+                for (int lane = 0; lane < SR_BATCH_LANES; lane++)
+                {
+                    if (!((hits >> lane) & 1) || !(ts[lane] < best)) continue;
+                    best = ts[lane]; bestU = us[lane]; bestV = vs[lane];
+                    bestTriangle = (int)(i + lane);
+                }
+                bestLanes = Set(best);
+            }
+        #endif
+
+        for (; i < count; i++)
+        {
+            float t, u, v;
+            if (!ray.IntersectTriangle(tris.v0.Get(i), tris.edge1.Get(i), tris.edge2.Get(i), best, &t, &u, &v)) continue;
+            best = t; bestU = u; bestV = v;
+            bestTriangle = (int)i;
+        }
+
+        if (bestTriangle < 0) return false;
+
+        hit->t = best; hit->u = bestU; hit->v = bestV;
+        hit->triangle = bestTriangle;
+        return true;
+    }
+
+    // Closest hits of many rays (SoA origins and directions) against every triangle, a register of rays
+    // per step and one triangle broadcast at a time, suits coherent rays (a pixel tile, a bake texel block).
+    // 'hits' holds one RayHit per ray and is overwritten. Returns how many rays hit something.
+    static inline size_t IntersectPackets(const Vector3Stream<float> &origins, const Vector3Stream<float> &directions, const TriangleStream &tris,
+                                   RayHit* hits, float tMax = std::numeric_limits<float>::infinity())
+    {
+        const size_t rayCount = origins.size();
+        size_t hitCount = 0;
+
+        size_t r = 0;
+
+        #ifdef SR_BATCH_LANES
+            using namespace lanes;
+
+            const size_t count = tris.size();
+            for (; r + SR_BATCH_LANES <= rayCount; r += SR_BATCH_LANES)
+            {
+                Lanes o[3], d[3];
+                LoadLanes(origins, r, o);
+                LoadLanes(directions, r, d);
+
+                alignas(64) float best[SR_BATCH_LANES];
+                for (int lane = 0; lane < SR_BATCH_LANES; lane++) hits[r + lane] = RayHit(), best[lane] = tMax;
+                Lanes bestLanes = Set(tMax);
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    Lanes v0[3], e1[3], e2[3], t, u, v;
+                    SetLanes(tris.v0.Get(i), v0);
+                    SetLanes(tris.edge1.Get(i), e1);
+                    SetLanes(tris.edge2.Get(i), e2);
+
+                    const unsigned rayHits = IntersectLanes(o, d, v0, e1, e2, bestLanes, &t, &u, &v);
+                    if (!rayHits) continue;
+
+                    alignas(64) float ts[SR_BATCH_LANES], us[SR_BATCH_LANES], vs[SR_BATCH_LANES];
+                    Store(ts, t); Store(us, u); Store(vs, v);
+                    for (int lane = 0; lane < SR_BATCH_LANES; lane++)
+                    {
+                        if (!((rayHits >> lane) & 1)) continue;
+                        RayHit &hit = hits[r + lane];
+                        hit.t = best[lane] = ts[lane];
+                        hit.u = us[lane]; hit.v = vs[lane];
+                        hit.triangle = (int)i;
+                    }
+                    bestLanes = Load(best);
+                }
+
+                for (int lane = 0; lane < SR_BATCH_LANES; lane++) hitCount += hits[r + lane].Hit();
+            }
+        #endif
+
+        for (; r < rayCount; r++)
+        {
+            hits[r] = RayHit();
+            hitCount += IntersectTriangles(Ray<float>(origins.Get(r), directions.Get(r)), tris, &hits[r], tMax);
+        }
+
+        return hitCount;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// Compile time instruction set selection, driven by the compiler flags (-msse4.1, -mavx2, -mfma, -mavx512f, /arch:AVX2...).
+// SR_NO_SIMD forces every module back to its scalar reference path.
+
+#if !defined(SR_NO_SIMD)
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define SR_SSE2
+    #endif
+    #if defined(SR_SSE2) && (defined(__SSE4_1__) || defined(__AVX__))
+        #define SR_SSE41
+    #endif
+    #if defined(SR_SSE2) && defined(__AVX__)
+        #define SR_AVX
+    #endif
+    #if defined(SR_AVX) && defined(__AVX2__)
+        #define SR_AVX2
+    #endif
+    #if defined(SR_AVX) && defined(__FMA__)
+        #define SR_FMA
+    #endif
+    #if defined(SR_AVX2) && defined(__AVX512F__)
+        #define SR_AVX512
+    #endif
+#endif
+
+#if defined(SR_AVX512) || defined(SR_AVX)
+    #include <immintrin.h>
+#elif defined(SR_SSE41)
+    #include <smmintrin.h>
+#elif defined(SR_SSE2)
+    #include <emmintrin.h>
+#endif
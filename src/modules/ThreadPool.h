@@ -0,0 +1,221 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+
+// Work stealing: every worker owns a deque. Jobs submitted from a worker go on its own deque and it takes
+// them back newest first, so nested ParallelFor()s finish their inner work while it's still in cache; an
+// idle worker steals the oldest job of another one. Jobs from any other thread are dealt round robin.
+// Each deque has its own lock, workers only contend with each other when stealing.
+class ThreadPool
+{
+    public:
+        // 0 -> one worker per hardware thread, minus the one running the render loop.
+        ThreadPool(unsigned int threadCount = 0)
+        {
+            if (threadCount == 0)
+            {
+                unsigned int hw = std::thread::hardware_concurrency();
+                threadCount = hw > 1 ? hw - 1 : 1;
+            }
+
+            for (unsigned int i = 0; i < threadCount; i++) _queues.emplace_back(new Queue());
+            for (unsigned int i = 0; i < threadCount; i++)
+                _workers.emplace_back([this, i] { WorkerLoop(i); });
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopping = true;
+            }
+            _wakeUp.notify_all();
+
+            for (auto &worker : _workers) worker.join();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        inline unsigned int get_threadCount() const { return (unsigned int)_workers.size(); }
+
+        void Submit(std::function<void()> job)
+        {
+            const unsigned int worker = CurrentWorker();
+            Queue &queue = *_queues[worker != NOT_A_WORKER ? worker : _nextQueue++ % _queues.size()];
+
+            _unfinished++;
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.jobs.push_back(std::move(job));
+            }
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _queued++;
+            }
+            _wakeUp.notify_one();
+        }
+
+        // Blocks until every submitted job has finished.
+        void Wait()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _idle.wait(lock, [this] { return _unfinished == 0; });
+        }
+
+        // Runs fn(0..count-1) across the pool and the calling thread. Safe to call from inside a job, the caller
+        // keeps claiming indices itself so it never waits on workers that are busy with something else, and a
+        // worker left waiting for the last indices runs other queued jobs meanwhile.
+        void ParallelFor(size_t count, const std::function<void(size_t)> &fn)
+        {
+            if (count == 0) return;
+
+            struct Batch
+            {
+                std::function<void(size_t)> fn;
+                std::atomic<size_t> next { 0 };
+                std::atomic<size_t> done { 0 };
+                std::mutex mutex;
+                std::condition_variable finished;
+                size_t count;
+            };
+
+            auto batch = std::make_shared<Batch>();
+            batch->fn = fn;
+            batch->count = count;
+
+            auto work = [](Batch &b)
+            {
+                size_t i;
+                while ((i = b.next++) < b.count)
+                {
+                    b.fn(i);
+                    if (++b.done == b.count)
+                    {
+                        std::lock_guard<std::mutex> lock(b.mutex);
+                        b.finished.notify_all();
+                    }
+                }
+            };
+
+            const size_t helpers = std::min<size_t>(count - 1, _workers.size());
+            for (size_t i = 0; i < helpers; i++) Submit([batch, work] { work(*batch); });
+
+            work(*batch);
+
+            // Not from other threads, the render loop shouldn't pick up a texture decode while it waits
+            const unsigned int worker = CurrentWorker();
+            if (worker != NOT_A_WORKER)
+            {
+                std::function<void()> job;
+                while (batch->done != batch->count && TryPop(worker, job)) Run(job);
+            }
+
+            std::unique_lock<std::mutex> lock(batch->mutex);
+            batch->finished.wait(lock, [&] { return batch->done == batch->count; });
+        }
+
+    private:
+        static constexpr unsigned int NOT_A_WORKER = (unsigned int)-1;
+
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> jobs;
+        };
+
+        struct WorkerSlot
+        {
+            const ThreadPool* pool = nullptr;
+            unsigned int index = 0;
+        };
+
+        std::vector<std::thread> _workers;
+        std::vector<std::unique_ptr<Queue>> _queues;
+        std::atomic<unsigned int> _nextQueue { 0 };
+
+        std::mutex _mutex;
+        std::condition_variable _wakeUp, _idle;
+        std::atomic<int> _queued { 0 };         // Sitting in a deque, only raised under _mutex so no wake up is lost
+        std::atomic<int> _unfinished { 0 };     // Submitted and not done yet
+        bool _stopping = false;
+
+        static WorkerSlot& CurrentSlot()
+        {
+            static thread_local WorkerSlot slot;
+            return slot;
+        }
+
+        inline unsigned int CurrentWorker() const
+        {
+            const WorkerSlot &slot = CurrentSlot();
+            return slot.pool == this ? slot.index : NOT_A_WORKER;
+        }
+
+        // Own deque from the back, then the others from the front.
+        bool TryPop(unsigned int worker, std::function<void()> &job)
+        {
+            const unsigned int count = (unsigned int)_queues.size();
+            for (unsigned int i = 0; i < count; i++)
+            {
+                Queue &queue = *_queues[(worker + i) % count];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.jobs.empty()) continue;
+
+                if (i == 0)
+                {
+                    job = std::move(queue.jobs.back());
+                    queue.jobs.pop_back();
+                }
+                else
+                {
+                    job = std::move(queue.jobs.front());
+                    queue.jobs.pop_front();
+                }
+
+                _queued--;
+                return true;
+            }
+            return false;
+        }
+
+        void Run(std::function<void()> &job)
+        {
+            job();
+            job = nullptr;
+
+            if (--_unfinished == 0)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _idle.notify_all();
+            }
+        }
+
+        void WorkerLoop(unsigned int index)
+        {
+            CurrentSlot() = { this, index };
+
+            while (true)
+            {
+                std::function<void()> job;
+                if (TryPop(index, job))
+                {
+                    Run(job);
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wakeUp.wait(lock, [this] { return _stopping || _queued > 0; });
+
+                if (_stopping && _queued <= 0) return;
+            }
+        }
+};
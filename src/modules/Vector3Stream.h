@@ -0,0 +1,308 @@
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "SIMD.h"
+#include "LinearAlgebra.h"
+#include "BatchTransform.h"
+
+#define VECTOR3_STREAM_ALIGNMENT 64
+
+template<typename T, size_t Alignment>
+struct AlignedAllocator
+{
+    typedef T value_type;
+
+    template<typename U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+    AlignedAllocator() = default;
+    template<typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) { }
+
+    T* allocate(size_t n) { return (T*)::operator new(n * sizeof(T), std::align_val_t(Alignment)); }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(Alignment)); }
+
+    template<typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template<typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+// Vector3s stored as three cache line aligned arrays (x[], y[], z[]) so mesh passes (bounds, normals,
+// welding...) run a whole SIMD register of vectors per instruction. Float streams use the batch lanes
+// (AVX-512, AVX, SSE2) with a scalar tail doing the same operations in the same order as Vector3, so each
+// element gets the same bits it would get from Vector3<float>. Double streams run the scalar loops.
+template<typename T>
+class Vector3Stream
+{
+    public:
+        typedef std::vector<T, AlignedAllocator<T, VECTOR3_STREAM_ALIGNMENT>> Array;
+
+        Vector3Stream() { }
+        explicit Vector3Stream(size_t count) : _x(count), _y(count), _z(count) { }
+
+        inline size_t size() const { return _x.size(); }
+        inline bool empty() const { return _x.empty(); }
+
+        void Resize(size_t count) { _x.resize(count); _y.resize(count); _z.resize(count); }
+        void Reserve(size_t count) { _x.reserve(count); _y.reserve(count); _z.reserve(count); }
+        void Clear() { _x.clear(); _y.clear(); _z.clear(); }
+        void PushBack(const Vector3<T> &vec) { _x.push_back(vec.x); _y.push_back(vec.y); _z.push_back(vec.z); }
+
+        inline Vector3<T> Get(size_t i) const { return Vector3<T>(_x[i], _y[i], _z[i]); }
+        inline void Set(size_t i, const Vector3<T> &vec) { _x[i] = vec.x; _y[i] = vec.y; _z[i] = vec.z; }
+
+        inline T* get_x() { return _x.data(); }
+        inline T* get_y() { return _y.data(); }
+        inline T* get_z() { return _z.data(); }
+        inline const T* get_x() const { return _x.data(); }
+        inline const T* get_y() const { return _y.data(); }
+        inline const T* get_z() const { return _z.data(); }
+
+        // Pulls three consecutive floats out of every vertex of an interleaved buffer. With the OBJLoader
+        // layout (stride 8) offset 0 is the position and 5 the normal. Resizes the stream to 'vertexCount'.
+        void Gather(const float* verts, size_t vertexCount, int stride = 8, int offset = 0)
+        {
+            Resize(vertexCount);
+
+            size_t i = 0;
+
+            #if defined(SR_SSE2)
+                if constexpr (std::is_same<T, float>::value)
+                {
+                    // Four vertices at a time, one unaligned row each, transposed into columns. The row
+                    // starts early when the three floats sit at the end of the vertex, so it never reads past it.
+                    if (stride >= 4)
+                    {
+                        const int start = offset + 4 <= stride ? offset : stride - 4, shift = offset - start;
+                        const float* src = verts + start;
+
+                        for (; i + 4 <= vertexCount; i += 4, src += 4 * stride)
+                        {
+                            __m128 c[4] = { _mm_loadu_ps(src), _mm_loadu_ps(src + stride), _mm_loadu_ps(src + 2 * stride), _mm_loadu_ps(src + 3 * stride) };
+                            _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+
+                            _mm_store_ps(&_x[i], c[shift]);
+                            _mm_store_ps(&_y[i], c[shift + 1]);
+                            _mm_store_ps(&_z[i], c[shift + 2]);
+                        }
+                    }
+                }
+            #endif
+
+            for (; i < vertexCount; i++)
+            {
+                const float* src = verts + i * stride + offset;
+                _x[i] = T(src[0]); _y[i] = T(src[1]); _z[i] = T(src[2]);
+            }
+        }
+
+        // The way back, only the three floats at 'offset' of each vertex are written.
+        void Scatter(float* verts, int stride = 8, int offset = 0) const
+        {
+            const size_t count = size();
+            size_t i = 0;
+
+            #if defined(SR_SSE2)
+                if constexpr (std::is_same<T, float>::value)
+                {
+                    if (stride >= 4)
+                    {
+                        const int start = offset + 4 <= stride ? offset : stride - 4, shift = offset - start;
+                        float* dst = verts + start;
+
+                        for (; i + 4 <= count; i += 4, dst += 4 * stride)
+                        {
+                            // Rows read back first so the fourth column keeps whatever it had
+                            __m128 c[4] = { _mm_loadu_ps(dst), _mm_loadu_ps(dst + stride), _mm_loadu_ps(dst + 2 * stride), _mm_loadu_ps(dst + 3 * stride) };
+                            _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+
+                            c[shift] = _mm_load_ps(&_x[i]);
+                            c[shift + 1] = _mm_load_ps(&_y[i]);
+                            c[shift + 2] = _mm_load_ps(&_z[i]);
+
+                            _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+                            _mm_storeu_ps(dst, c[0]);
+                            _mm_storeu_ps(dst + stride, c[1]);
+                            _mm_storeu_ps(dst + 2 * stride, c[2]);
+                            _mm_storeu_ps(dst + 3 * stride, c[3]);
+                        }
+                    }
+                }
+            #endif
+
+            for (; i < count; i++)
+            {
+                float* dst = verts + i * stride + offset;
+                dst[0] = float(_x[i]); dst[1] = float(_y[i]); dst[2] = float(_z[i]);
+            }
+        }
+
+        // out[i] = Dot(a[i], b[i]). 'out' must hold a.size() values.
+        static void Dot(const Vector3Stream &a, const Vector3Stream &b, T* out)
+        {
+            const size_t count = a.size();
+            const T *ax = a.get_x(), *ay = a.get_y(), *az = a.get_z();
+            const T *bx = b.get_x(), *by = b.get_y(), *bz = b.get_z();
+
+            size_t i = 0;
+
+            #ifdef SR_BATCH_LANES
+                if constexpr (std::is_same<T, float>::value)
+                {
+                    using namespace batch::lanes;
+                    for (; i + SR_BATCH_LANES <= count; i += SR_BATCH_LANES)
+                        Store(out + i, Add(Add(Mul(Load(ax + i), Load(bx + i)), Mul(Load(ay + i), Load(by + i))), Mul(Load(az + i), Load(bz + i))));
+                }
+            #endif
+
+            for (; i < count; i++) out[i] = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i];
+        }
+
+        // out[i] = Cross(a[i], b[i]), 'out' is resized. It may be 'a' or 'b'.
+        static void Cross(const Vector3Stream &a, const Vector3Stream &b, Vector3Stream* out)
+        {
+            const size_t count = a.size();
+            out->Resize(count);
+
+            const T *ax = a.get_x(), *ay = a.get_y(), *az = a.get_z();
+            const T *bx = b.get_x(), *by = b.get_y(), *bz = b.get_z();
+            T *ox = out->get_x(), *oy = out->get_y(), *oz = out->get_z();
+
+            size_t i = 0;
+
+            #ifdef SR_BATCH_LANES
+                if constexpr (std::is_same<T, float>::value)
+                {
+                    using namespace batch::lanes;
+                    for (; i + SR_BATCH_LANES <= count; i += SR_BATCH_LANES)
+                    {
+                        const Lanes x0 = Load(ax + i), y0 = Load(ay + i), z0 = Load(az + i);
+                        const Lanes x1 = Load(bx + i), y1 = Load(by + i), z1 = Load(bz + i);
+
+                        Store(ox + i, Sub(Mul(y0, z1), Mul(z0, y1)));
+                        Store(oy + i, Sub(Mul(z0, x1), Mul(x0, z1)));
+                        Store(oz + i, Sub(Mul(x0, y1), Mul(y0, x1)));
+                    }
+                }
+            #endif
+
+            for (; i < count; i++)
+            {
+                const T x0 = ax[i], y0 = ay[i], z0 = az[i];
+                const T x1 = bx[i], y1 = by[i], z1 = bz[i];
+
+                ox[i] = y0 * z1 - z0 * y1;
+                oy[i] = z0 * x1 - x0 * z1;
+                oz[i] = x0 * y1 - y0 * x1;
+            }
+        }
+
+        // Every vector divided by its length, zero vectors turn into NaNs just like Vector3::Normalize().
+        void Normalize()
+        {
+            const size_t count = size();
+            T *xs = _x.data(), *ys = _y.data(), *zs = _z.data();
+
+            size_t i = 0;
+
+            #ifdef SR_BATCH_LANES
+                if constexpr (std::is_same<T, float>::value)
+                {
+                    using namespace batch::lanes;
+                    for (; i + SR_BATCH_LANES <= count; i += SR_BATCH_LANES)
+                    {
+                        const Lanes x = Load(xs + i), y = Load(ys + i), z = Load(zs + i);
+                        const Lanes mag = Sqrt(Add(Add(Mul(x, x), Mul(y, y)), Mul(z, z)));
+
+                        Store(xs + i, Div(x, mag));
+                        Store(ys + i, Div(y, mag));
+                        Store(zs + i, Div(z, mag));
+                    }
+                }
+            #endif
+
+            for (; i < count; i++)
+            {
+                const T mag = std::sqrt(xs[i] * xs[i] + ys[i] * ys[i] + zs[i] * zs[i]);
+                xs[i] /= mag; ys[i] /= mag; zs[i] /= mag;
+            }
+        }
+
+        // Component wise minimum and maximum over the whole stream (the bounding box). Empty streams give zeros.
+        void MinMax(Vector3<T>* min, Vector3<T>* max) const
+        {
+            const size_t count = size();
+            if (!count)
+            {
+                *min = *max = Vector3<T>();
+                return;
+            }
+
+            const T *xs = _x.data(), *ys = _y.data(), *zs = _z.data();
+            T loX = xs[0], loY = ys[0], loZ = zs[0], hiX = loX, hiY = loY, hiZ = loZ;
+            size_t i = 0;
+
+            #ifdef SR_BATCH_LANES
+                if constexpr (std::is_same<T, float>::value)
+                {
+                    using namespace batch::lanes;
+                    if (count >= SR_BATCH_LANES)
+                    {
+                        Lanes minX = Load(xs), minY = Load(ys), minZ = Load(zs);
+                        Lanes maxX = minX, maxY = minY, maxZ = minZ;
+                        for (i = SR_BATCH_LANES; i + SR_BATCH_LANES <= count; i += SR_BATCH_LANES)
+                        {
+                            const Lanes x = Load(xs + i), y = Load(ys + i), z = Load(zs + i);
+                            minX = batch::lanes::Min(minX, x); maxX = batch::lanes::Max(maxX, x);
+                            minY = batch::lanes::Min(minY, y); maxY = batch::lanes::Max(maxY, y);
+                            minZ = batch::lanes::Min(minZ, z); maxZ = batch::lanes::Max(maxZ, z);
+                        }
+
+                        alignas(VECTOR3_STREAM_ALIGNMENT) float lanes[6][SR_BATCH_LANES];
+                        Store(lanes[0], minX); Store(lanes[1], minY); Store(lanes[2], minZ);
+                        Store(lanes[3], maxX); Store(lanes[4], maxY); Store(lanes[5], maxZ);
+                        for (int lane = 0; lane < SR_BATCH_LANES; lane++)
+                        {
+                            loX = loX < lanes[0][lane] ? loX : lanes[0][lane];
+                            loY = loY < lanes[1][lane] ? loY : lanes[1][lane];
+                            loZ = loZ < lanes[2][lane] ? loZ : lanes[2][lane];
+                            hiX = hiX > lanes[3][lane] ? hiX : lanes[3][lane];
+                            hiY = hiY > lanes[4][lane] ? hiY : lanes[4][lane];
+                            hiZ = hiZ > lanes[5][lane] ? hiZ : lanes[5][lane];
+                        }
+                    }
+                }
+            #endif
+
+            // Same operand order as minps / maxps
+            for (; i < count; i++)
+            {
+                loX = loX < xs[i] ? loX : xs[i]; hiX = hiX > xs[i] ? hiX : xs[i];
+                loY = loY < ys[i] ? loY : ys[i]; hiY = hiY > ys[i] ? hiY : ys[i];
+                loZ = loZ < zs[i] ? loZ : zs[i]; hiZ = hiZ > zs[i] ? hiZ : zs[i];
+            }
+
+            *min = Vector3<T>(loX, loY, loZ);
+            *max = Vector3<T>(hiX, hiY, hiZ);
+        }
+
+        inline Vector3<T> Min() const { Vector3<T> min, max; MinMax(&min, &max); return min; }
+        inline Vector3<T> Max() const { Vector3<T> min, max; MinMax(&min, &max); return max; }
+
+        // In place through batch::TransformPoints / TransformNormals, float streams only.
+        void TransformPoints(const Matrix4x4<float> &mat)
+        {
+            static_assert(std::is_same<T, float>::value, "Vector3Stream::TransformPoints needs a float stream");
+            batch::TransformPoints(mat, _x.data(), _y.data(), _z.data(), _x.data(), _y.data(), _z.data(), size());
+        }
+        void TransformNormals(const Matrix4x4<float> &mat, bool normalize = true)
+        {
+            static_assert(std::is_same<T, float>::value, "Vector3Stream::TransformNormals needs a float stream");
+            batch::TransformNormals(mat, _x.data(), _y.data(), _z.data(), _x.data(), _y.data(), _z.data(), size(), normalize);
+        }
+
+    private:
+        Array _x, _y, _z;
+};
@@ -0,0 +1,83 @@
+// The per frame uniform path (transform and camera matrices, the MVP, the frustum) must not touch the heap.
+// Exits nonzero if it does. Build from the repo root:
+//   g++ -std=c++17 -O2 -Isrc tests/AllocationTests.cpp src/Transform.cpp src/Camera.cpp -o bin/AllocationTests
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "Test.h"
+#include "Camera.h"
+#include "Transform.h"
+#include "modules/LinearAlgebra.h"
+
+#define WARMUP_FRAMES 100
+#define FRAMES 10000
+
+using namespace std;
+
+static atomic<size_t> allocationCount(0);
+
+void* operator new(size_t size)
+{
+    allocationCount++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    allocationCount++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// What main.cpp does with the matrices every frame, the sum keeps the optimizer from dropping any of it
+static float Frame(Transform &transform, Camera &cam, float deltaTime)
+{
+    transform.Rotate(0, 15 * deltaTime, 0);
+    cam.transform.Translate(0, 0, deltaTime);
+
+    const Matrix4x4<float> &localToWorld = transform.LocalToWorld();
+    const Matrix4x4<float> &worldToLocal = transform.WorldToLocal();
+    const Matrix4x4<float> mvp = Matrix4x4<float>::Chain(localToWorld, cam.WorldToCamera(), cam.ProjectionMatrix());
+    const Matrix4x4<float> viewProjection = Matrix4x4<float>::Chain(cam.WorldToCamera(), cam.ProjectionMatrix());
+
+    const Vector3<float> center = transform.get_position() + localToWorld * Vector3<float>(0, 1, 0);
+    const Frustum<float> &frustum = cam.ViewFrustum();
+
+    float sum = mvp.data()[0] + viewProjection.data()[5] + worldToLocal.data()[10] + cam.CameraToWorld().data()[15];
+    sum += cam.ProjectedSize(center, 1.0f) + cam.get_fLength() + cam.get_fovX() + cam.get_canvasPlane().right;
+    sum += frustum.Classify(AABB<float>(center - Vector3<float>(1, 1, 1), center + Vector3<float>(1, 1, 1))) == Containment::Outside;
+    return sum;
+}
+
+static void UniformPathDoesNotAllocate()
+{
+    Transform transform(Vector3<float>(0, 0, -10), Vector3<float>(0, 0, 0));
+    Camera cam;
+
+    float sum = 0;
+    for (int i = 0; i < WARMUP_FRAMES; i++) sum += Frame(transform, cam, 0.016f);
+
+    const size_t before = allocationCount;
+    for (int i = 0; i < FRAMES; i++) sum += Frame(transform, cam, 0.016f);
+    const size_t allocations = allocationCount - before;
+
+    if (!CHECK(allocations == 0)) cout << "    " << allocations << " heap allocations in " << FRAMES << " frames." << endl;
+
+    // Keeps 'sum' alive
+    if (sum == 42.0f) cout << sum << endl;
+}
+
+int main()
+{
+    UniformPathDoesNotAllocate();
+
+    return test::Report("AllocationTests");
+}
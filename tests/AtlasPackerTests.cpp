@@ -0,0 +1,135 @@
+// images::SkylinePacker::Insert: every placed rect stays inside the atlas, on 'align' boundaries, and never
+// overlaps another one (padded to 'align' like the packer reserves them), for random sizes until the atlas
+// fills up. Exits nonzero on failure. Build from the repo root:
+//   g++ -std=c++17 -O2 -Isrc tests/AtlasPackerTests.cpp -o bin/AtlasPackerTests
+
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "modules/AtlasPacker.h"
+
+#define INSERTS 2000
+#define MAX_RECT 96
+
+using namespace std;
+
+// Owner of every texel, 0 for free
+struct Coverage
+{
+    int width, height;
+    vector<int> owner;
+
+    Coverage(int width, int height) : width(width), height(height), owner((size_t)width * height, 0) {}
+
+    // False on the first texel somebody else already has
+    bool Claim(int x, int y, int w, int h, int id, int* other)
+    {
+        for (int row = y; row < y + h; row++)
+            for (int col = x; col < x + w; col++)
+            {
+                int &texel = owner[(size_t)row * width + col];
+                if (texel) { *other = texel; return false; }
+                texel = id;
+            }
+        return true;
+    }
+};
+
+static int AlignUp(int v, int align) { return (v + align - 1) / align * align; }
+
+// Sizes from slivers to MAX_RECT, fed in until a long run of them no longer fits
+static void PackRandom(mt19937 &rng, int width, int height, int align)
+{
+    uniform_int_distribution<int> size(1, MAX_RECT), shape(0, 3);
+    images::SkylinePacker packer(width, height, align);
+    Coverage coverage(width, height);
+
+    int placed = 0, usedArea = 0, failuresInARow = 0;
+    for (int i = 0; i < INSERTS && failuresInARow < 50; i++)
+    {
+        int w = size(rng), h = size(rng);
+        if (shape(rng) == 0) w = max(1, w / 8);
+        else if (shape(rng) == 0) h = max(1, h / 8);
+
+        int x = -1, y = -1;
+        if (!packer.Insert(w, h, &x, &y)) { failuresInARow++; continue; }
+        failuresInARow = 0;
+
+        // The whole padded footprint, the packer hands out aligned widths and heights
+        const int paddedW = AlignUp(w, align), paddedH = AlignUp(h, align);
+        if (!CHECK(x >= 0 && y >= 0 && x + paddedW <= width && y + paddedH <= height))
+        {
+            cout << "    " << width << "x" << height << ", align " << align << ": " << w << "x" << h << " at " << x << ", " << y << " is outside" << endl;
+            return;
+        }
+        if (!CHECK(x % align == 0 && y % align == 0))
+        {
+            cout << "    " << width << "x" << height << ", align " << align << ": " << w << "x" << h << " at " << x << ", " << y << " isn't aligned" << endl;
+            return;
+        }
+
+        int other = 0;
+        if (!CHECK(coverage.Claim(x, y, paddedW, paddedH, placed + 1, &other)))
+        {
+            cout << "    " << width << "x" << height << ", align " << align << ": rect " << placed + 1 << " (" << w << "x" << h << " at " << x << ", " << y
+                 << ") overlaps rect " << other << endl;
+            return;
+        }
+
+        placed++;
+        usedArea += paddedW * paddedH;
+    }
+
+    // Full, and not by giving up early: a skyline packer leaves some holes but nowhere near half the atlas
+    if (!CHECK(failuresInARow == 50 && usedArea > width * height / 2))
+        cout << "    " << width << "x" << height << ", align " << align << ": " << placed << " rects, " << usedArea << " of " << width * height << " texels" << endl;
+}
+
+static void RandomRectsFit()
+{
+    mt19937 rng(31);
+
+    // Square, wide, tall, and sizes that aren't a multiple of the alignment
+    const int atlases[][2] = { { 512, 512 }, { 1024, 256 }, { 128, 1024 }, { 517, 383 }, { 100, 100 } };
+    for (auto const &atlas : atlases)
+        for (int align : { 1, 4, 16 })
+            for (int run = 0; run < 4; run++) PackRandom(rng, atlas[0], atlas[1], align);
+}
+
+static void ExactFits()
+{
+    // A grid of equal tiles fills the atlas to the last texel, then nothing more goes in
+    images::SkylinePacker packer(256, 256, 4);
+    Coverage coverage(256, 256);
+    for (int i = 0; i < 16; i++)
+    {
+        int x, y, other;
+        if (!CHECK(packer.Insert(64, 64, &x, &y))) return;
+        CHECK(coverage.Claim(x, y, 64, 64, i + 1, &other));
+    }
+    int x, y;
+    CHECK(!packer.Insert(1, 1, &x, &y));
+
+    // Padded by the alignment: 61 wide takes 64, so four across, a fifth doesn't fit in the row
+    images::SkylinePacker padded(256, 64, 16);
+    for (int i = 0; i < 4; i++)
+        CHECK(padded.Insert(61, 64, &x, &y) && x == i * 64 && y == 0);
+    CHECK(!padded.Insert(1, 1, &x, &y));
+
+    // Too big either way is refused, and leaves the packer as it was
+    images::SkylinePacker refused(128, 128, 8);
+    CHECK(!refused.Insert(129, 8, &x, &y));
+    CHECK(!refused.Insert(8, 129, &x, &y));
+    CHECK(refused.Insert(125, 8, &x, &y) && x == 0 && y == 0);
+    CHECK(refused.Insert(128, 120, &x, &y) && x == 0 && y == 8);
+    CHECK(!refused.Insert(1, 1, &x, &y));
+}
+
+int main()
+{
+    RandomRectsFit();
+    ExactFits();
+
+    return test::Report("AtlasPackerTests");
+}
@@ -0,0 +1,170 @@
+// batch::TransformPoints, ProjectPoints and TransformNormals against Matrix4x4::TransformVector and the scalar
+// normal transform, bit for bit, for counts that aren't a multiple of the lane width and with the outputs
+// written in place. Exits nonzero on failure. Build from the repo root:
+//   g++ -std=c++17 -O2 -ffp-contract=off -Isrc tests/BatchTransformTests.cpp -o bin/BatchTransformTests
+// and again with -mavx2 and with -DSR_NO_SIMD.
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "modules/BatchTransform.h"
+
+#define GUARD_FLOATS 32 // Past 'count' in every output, must come back untouched
+#define GUARD_VALUE -12345.0f
+
+using namespace std;
+
+// Around the lane widths (4, 8, 16) and well past them
+static const size_t counts[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 100, 1023 };
+
+struct Stream
+{
+    vector<float> x, y, z, w;
+
+    Stream(size_t count, float fill) : x(count + GUARD_FLOATS, fill), y(count + GUARD_FLOATS, fill), z(count + GUARD_FLOATS, fill), w(count + GUARD_FLOATS, fill) {}
+};
+
+static Stream RandomPoints(mt19937 &rng, size_t count)
+{
+    uniform_real_distribution<float> value(-100.0f, 100.0f);
+    Stream points(count, GUARD_VALUE);
+    for (size_t i = 0; i < count; i++)
+    {
+        points.x[i] = value(rng);
+        points.y[i] = value(rng);
+        points.z[i] = value(rng);
+    }
+    return points;
+}
+
+static Matrix4x4<float> RandomMatrix(mt19937 &rng, bool affine)
+{
+    uniform_real_distribution<float> value(-2.0f, 2.0f);
+    Matrix4x4<float> mat;
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            mat[r][c] = value(rng);
+
+    if (affine) { mat[0][3] = 0; mat[1][3] = 0; mat[2][3] = 0; mat[3][3] = 1; }
+    return mat;
+}
+
+static bool GuardsIntact(const Stream &out, size_t count)
+{
+    for (size_t i = count; i < count + GUARD_FLOATS; i++)
+        if (out.x[i] != GUARD_VALUE || out.y[i] != GUARD_VALUE || out.z[i] != GUARD_VALUE || out.w[i] != GUARD_VALUE) return false;
+    return true;
+}
+
+static void CheckPoint(const char* kernel, size_t count, size_t i, const Vector3<float> &point, const Vector3<float> &expected)
+{
+    if (!CHECK(test::SameBits(point.x, expected.x) && test::SameBits(point.y, expected.y) && test::SameBits(point.z, expected.z)))
+        cout << "    " << kernel << ", count " << count << ", element " << i << ": " << point << " != " << expected << endl;
+}
+
+// An affine matrix leaves w at exactly 1, so TransformVector's divide is a no-op and the bits have to match
+static void PointsMatchTransformVector()
+{
+    mt19937 rng(36);
+    for (size_t count : counts)
+    {
+        const Matrix4x4<float> mat = RandomMatrix(rng, true);
+        const Stream in = RandomPoints(rng, count);
+
+        Stream out(count, GUARD_VALUE);
+        batch::TransformPoints(mat, in.x.data(), in.y.data(), in.z.data(), out.x.data(), out.y.data(), out.z.data(), count);
+
+        Stream inPlace = in;
+        batch::TransformPoints(mat, inPlace.x.data(), inPlace.y.data(), inPlace.z.data(), inPlace.x.data(), inPlace.y.data(), inPlace.z.data(), count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const Vector3<float> expected = mat.TransformVector(Vector3<float>(in.x[i], in.y[i], in.z[i]));
+            CheckPoint("TransformPoints", count, i, Vector3<float>(out.x[i], out.y[i], out.z[i]), expected);
+            CheckPoint("TransformPoints in place", count, i, Vector3<float>(inPlace.x[i], inPlace.y[i], inPlace.z[i]), expected);
+        }
+        CHECK(GuardsIntact(out, count) && GuardsIntact(inPlace, count));
+    }
+}
+
+static void ProjectedMatchTransformVector()
+{
+    mt19937 rng(37);
+    for (size_t count : counts)
+    {
+        const Matrix4x4<float> mat = RandomMatrix(rng, false);
+        const Stream in = RandomPoints(rng, count);
+
+        Stream out(count, GUARD_VALUE);
+        batch::ProjectPoints(mat, in.x.data(), in.y.data(), in.z.data(), out.x.data(), out.y.data(), out.z.data(), out.w.data(), count);
+
+        // In place and without w
+        Stream inPlace = in;
+        batch::ProjectPoints(mat, inPlace.x.data(), inPlace.y.data(), inPlace.z.data(), inPlace.x.data(), inPlace.y.data(), inPlace.z.data(), nullptr, count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const float x = in.x[i], y = in.y[i], z = in.z[i];
+            const Vector3<float> expected = mat.TransformVector(Vector3<float>(x, y, z));
+            const float w = x * mat[0][3] + y * mat[1][3] + z * mat[2][3] + mat[3][3];
+
+            CheckPoint("ProjectPoints", count, i, Vector3<float>(out.x[i], out.y[i], out.z[i]), expected);
+            CheckPoint("ProjectPoints in place", count, i, Vector3<float>(inPlace.x[i], inPlace.y[i], inPlace.z[i]), expected);
+            CHECK(test::SameBits(out.w[i], w));
+        }
+        CHECK(GuardsIntact(out, count) && GuardsIntact(inPlace, count));
+    }
+}
+
+// The inverse transpose applied one normal at a time, then 1 / length like the kernel does
+static Vector3<float> ReferenceNormal(const Matrix4x4<float> &normalMat, const Vector3<float> &normal, bool normalize)
+{
+    Vector3<float> n = normalMat * normal;
+    if (normalize)
+    {
+        const float invLength = 1.0f / sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+        n.x *= invLength;
+        n.y *= invLength;
+        n.z *= invLength;
+    }
+    return n;
+}
+
+static void NormalsMatchScalar()
+{
+    mt19937 rng(38);
+    for (size_t count : counts)
+    {
+        const Matrix4x4<float> mat = RandomMatrix(rng, true);
+        const Matrix4x4<float> normalMat = mat.InvertedAffine().Transposed();
+        const Stream in = RandomPoints(rng, count);
+
+        for (bool normalize : { true, false })
+        {
+            Stream out(count, GUARD_VALUE);
+            batch::TransformNormals(mat, in.x.data(), in.y.data(), in.z.data(), out.x.data(), out.y.data(), out.z.data(), count, normalize);
+
+            Stream inPlace = in;
+            batch::TransformNormals(mat, inPlace.x.data(), inPlace.y.data(), inPlace.z.data(), inPlace.x.data(), inPlace.y.data(), inPlace.z.data(), count, normalize);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                const Vector3<float> expected = ReferenceNormal(normalMat, Vector3<float>(in.x[i], in.y[i], in.z[i]), normalize);
+                CheckPoint("TransformNormals", count, i, Vector3<float>(out.x[i], out.y[i], out.z[i]), expected);
+                CheckPoint("TransformNormals in place", count, i, Vector3<float>(inPlace.x[i], inPlace.y[i], inPlace.z[i]), expected);
+            }
+            CHECK(GuardsIntact(out, count) && GuardsIntact(inPlace, count));
+        }
+    }
+}
+
+int main()
+{
+    PointsMatchTransformVector();
+    ProjectedMatchTransformVector();
+    NormalsMatchScalar();
+
+    return test::Report("BatchTransformTests");
+}
@@ -0,0 +1,411 @@
+// BC1 / BC3 / BC7 encoders checked through a decoder written from the format specs: the decoded images have
+// to stay within an RMSE bound of the source, the SSE2 index selection has to agree with the scalar one, and
+// DDSWriter / DDSLoader have to round trip. Exits nonzero on failure. Build from the repo root:
+//   g++ -std=c++17 -O2 -ffp-contract=off -pthread -Isrc tests/BlockCompressionTests.cpp -o bin/BlockCompressionTests
+// and again with -DSR_NO_SIMD.
+
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "modules/BlockCompression.h"
+#include "modules/FileLoaders.h"
+
+#define DDS_TEST_PATH "BlockCompressionTests.dds"
+
+// Largest per channel RMSE (0-255) of a decoded smooth image, the noise added to it alone is ~2.6
+#define BC1_MAX_RMSE 6.0
+#define BC3_MAX_RMSE 6.0
+#define BC7_MAX_RMSE 5.5
+
+using namespace std;
+using namespace images;
+
+static const char* FormatName(BlockFormat format)
+{
+    switch (format)
+    {
+        case BlockFormat::BC1: return "BC1";
+        case BlockFormat::BC3: return "BC3";
+        case BlockFormat::BC7: return "BC7";
+    }
+    return "?";
+}
+
+static void Expand565(uint16_t v, int rgb[3])
+{
+    const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// 'alwaysFour' is set for the color half of BC3, which has no 3 color mode
+static void DecodeColorBlock(const unsigned char* block, bool alwaysFour, unsigned char texels[16][4])
+{
+    const uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8)), c1 = (uint16_t)(block[2] | (block[3] << 8));
+
+    int palette[4][4];
+    Expand565(c0, palette[0]);
+    Expand565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+
+    for (int c = 0; c < 3; c++)
+    {
+        if (alwaysFour || c0 > c1)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    if (!alwaysFour && c0 <= c1) palette[3][3] = 0;
+
+    const uint32_t bits = (uint32_t)block[4] | ((uint32_t)block[5] << 8) | ((uint32_t)block[6] << 16) | ((uint32_t)block[7] << 24);
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++) texels[i][c] = (unsigned char)palette[(bits >> (i * 2)) & 3][c];
+}
+
+static void DecodeAlphaBlock(const unsigned char* block, unsigned char texels[16][4])
+{
+    const int a0 = block[0], a1 = block[1];
+
+    int palette[8] = { a0, a1 };
+    if (a0 > a1)
+        for (int k = 2; k < 8; k++) palette[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+    else
+    {
+        for (int k = 2; k < 6; k++) palette[k] = ((6 - k) * a0 + (k - 1) * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++) bits |= (uint64_t)block[2 + i] << (i * 8);
+    for (int i = 0; i < 16; i++) texels[i][3] = (unsigned char)palette[(bits >> (i * 3)) & 7];
+}
+
+struct BitReader
+{
+    const unsigned char* bytes;
+    int pos = 0;
+
+    BitReader(const unsigned char* in) : bytes(in) {}
+
+    int Get(int count)
+    {
+        int value = 0;
+        for (int i = 0; i < count; i++, pos++) value |= ((bytes[pos >> 3] >> (pos & 7)) & 1) << i;
+        return value;
+    }
+};
+
+// Mode 6 only, anything else decodes to magenta so it shows up in the error
+static void DecodeBC7Block(const unsigned char* block, unsigned char texels[16][4])
+{
+    static const int interpolation[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    BitReader bits(block);
+    if (bits.Get(7) != 1 << 6)
+    {
+        for (int i = 0; i < 16; i++) { texels[i][0] = 255; texels[i][1] = 0; texels[i][2] = 255; texels[i][3] = 255; }
+        return;
+    }
+
+    int e[2][4];
+    for (int c = 0; c < 4; c++)
+    {
+        e[0][c] = bits.Get(7);
+        e[1][c] = bits.Get(7);
+    }
+    const int p0 = bits.Get(1), p1 = bits.Get(1);
+    for (int c = 0; c < 4; c++)
+    {
+        e[0][c] = (e[0][c] << 1) | p0;
+        e[1][c] = (e[1][c] << 1) | p1;
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+        const int w = interpolation[bits.Get(i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; c++) texels[i][c] = (unsigned char)(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+    }
+}
+
+static vector<unsigned char> Decode(BlockFormat format, const unsigned char* blocks, int width, int height)
+{
+    vector<unsigned char> rgba((size_t)width * height * 4);
+    const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+
+    for (int by = 0; by < blocksY; by++)
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            const unsigned char* block = blocks + ((size_t)by * blocksX + bx) * BlockBytes(format);
+
+            unsigned char texels[16][4];
+            switch (format)
+            {
+                case BlockFormat::BC1: DecodeColorBlock(block, false, texels); break;
+                case BlockFormat::BC3: DecodeColorBlock(block + 8, true, texels); DecodeAlphaBlock(block, texels); break;
+                case BlockFormat::BC7: DecodeBC7Block(block, texels); break;
+            }
+
+            // The texels past the edge were padded by the encoder, only the ones inside are kept
+            for (int y = 0; y < 4 && by * 4 + y < height; y++)
+                for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+                    memcpy(&rgba[((size_t)(by * 4 + y) * width + bx * 4 + x) * 4], texels[y * 4 + x], 4);
+        }
+
+    return rgba;
+}
+
+// Worst RMSE of the channels the format keeps, BC1 has no alpha
+static double WorstRMSE(BlockFormat format, const unsigned char* a, const unsigned char* b, int width, int height)
+{
+    const size_t texels = (size_t)width * height;
+    const int channels = format == BlockFormat::BC1 ? 3 : 4;
+
+    double worst = 0;
+    for (int c = 0; c < channels; c++)
+    {
+        double sum = 0;
+        for (size_t i = 0; i < texels; i++)
+        {
+            const double d = (double)a[i * 4 + c] - b[i * 4 + c];
+            sum += d * d;
+        }
+        worst = max(worst, sqrt(sum / texels));
+    }
+    return worst;
+}
+
+// Gradients in every channel plus a little noise, alpha included. The slopes are per texel rather than per
+// image, so narrow images aren't any steeper than wide ones.
+static vector<unsigned char> SmoothImage(mt19937 &rng, int width, int height)
+{
+    uniform_int_distribution<int> noise(-4, 4);
+    vector<unsigned char> rgba((size_t)width * height * 4);
+
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            const float u = x / 64.0f, v = y / 64.0f;
+            const float channels[4] = { 255 * u, 255 * v, 127.5f + 127.5f * sinf(6 * u + 3 * v), 255 * (1 - u * v) };
+
+            unsigned char* p = &rgba[((size_t)y * width + x) * 4];
+            for (int c = 0; c < 4; c++) p[c] = (unsigned char)min(255, max(0, (int)channels[c] + noise(rng)));
+        }
+
+    return rgba;
+}
+
+static void DecodedWithinBounds()
+{
+    mt19937 rng(2024);
+    ThreadPool pool(4);
+
+    const double maxRMSE[] = { BC1_MAX_RMSE, BC3_MAX_RMSE, BC7_MAX_RMSE };
+    const int sizes[][2] = { { 64, 64 }, { 37, 21 }, { 1, 19 }, { 130, 3 } };
+
+    for (auto const &size : sizes)
+    {
+        const int width = size[0], height = size[1];
+        const vector<unsigned char> level0 = SmoothImage(rng, width, height);
+
+        MipChain mips;
+        BuildMipChain(level0.data(), width, height, &mips);
+
+        for (BlockFormat format : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC7 })
+        {
+            CompressedImage image;
+            CompressImage(format, level0.data(), width, height, &mips, &image);
+
+            const vector<unsigned char> decoded = Decode(format, image.blocks.data(), width, height);
+            const double rmse = WorstRMSE(format, decoded.data(), level0.data(), width, height);
+            if (!CHECK(rmse <= maxRMSE[(int)format]))
+                cout << "    " << FormatName(format) << " " << width << "x" << height << ": RMSE " << rmse << endl;
+
+            // Every mip level where the layout says it is, the same blocks as compressing it on its own
+            CHECK((int)image.levels.size() == MipCount(width, height));
+            for (size_t i = 1; i < image.levels.size(); i++)
+            {
+                const BlockLevel &level = image.levels[i];
+                CompressedImage alone;
+                CompressImage(format, mips.pixels.data() + mips.levels[i - 1].offset, level.width, level.height, nullptr, &alone);
+
+                CHECK(level.offset == image.levels[i - 1].offset + image.levels[i - 1].size && level.size == alone.blocks.size());
+                CHECK(equal(alone.blocks.begin(), alone.blocks.end(), image.blocks.begin() + level.offset));
+            }
+            CHECK(image.levels.back().offset + image.levels.back().size == image.blocks.size());
+
+            // Block rows spread over the pool have to come out the same
+            CompressedImage pooled;
+            CompressImage(format, level0.data(), width, height, &mips, &pooled, &pool);
+            CHECK(pooled.blocks == image.blocks);
+        }
+    }
+}
+
+// One color everywhere decodes back exactly when the format can store it. BC7 mode 6 shares the p-bit (the
+// lowest bit) of an endpoint across its channels, so it can be 1 off.
+static void FlatBlocks()
+{
+    const int width = 12, height = 8;
+    const unsigned char colors[][4] = { { 0, 0, 0, 255 }, { 255, 255, 255, 255 }, { 8, 130, 255, 0 }, { 173, 41, 99, 200 } };
+
+    for (int n = 0; n < 4; n++)
+    {
+        const unsigned char* color = colors[n];
+        vector<unsigned char> rgba((size_t)width * height * 4);
+        for (size_t i = 0; i < rgba.size(); i++) rgba[i] = color[i % 4];
+
+        // 565 only holds the first three exactly
+        const bool fits565 = n < 3;
+
+        for (BlockFormat format : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC7 })
+        {
+            if (format != BlockFormat::BC7 && !fits565) continue;
+
+            CompressedImage image;
+            CompressImage(format, rgba.data(), width, height, nullptr, &image);
+            const vector<unsigned char> decoded = Decode(format, image.blocks.data(), width, height);
+
+            const int channels = format == BlockFormat::BC1 ? 3 : 4, tolerance = format == BlockFormat::BC7 ? 1 : 0;
+            int worst = 0;
+            for (size_t i = 0; i < rgba.size(); i++)
+                if ((int)(i % 4) < channels) worst = max(worst, abs((int)decoded[i] - rgba[i]));
+
+            if (!CHECK(worst <= tolerance))
+                cout << "    " << FormatName(format) << " color " << (int)color[0] << " " << (int)color[1] << " " << (int)color[2] << " " << (int)color[3]
+                     << " decoded as " << (int)decoded[0] << " " << (int)decoded[1] << " " << (int)decoded[2] << " " << (int)decoded[3] << endl;
+        }
+    }
+}
+
+// The scalar loop of SelectIndices(), which the SSE2 one has to match, ties to the lowest index included
+static void ScalarIndices(const BlockTexels &texels, const float (*palette)[4], int paletteSize, const float weights[4], unsigned char indices[16])
+{
+    for (int i = 0; i < 16; i++)
+    {
+        float best = 3.0e38f;
+        for (int k = 0; k < paletteSize; k++)
+        {
+            float dist = 0;
+            for (int c = 0; c < 4; c++)
+            {
+                float d = texels.c[c][i] - palette[k][c];
+                dist += d * d * weights[c];
+            }
+
+            if (dist < best)
+            {
+                best = dist;
+                indices[i] = (unsigned char)k;
+            }
+        }
+    }
+}
+
+static void IndicesMatchScalar()
+{
+    mt19937 rng(77);
+    uniform_int_distribution<int> value(0, 255), pick(0, 15);
+
+    const float weights[][4] = { { 1, 1, 1, 0 }, { 0, 0, 0, 1 }, { 1, 1, 1, 1 }, { 0.5f, 2, 0.25f, 1 } };
+    const int paletteSizes[] = { 4, 8, 16 };
+
+    for (int n = 0; n < 20000; n++)
+    {
+        BlockTexels texels;
+        for (int c = 0; c < 4; c++)
+            for (int i = 0; i < 16; i++) texels.c[c][i] = (float)value(rng);
+
+        const int paletteSize = paletteSizes[n % 3];
+        float palette[16][4];
+        for (int k = 0; k < paletteSize; k++)
+            for (int c = 0; c < 4; c++) palette[k][c] = (float)value(rng);
+
+        // Repeated entries and texels sitting right on one, so there are ties to break
+        if (n % 2) memcpy(palette[paletteSize - 1], palette[pick(rng) % (paletteSize - 1)], sizeof(palette[0]));
+        if (n % 3 == 0)
+            for (int c = 0; c < 4; c++) texels.c[c][pick(rng)] = palette[pick(rng) % paletteSize][c];
+
+        const float* w = weights[n % 4];
+        unsigned char simd[16], scalar[16];
+        SelectIndices(texels, palette, paletteSize, w, simd);
+        ScalarIndices(texels, palette, paletteSize, w, scalar);
+
+        if (!CHECK(memcmp(simd, scalar, sizeof(simd)) == 0))
+            for (int i = 0; i < 16; i++)
+                if (simd[i] != scalar[i]) cout << "    case " << n << ", texel " << i << ": " << (int)simd[i] << " != " << (int)scalar[i] << endl;
+    }
+}
+
+static vector<char> ReadFile(const char* path)
+{
+    ifstream file(path, ios::binary);
+    return vector<char>(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+static void DDSRoundTrip()
+{
+    mt19937 rng(31);
+    const int width = 37, height = 64;
+    const vector<unsigned char> level0 = SmoothImage(rng, width, height);
+
+    MipChain mips;
+    BuildMipChain(level0.data(), width, height, &mips);
+
+    for (BlockFormat format : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC7 })
+    {
+        CompressedImage image;
+        CompressImage(format, level0.data(), width, height, &mips, &image);
+        image.sourceHash = 0x0123456789ABCDEFull;
+
+        if (!CHECK(fLoaders::DDSWriter(DDS_TEST_PATH, image))) continue;
+
+        CompressedImage loaded;
+        CHECK(fLoaders::DDSLoader(DDS_TEST_PATH, &loaded));
+        CHECK(loaded.format == image.format && loaded.width == width && loaded.height == height);
+        CHECK(loaded.baseLevel == 0 && loaded.sourceHash == image.sourceHash);
+        CHECK(loaded.levels.size() == image.levels.size());
+        CHECK(loaded.blocks == image.blocks);
+
+        // Capped at 16: 37x64 -> 18x32 -> 9x16 are skipped, the rest is the tail of the full image
+        CompressedImage capped;
+        CHECK(fLoaders::DDSLoader(DDS_TEST_PATH, &capped, 16));
+        CHECK(capped.baseLevel == 2 && capped.levels.size() == image.levels.size() - 2);
+        CHECK(capped.levels[0].width == 9 && capped.levels[0].height == 16 && capped.levels[0].offset == 0);
+        CHECK(equal(capped.blocks.begin(), capped.blocks.end(), image.blocks.begin() + image.levels[2].offset)
+              && capped.blocks.size() == image.blocks.size() - image.levels[2].offset);
+
+        // A byte short of the last level has to be refused
+        vector<char> bytes = ReadFile(DDS_TEST_PATH);
+        bytes.pop_back();
+        ofstream(DDS_TEST_PATH, ios::binary | ios::trunc).write(bytes.data(), bytes.size());
+
+        CompressedImage truncated;
+        CHECK(!fLoaders::DDSLoader(DDS_TEST_PATH, &truncated));
+    }
+
+    remove(DDS_TEST_PATH);
+}
+
+int main()
+{
+    DecodedWithinBounds();
+    FlatBlocks();
+    IndicesMatchScalar();
+    DDSRoundTrip();
+
+    return test::Report("BlockCompressionTests");
+}
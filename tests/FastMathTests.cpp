@@ -0,0 +1,194 @@
+// fastmath::SinCos: the scalar, SSE2 (SinCos4), AVX2 (SinCos8) and array paths have to give the same bits for
+// any angle, NaNs included, the error bounds in FastMath.h have to hold against double precision sin/cos, and
+// NaN, infinities and huge angles must come out as NaN or as finite values in [-1, 1]. Exits nonzero on
+// failure. Build from the repo root:
+//   g++ -std=c++17 -O2 -ffp-contract=off -Isrc tests/FastMathTests.cpp -o bin/FastMathTests
+// and again with -mavx2 and with -DSR_NO_SIMD.
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "modules/FastMath.h"
+
+#define RANDOM_ANGLES 2000000
+
+#define MAX_ULP_PI 1         // |x| <= pi
+#define MAX_ULP_8192 2       // |x| <= 8192, where |result| > 0.01
+#define MAX_ABSOLUTE 7.9e-8  // |x| <= 8192, everywhere
+
+using namespace std;
+
+static float FromBits(uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, 4);
+    return value;
+}
+
+// Distance in representable floats, across zero too
+static int64_t UlpDistance(float a, float b)
+{
+    int32_t ia, ib;
+    memcpy(&ia, &a, 4);
+    memcpy(&ib, &b, 4);
+    const int64_t oa = ia < 0 ? (int64_t)INT32_MIN - ia : ia, ob = ib < 0 ? (int64_t)INT32_MIN - ib : ib;
+    return oa > ob ? oa - ob : ob - oa;
+}
+
+// Random angles over several ranges, then the edges: zeros, denormals, multiples of pi / 4 and their
+// neighbours, the clamp, huge values, infinities and NaNs
+static vector<float> TestAngles(mt19937 &rng, size_t randomCount)
+{
+    vector<float> angles;
+    const float ranges[] = { 1.0f, 3.2f, 100.0f, 8192.0f, 1e6f, 1e9f };
+    for (size_t i = 0; i < randomCount; i++)
+    {
+        uniform_real_distribution<float> angle(-ranges[i % 6], ranges[i % 6]);
+        angles.push_back(angle(rng));
+    }
+
+    const float inf = numeric_limits<float>::infinity();
+    const float edges[] = {
+        0.0f, -0.0f, FLT_MIN, -FLT_MIN, numeric_limits<float>::denorm_min(), 1e-30f, -1e-20f,
+        FASTMATH_MAX_ANGLE, -FASTMATH_MAX_ANGLE, nextafterf(FASTMATH_MAX_ANGLE, 0), nextafterf(FASTMATH_MAX_ANGLE, inf),
+        1.7e9f, 2.2e9f, 1e10f, -1e10f, 1e20f, FLT_MAX, -FLT_MAX, inf, -inf,
+        numeric_limits<float>::quiet_NaN(), -numeric_limits<float>::quiet_NaN(), numeric_limits<float>::signaling_NaN(),
+        FromBits(0x7FC12345u), FromBits(0xFF800001u)
+    };
+    angles.insert(angles.end(), begin(edges), end(edges));
+
+    for (int k = -64; k <= 64; k++)
+    {
+        const float a = (float)(k * M_PI / 4);
+        angles.push_back(a);
+        angles.push_back(nextafterf(a, -inf));
+        angles.push_back(nextafterf(a, inf));
+    }
+
+    return angles;
+}
+
+static void CheckSame(const char* path, float angle, float s, float c, float sRef, float cRef)
+{
+    if (!CHECK(test::SameBits(s, sRef) && test::SameBits(c, cRef)))
+        cout << "    " << path << ", angle " << angle << ": " << s << " " << c << " != scalar " << sRef << " " << cRef << endl;
+}
+
+static void PathsAgree()
+{
+    mt19937 rng(39);
+    const vector<float> angles = TestAngles(rng, 200003); // Leaves a tail for the array version
+
+    vector<float> sines(angles.size()), cosines(angles.size());
+    for (size_t i = 0; i < angles.size(); i++) fastmath::SinCos(angles[i], &sines[i], &cosines[i]);
+
+    // Array version, then in place
+    vector<float> s(angles.size()), c(angles.size());
+    fastmath::SinCos(angles.data(), s.data(), c.data(), angles.size());
+    for (size_t i = 0; i < angles.size(); i++) CheckSame("SinCos(array)", angles[i], s[i], c[i], sines[i], cosines[i]);
+
+    vector<float> inPlace = angles;
+    fastmath::SinCos(inPlace.data(), inPlace.data(), c.data(), inPlace.size());
+    for (size_t i = 0; i < angles.size(); i++) CheckSame("SinCos(array) in place", angles[i], inPlace[i], c[i], sines[i], cosines[i]);
+
+    // Each lane on its own too, every angle takes every lane position
+    #if defined(SR_SSE2)
+        for (size_t i = 0; i + 4 <= angles.size(); i++)
+        {
+            __m128 s4, c4;
+            fastmath::SinCos4(_mm_loadu_ps(&angles[i]), &s4, &c4);
+
+            alignas(16) float sl[4], cl[4];
+            _mm_store_ps(sl, s4);
+            _mm_store_ps(cl, c4);
+            for (int l = 0; l < 4; l++) CheckSame("SinCos4", angles[i + l], sl[l], cl[l], sines[i + l], cosines[i + l]);
+        }
+    #endif
+
+    #if defined(SR_AVX2)
+        for (size_t i = 0; i + 8 <= angles.size(); i += 3)
+        {
+            __m256 s8, c8;
+            fastmath::SinCos8(_mm256_loadu_ps(&angles[i]), &s8, &c8);
+
+            alignas(32) float sl[8], cl[8];
+            _mm256_store_ps(sl, s8);
+            _mm256_store_ps(cl, c8);
+            for (int l = 0; l < 8; l++) CheckSame("SinCos8", angles[i + l], sl[l], cl[l], sines[i + l], cosines[i + l]);
+        }
+    #endif
+}
+
+static bool WithinBounds(float angle, float value, double reference)
+{
+    if (!(fabs(value - reference) <= MAX_ABSOLUTE)) return false;
+
+    const int64_t ulps = UlpDistance(value, (float)reference);
+    if (fabs(angle) <= (float)M_PI) return ulps <= MAX_ULP_PI;
+    return fabs(reference) <= 0.01 || ulps <= MAX_ULP_8192;
+}
+
+static void WithinErrorBounds()
+{
+    mt19937 rng(40);
+    uniform_real_distribution<float> small(-(float)M_PI, (float)M_PI), large(-8192.0f, 8192.0f);
+
+    // Half over [-pi, pi], half over the whole accurate range, then a dense sweep up to pi
+    vector<float> angles;
+    for (int i = 0; i < RANDOM_ANGLES; i++) angles.push_back(i % 2 ? small(rng) : large(rng));
+    for (float a = (float)M_PI - 1e-3f; a <= (float)M_PI; a = nextafterf(a, 4.0f)) angles.push_back(a);
+
+    vector<float> sines(angles.size()), cosines(angles.size());
+    fastmath::SinCos(angles.data(), sines.data(), cosines.data(), angles.size());
+
+    size_t outOfBounds = 0;
+    for (size_t i = 0; i < angles.size(); i++)
+    {
+        const double s = sin((double)angles[i]), c = cos((double)angles[i]);
+        if (WithinBounds(angles[i], sines[i], s) && WithinBounds(angles[i], cosines[i], c)) continue;
+
+        if (outOfBounds++ < 10)
+            cout << "    SinCos(" << angles[i] << ") = " << sines[i] << " " << cosines[i] << ", expected " << (float)s << " " << (float)c
+                 << " (" << UlpDistance(sines[i], (float)s) << " and " << UlpDistance(cosines[i], (float)c) << " ULP)" << endl;
+    }
+
+    if (!CHECK(outOfBounds == 0)) cout << "    " << outOfBounds << " of " << angles.size() << " angles out of bounds." << endl;
+}
+
+static void NonFiniteAndHuge()
+{
+    const float inf = numeric_limits<float>::infinity(), nan = numeric_limits<float>::quiet_NaN();
+
+    for (float angle : { nan, -nan, inf, -inf, FromBits(0x7F800001u) })
+    {
+        float s, c;
+        fastmath::SinCos(angle, &s, &c);
+        if (!CHECK(isnan(s) && isnan(c))) cout << "    SinCos(" << angle << ") = " << s << " " << c << endl;
+    }
+
+    // Past the clamp, finite and within [-1, 1] (1e10 used to come out as infinity)
+    for (float angle : { 1e7f, 1.7e9f, 2.2e9f, 1e10f, -1e10f, 3e38f, FLT_MAX, -FLT_MAX })
+    {
+        float s, c;
+        fastmath::SinCos(angle, &s, &c);
+        if (!CHECK(fabs(s) <= 1 && fabs(c) <= 1)) cout << "    SinCos(" << angle << ") = " << s << " " << c << endl;
+    }
+
+    float s, c;
+    fastmath::SinCos(-0.0f, &s, &c);
+    CHECK(test::SameBits(s, -0.0f) && c == 1.0f);
+}
+
+int main()
+{
+    PathsAgree();
+    WithinErrorBounds();
+    NonFiniteAndHuge();
+
+    return test::Report("FastMathTests");
+}
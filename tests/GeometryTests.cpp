@@ -0,0 +1,146 @@
+// batch::ClassifyAABBs and batch::ClassifySpheres against Frustum::Classify one volume at a time, for random
+// boxes and spheres hitting all three Containment outcomes and counts that leave a scalar tail. Exits nonzero
+// on failure. Build from the repo root:
+//   g++ -std=c++17 -O2 -ffp-contract=off -Isrc tests/GeometryTests.cpp -o bin/GeometryTests
+// and again with -mavx2 and with -DSR_NO_SIMD.
+
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "modules/Geometry.h"
+
+#define VOLUMES 1003 // Not a multiple of any register width
+#define VIEWS 50
+
+using namespace std;
+
+// GL style perspective for row vectors, looking down -z
+static Matrix4x4<float> Perspective(float fovY, float aspect, float zNear, float zFar)
+{
+    const float f = 1.0f / tanf(fovY * float(DEG2RAD) / 2);
+    Matrix4x4<float> mat;
+    mat[0][0] = f / aspect;
+    mat[1][1] = f;
+    mat[2][2] = (zFar + zNear) / (zNear - zFar);
+    mat[2][3] = -1;
+    mat[3][2] = 2 * zFar * zNear / (zNear - zFar);
+    mat[3][3] = 0;
+    return mat;
+}
+
+// A camera somewhere near the origin turned any which way, the volumes are spread around it
+static Frustum<float> RandomFrustum(mt19937 &rng)
+{
+    uniform_real_distribution<float> angle(-180.0f, 180.0f), offset(-5.0f, 5.0f), fov(30.0f, 100.0f), aspect(0.5f, 2.5f);
+
+    Matrix4x4<float> view = Quaternion<float>::FromEuler(Vector3<float>(angle(rng), angle(rng), angle(rng))).ToMatrix();
+    view[3][0] = offset(rng); view[3][1] = offset(rng); view[3][2] = offset(rng);
+
+    return Frustum<float>::FromMatrix(Matrix4x4<float>::Chain(view, Perspective(fov(rng), aspect(rng), 0.5f, 60.0f)));
+}
+
+static const char* Name(Containment c)
+{
+    return c == Containment::Outside ? "Outside" : c == Containment::Intersecting ? "Intersecting" : "Inside";
+}
+
+static void CheckResults(const char* kernel, size_t count, const vector<Containment> &results, const vector<Containment> &expected)
+{
+    for (size_t i = 0; i < count; i++)
+        if (!CHECK(results[i] == expected[i]))
+        {
+            cout << "    " << kernel << ", count " << count << ", volume " << i << ": " << Name(results[i]) << ", expected " << Name(expected[i]) << endl;
+            break;
+        }
+}
+
+static void Tally(const vector<Containment> &results, size_t count, size_t outcomes[3])
+{
+    for (size_t i = 0; i < count; i++) outcomes[(int)results[i]]++;
+}
+
+// Tails of every width, then the full set
+static const size_t counts[] = { 0, 1, 3, 5, 7, 9, 17, 33, VOLUMES };
+
+static void BoxesMatchClassify()
+{
+    mt19937 rng(42);
+    uniform_real_distribution<float> position(-30.0f, 30.0f), size(0.0f, 6.0f);
+
+    size_t outcomes[3] = {};
+    for (int view = 0; view < VIEWS; view++)
+    {
+        const Frustum<float> frustum = RandomFrustum(rng);
+
+        Vector3Stream<float> centers, extents;
+        for (int i = 0; i < VOLUMES; i++)
+        {
+            centers.PushBack(Vector3<float>(position(rng), position(rng), position(rng)));
+            extents.PushBack(Vector3<float>(size(rng), size(rng), size(rng)));
+        }
+
+        vector<Containment> expected(VOLUMES);
+        for (size_t i = 0; i < VOLUMES; i++) expected[i] = frustum.Classify(centers.Get(i), extents.Get(i));
+
+        for (size_t count : counts)
+        {
+            vector<Containment> results(VOLUMES, (Containment)0xFF);
+            batch::ClassifyAABBs(frustum, centers.get_x(), centers.get_y(), centers.get_z(), extents.get_x(), extents.get_y(), extents.get_z(), results.data(), count);
+            CheckResults("ClassifyAABBs", count, results, expected);
+            CHECK(count == VOLUMES || results[count] == (Containment)0xFF);
+        }
+
+        // The stream overload, over the whole set
+        vector<Containment> results(VOLUMES);
+        batch::ClassifyAABBs(frustum, centers, extents, results.data());
+        CheckResults("ClassifyAABBs, streams", VOLUMES, results, expected);
+
+        Tally(expected, VOLUMES, outcomes);
+    }
+
+    // Each outcome has to turn up often, or the comparison above proves little
+    if (!CHECK(outcomes[0] > VIEWS * VOLUMES / 20 && outcomes[1] > VIEWS * VOLUMES / 20 && outcomes[2] > VIEWS * VOLUMES / 20))
+        cout << "    Boxes outside " << outcomes[0] << ", intersecting " << outcomes[1] << ", inside " << outcomes[2] << endl;
+}
+
+static void SpheresMatchClassify()
+{
+    mt19937 rng(43);
+    uniform_real_distribution<float> position(-30.0f, 30.0f), size(0.0f, 8.0f);
+
+    size_t outcomes[3] = {};
+    for (int view = 0; view < VIEWS; view++)
+    {
+        const Frustum<float> frustum = RandomFrustum(rng);
+
+        vector<float> cx(VOLUMES), cy(VOLUMES), cz(VOLUMES), radii(VOLUMES);
+        vector<Containment> expected(VOLUMES);
+        for (size_t i = 0; i < VOLUMES; i++)
+        {
+            cx[i] = position(rng); cy[i] = position(rng); cz[i] = position(rng); radii[i] = size(rng);
+            expected[i] = frustum.Classify(Sphere<float>(Vector3<float>(cx[i], cy[i], cz[i]), radii[i]));
+        }
+
+        for (size_t count : counts)
+        {
+            vector<Containment> results(VOLUMES, (Containment)0xFF);
+            batch::ClassifySpheres(frustum, cx.data(), cy.data(), cz.data(), radii.data(), results.data(), count);
+            CheckResults("ClassifySpheres", count, results, expected);
+            CHECK(count == VOLUMES || results[count] == (Containment)0xFF);
+        }
+
+        Tally(expected, VOLUMES, outcomes);
+    }
+
+    if (!CHECK(outcomes[0] > VIEWS * VOLUMES / 20 && outcomes[1] > VIEWS * VOLUMES / 20 && outcomes[2] > VIEWS * VOLUMES / 20))
+        cout << "    Spheres outside " << outcomes[0] << ", intersecting " << outcomes[1] << ", inside " << outcomes[2] << endl;
+}
+
+int main()
+{
+    BoxesMatchClassify();
+    SpheresMatchClassify();
+
+    return test::Report("GeometryTests");
+}
@@ -0,0 +1,324 @@
+// LinearAlgebra correctness checks, exits nonzero on failure. Build from the repo root:
+//   g++ -std=c++17 -O2 -ffp-contract=off -Isrc tests/LinearAlgebraTests.cpp src/Transform.cpp -o bin/LinearAlgebraTests
+// and again with -mavx2 and with -DSR_NO_SIMD, every SIMD path has to agree with the scalar one. Expected
+// to fail with -mfma -DSR_MATRIX_FMA, the fused paths round differently. The inverses and the quaternion
+// identities are only checked within a tolerance, those pass either way.
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "Test.h"
+#include "Transform.h"
+#include "modules/FastMath.h"
+#include "modules/LinearAlgebra.h"
+
+#define RANDOM_MATRICES 20000
+#define RANDOM_TRANSFORMS 20000
+#define RANDOM_QUATERNIONS 20000
+
+// InvertedRigid() and InvertedAffine() against Inverted(), per element: |a - b| <= tolerance * (1 + largest
+// |b| in the row). Relative to the row, not the element, since a small term of a large translation only
+// keeps the precision of the largest one.
+#define INVERSE_TOLERANCE 1e-4f
+
+// Rotation matrices and quaternions built two ways, absolute since every element is within [-1, 1]
+#define ROTATION_TOLERANCE 1e-5f
+
+using namespace std;
+
+static Matrix4x4<float> RandomMatrix(mt19937 &rng)
+{
+    // Mixed magnitudes, so the sums round differently depending on the order they're added in
+    uniform_real_distribution<float> value(-1.0f, 1.0f);
+    uniform_int_distribution<int> exponent(-20, 20);
+
+    Matrix4x4<float> mat;
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            mat[r][c] = ldexp(value(rng), exponent(rng));
+    return mat;
+}
+
+static Matrix4x4<float> Filled(float value)
+{
+    Matrix4x4<float> mat;
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            mat[r][c] = value;
+    return mat;
+}
+
+static void CheckMultiply(const Matrix4x4<float> &a, const Matrix4x4<float> &b)
+{
+    const Matrix4x4<float> simd = Matrix4x4<float>::Multiply(a, b);
+    const Matrix4x4<float> scalar = Matrix4x4<float>::MultiplyScalar(a, b);
+
+    if (!CHECK(test::SameBits(simd, scalar)))
+    {
+        for (int r = 0; r < 4; r++)
+            for (int c = 0; c < 4; c++)
+                if (!test::SameBits(simd[r][c], scalar[r][c]))
+                    cout << "    [" << r << "][" << c << "] " << simd[r][c] << " != " << scalar[r][c] << endl;
+    }
+}
+
+static void MultiplyMatchesScalar()
+{
+    mt19937 rng(1234);
+
+    for (int i = 0; i < RANDOM_MATRICES; i++) CheckMultiply(RandomMatrix(rng), RandomMatrix(rng));
+
+    // Every special value in every slot of A, then of B, against a random other side
+    const float specials[] = {
+        0.0f, -0.0f, FLT_MIN, -FLT_MIN, FLT_MIN / 4, -FLT_MIN / 1024, numeric_limits<float>::denorm_min(),
+        FLT_MAX, -FLT_MAX, numeric_limits<float>::infinity(), -numeric_limits<float>::infinity(),
+        numeric_limits<float>::quiet_NaN()
+    };
+
+    for (float special : specials)
+    {
+        for (int slot = 0; slot < 16; slot++)
+        {
+            Matrix4x4<float> a = RandomMatrix(rng), b = RandomMatrix(rng);
+            a[slot / 4][slot % 4] = special;
+            CheckMultiply(a, b);
+
+            a = RandomMatrix(rng);
+            b[slot / 4][slot % 4] = special;
+            CheckMultiply(a, b);
+        }
+
+        // Whole matrices of it, and with zeros so inf * 0 makes NaNs
+        CheckMultiply(Filled(special), RandomMatrix(rng));
+        CheckMultiply(RandomMatrix(rng), Filled(special));
+        CheckMultiply(Filled(special), Filled(0.0f));
+        CheckMultiply(Filled(-0.0f), Filled(special));
+    }
+
+    // Products that underflow into denormals, or cancel out to a signed zero
+    CheckMultiply(Filled(1e-20f), Filled(1e-20f));
+    CheckMultiply(Filled(FLT_MIN), Filled(0.5f));
+    CheckMultiply(Filled(1.0f), Filled(-1.0f));
+    CheckMultiply(Filled(-0.0f), Filled(-0.0f));
+    CheckMultiply(Filled(-0.0f), Filled(1.0f));
+
+    // Chain() folds through Multiply(), it has to agree with the scalar chain as well
+    const Matrix4x4<float> a = RandomMatrix(rng), b = RandomMatrix(rng), c = RandomMatrix(rng), d = RandomMatrix(rng);
+    CHECK(test::SameBits(Matrix4x4<float>::Chain(a, b, c, d), Matrix4x4<float>::ChainScalar(a, b, c, d)));
+}
+
+// Rotation from random Euler angles, then 'scale' per axis, then a translation
+static Matrix4x4<float> TRS(mt19937 &rng, const Vector3<float> &scale)
+{
+    uniform_real_distribution<float> angle(-180.0f, 180.0f), offset(-100.0f, 100.0f);
+
+    Matrix4x4<float> mat = Quaternion<float>::FromEuler(Vector3<float>(angle(rng), angle(rng), angle(rng))).ToMatrix();
+    for (int c = 0; c < 3; c++)
+    {
+        mat[0][c] *= scale.x;
+        mat[1][c] *= scale.y;
+        mat[2][c] *= scale.z;
+    }
+    mat[3][0] = offset(rng); mat[3][1] = offset(rng); mat[3][2] = offset(rng);
+    return mat;
+}
+
+static bool CloseTo(const Matrix4x4<float> &a, const Matrix4x4<float> &b, float tolerance)
+{
+    for (int r = 0; r < 4; r++)
+    {
+        float largest = 0;
+        for (int c = 0; c < 4; c++) largest = max(largest, fabs(b[r][c]));
+
+        for (int c = 0; c < 4; c++)
+            if (!(fabs(a[r][c] - b[r][c]) <= tolerance * (1 + largest))) return false;
+    }
+    return true;
+}
+
+static void CheckInverse(const char* name, const Matrix4x4<float> &inverse, const Matrix4x4<float> &reference)
+{
+    if (!CHECK(CloseTo(inverse, reference, INVERSE_TOLERANCE))) cout << "    " << name << "\n" << inverse << "\n    expected\n" << reference << endl;
+}
+
+static void InversesMatchInverted()
+{
+    mt19937 rng(5678);
+    uniform_real_distribution<float> magnitude(0.1f, 10.0f);
+    uniform_int_distribution<int> sign(0, 1);
+    auto signedMagnitude = [&] { return sign(rng) ? magnitude(rng) : -magnitude(rng); };
+
+    for (int i = 0; i < RANDOM_TRANSFORMS; i++)
+    {
+        // Rigid, where both shortcuts apply
+        const Matrix4x4<float> rigid = TRS(rng, Vector3<float>(1, 1, 1));
+        CheckInverse("InvertedRigid", rigid.InvertedRigid(), rigid.Inverted());
+        CheckInverse("InvertedAffine, rigid", rigid.InvertedAffine(), rigid.Inverted());
+
+        // Uniform, non-uniform, then negative (mirroring) scales
+        const float uniform = magnitude(rng);
+        const Matrix4x4<float> scaled = TRS(rng, Vector3<float>(uniform, uniform, uniform));
+        CheckInverse("InvertedAffine, uniform scale", scaled.InvertedAffine(), scaled.Inverted());
+
+        const Matrix4x4<float> nonUniform = TRS(rng, Vector3<float>(magnitude(rng), magnitude(rng), magnitude(rng)));
+        CheckInverse("InvertedAffine, non-uniform scale", nonUniform.InvertedAffine(), nonUniform.Inverted());
+
+        const Matrix4x4<float> mirrored = TRS(rng, Vector3<float>(signedMagnitude(), signedMagnitude(), -magnitude(rng)));
+        CheckInverse("InvertedAffine, negative scale", mirrored.InvertedAffine(), mirrored.Inverted());
+
+        // Scaled then rotated again, which shears
+        const Matrix4x4<float> sheared = Matrix4x4<float>::Multiply(nonUniform, TRS(rng, Vector3<float>(1, 1, 1)));
+        CheckInverse("InvertedAffine, sheared", sheared.InvertedAffine(), sheared.Inverted());
+    }
+
+    // A flattened axis has no inverse, identity back like Inverted()
+    const Matrix4x4<float> flat = TRS(rng, Vector3<float>(1, 0, 1));
+    CHECK(test::SameBits(flat.InvertedAffine(), Matrix4x4<float>()));
+}
+
+static Quaternion<float> RandomRotation(mt19937 &rng)
+{
+    uniform_real_distribution<float> angle(-180.0f, 180.0f);
+    return Quaternion<float>::FromEuler(Vector3<float>(angle(rng), angle(rng), angle(rng)));
+}
+
+static void CheckQuaternionMultiply(const Quaternion<float> &a, const Quaternion<float> &b)
+{
+    const Quaternion<float> simd = Quaternion<float>::Multiply(a, b), scalar = Quaternion<float>::MultiplyScalar(a, b);
+    if (!CHECK(test::SameBits(simd.x, scalar.x) && test::SameBits(simd.y, scalar.y) && test::SameBits(simd.z, scalar.z) && test::SameBits(simd.w, scalar.w)))
+        cout << "    " << a << " * " << b << ": " << simd << " != " << scalar << endl;
+}
+
+static void QuaternionMultiplyMatchesScalar()
+{
+    mt19937 rng(4321);
+    uniform_real_distribution<float> value(-1.0f, 1.0f);
+    uniform_int_distribution<int> exponent(-20, 20);
+    auto component = [&] { return ldexp(value(rng), exponent(rng)); };
+
+    for (int i = 0; i < RANDOM_QUATERNIONS; i++)
+    {
+        CheckQuaternionMultiply(RandomRotation(rng), RandomRotation(rng));
+
+        // Not unit length, mixed magnitudes
+        CheckQuaternionMultiply(Quaternion<float>(component(), component(), component(), component()),
+                                Quaternion<float>(component(), component(), component(), component()));
+    }
+
+    // Signed zeros (x - y and x + -y only agree if the sign flips are right), denormals and overflow in every slot.
+    // No NaN inputs: which NaN comes out of a sum of two isn't defined.
+    const float specials[] = {
+        0.0f, -0.0f, FLT_MIN / 4, -numeric_limits<float>::denorm_min(), FLT_MAX, -FLT_MAX,
+        numeric_limits<float>::infinity(), -numeric_limits<float>::infinity()
+    };
+    for (float special : specials)
+        for (int slot = 0; slot < 8; slot++)
+        {
+            float components[8];
+            for (float &c : components) c = component();
+            components[slot] = special;
+            CheckQuaternionMultiply(Quaternion<float>(components[0], components[1], components[2], components[3]),
+                                    Quaternion<float>(components[4], components[5], components[6], components[7]));
+
+            // The whole other side zeros, of either sign
+            CheckQuaternionMultiply(Quaternion<float>(components[0], components[1], components[2], components[3]), Quaternion<float>(-0.0f, 0.0f, -0.0f, 0.0f));
+            CheckQuaternionMultiply(Quaternion<float>(-0.0f, -0.0f, 0.0f, -0.0f), Quaternion<float>(components[4], components[5], components[6], components[7]));
+        }
+}
+
+// a * b rotates by b first, so with row vectors ToMatrix(a * b) == ToMatrix(b) * ToMatrix(a)
+static void QuaternionProductMatchesMatrices()
+{
+    mt19937 rng(8765);
+    for (int i = 0; i < RANDOM_QUATERNIONS; i++)
+    {
+        const Quaternion<float> a = RandomRotation(rng), b = RandomRotation(rng);
+        const Matrix4x4<float> product = (a * b).ToMatrix(), expected = b.ToMatrix() * a.ToMatrix();
+        if (!CHECK(CloseTo(product, expected, ROTATION_TOLERANCE))) cout << "    " << a << " * " << b << "\n" << product << "\n    expected\n" << expected << endl;
+
+        // And Rotate() is the same as going through the matrix
+        const Vector3<float> v(1.5f, -2.0f, 0.25f);
+        const Vector3<float> rotated = a.Rotate(v), expectedRotated = a.ToMatrix() * v;
+        CHECK(fabs(rotated.x - expectedRotated.x) <= 4 * ROTATION_TOLERANCE && fabs(rotated.y - expectedRotated.y) <= 4 * ROTATION_TOLERANCE
+              && fabs(rotated.z - expectedRotated.z) <= 4 * ROTATION_TOLERANCE);
+    }
+}
+
+static void FromEulerMatchesReferences()
+{
+    mt19937 rng(2468);
+    uniform_real_distribution<float> angle(-720.0f, 720.0f);
+
+    for (int i = 0; i < RANDOM_QUATERNIONS; i++)
+    {
+        const Vector3<float> euler(angle(rng), angle(rng), angle(rng));
+        const Quaternion<float> q = Quaternion<float>::FromEuler(euler);
+
+        // The SSE2 path (SinCos4 over the three half angles) against the scalar fastmath one, same bits
+        float sx, cx, sy, cy, sz, cz;
+        fastmath::SinCos(euler.x * float(DEG2RAD) / 2, &sx, &cx);
+        fastmath::SinCos(euler.y * float(DEG2RAD) / 2, &sy, &cy);
+        fastmath::SinCos(euler.z * float(DEG2RAD) / 2, &sz, &cz);
+        const Quaternion<float> scalar(sx * cy * cz - cx * sy * sz, cx * sy * cz + sx * cy * sz, cx * cy * sz - sx * sy * cz, cx * cy * cz + sx * sy * sz);
+        if (!CHECK(test::SameBits(q.x, scalar.x) && test::SameBits(q.y, scalar.y) && test::SameBits(q.z, scalar.z) && test::SameBits(q.w, scalar.w)))
+            cout << "    FromEuler" << euler << ": " << q << " != " << scalar << endl;
+
+        // The double path, std::sin / std::cos
+        const Quaternion<double> precise = Quaternion<double>::FromEuler(Vector3<double>(euler.x, euler.y, euler.z));
+        if (!CHECK(fabs(q.x - precise.x) <= ROTATION_TOLERANCE && fabs(q.y - precise.y) <= ROTATION_TOLERANCE
+                   && fabs(q.z - precise.z) <= ROTATION_TOLERANCE && fabs(q.w - precise.w) <= ROTATION_TOLERANCE))
+            cout << "    FromEuler" << euler << ": " << q << ", double " << precise << endl;
+
+        // Around x first, then y, then z, like the RX / RY / RZ matrices
+        const float tx = euler.x * float(DEG2RAD), ty = euler.y * float(DEG2RAD), tz = euler.z * float(DEG2RAD);
+        const Matrix4x4<float> rx(RX_MATRIXf(tx)), ry(RY_MATRIXf(ty)), rz(RZ_MATRIXf(tz));
+        CHECK(CloseTo(q.ToMatrix(), rx * ry * rz, ROTATION_TOLERANCE));
+    }
+}
+
+static bool Near(const Vector3<float> &a, const Vector3<float> &b)
+{
+    return fabs(a.x - b.x) <= ROTATION_TOLERANCE && fabs(a.y - b.y) <= ROTATION_TOLERANCE && fabs(a.z - b.z) <= ROTATION_TOLERANCE;
+}
+
+// Transform::Rotate() turns around the object's own axes, on top of the orientation it already has
+static void RotateUsesLocalAxes()
+{
+    // Yawed 90 degrees its local x points down world -z; 90 more around that local x takes its local y
+    // (world +y) onto its local z (world +x). Around world x it would have gone to world +z instead.
+    Transform transform(Vector3<float>(0, 0, 0), Vector3<float>(0, 90, 0));
+    CHECK(Near(transform.LocalToWorld() * Vector3<float>(1, 0, 0), Vector3<float>(0, 0, -1)));
+
+    transform.Rotate(90, 0, 0);
+    const Vector3<float> localY = transform.LocalToWorld() * Vector3<float>(0, 1, 0);
+    if (!CHECK(Near(localY, Vector3<float>(1, 0, 0)))) cout << "    Local y went to " << localY << endl;
+
+    // Random steps compose the same way: delta first, then the orientation so far
+    mt19937 rng(1357);
+    uniform_real_distribution<float> angle(-30.0f, 30.0f);
+
+    Transform spun(Vector3<float>(0, 0, 0), Vector3<float>(10, 20, 30));
+    Matrix4x4<float> expected = spun.LocalToWorld();
+    for (int i = 0; i < 100; i++)
+    {
+        const Vector3<float> delta(angle(rng), angle(rng), angle(rng));
+        spun.Rotate(delta.x, delta.y, delta.z);
+        expected = Quaternion<float>::FromEuler(delta).ToMatrix() * expected;
+    }
+    if (!CHECK(CloseTo(spun.LocalToWorld(), expected, 10 * ROTATION_TOLERANCE))) cout << "    " << spun.LocalToWorld() << "\n    expected\n" << expected << endl;
+}
+
+int main()
+{
+    MultiplyMatchesScalar();
+    InversesMatchInverted();
+    QuaternionMultiplyMatchesScalar();
+    QuaternionProductMatchesMatrices();
+    FromEulerMatchesReferences();
+    RotateUsesLocalAxes();
+
+    return test::Report("LinearAlgebraTests");
+}
@@ -0,0 +1,130 @@
+// images::DownsampleBox and BuildMipChain against a plain scalar box filter, bit for bit, on odd and non power
+// of two sizes including 1xN and Nx1. Exits nonzero on failure. Build from the repo root:
+//   g++ -std=c++17 -O2 -Isrc tests/MipMapsTests.cpp -o bin/MipMapsTests
+// and again with -DSR_NO_SIMD.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "modules/MipMaps.h"
+
+#define GUARD_BYTES 64  // Past the end of every output, must come back untouched
+#define GUARD_VALUE 0xCD
+
+using namespace std;
+using namespace images;
+
+// The scalar tail of DownsampleBox() over the whole row, which the SSE2 loop has to match
+static void ReferenceDownsample(const unsigned char* src, int srcW, int srcH, unsigned char* dst, int dstW, int dstH)
+{
+    for (int y = 0; y < dstH; y++)
+        for (int x = 0; x < dstW; x++)
+        {
+            const int x0 = min(2 * x, srcW - 1), x1 = min(2 * x + 1, srcW - 1);
+            const int y0 = min(2 * y, srcH - 1), y1 = min(2 * y + 1, srcH - 1);
+
+            for (int c = 0; c < 4; c++)
+            {
+                const int sum = src[((size_t)y0 * srcW + x0) * 4 + c] + src[((size_t)y0 * srcW + x1) * 4 + c]
+                              + src[((size_t)y1 * srcW + x0) * 4 + c] + src[((size_t)y1 * srcW + x1) * 4 + c];
+                dst[((size_t)y * dstW + x) * 4 + c] = (unsigned char)((sum + 2) >> 2);
+            }
+        }
+}
+
+static vector<unsigned char> RandomImage(mt19937 &rng, int width, int height)
+{
+    uniform_int_distribution<int> value(0, 255);
+    vector<unsigned char> rgba((size_t)width * height * 4);
+    for (auto &v : rgba) v = (unsigned char)value(rng);
+    return rgba;
+}
+
+static void DownsampleMatchesReference()
+{
+    mt19937 rng(11);
+    const int sizes[] = { 1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 33, 100, 129 };
+
+    for (int srcW : sizes)
+        for (int srcH : sizes)
+        {
+            const vector<unsigned char> src = RandomImage(rng, srcW, srcH);
+            const int dstW = max(1, srcW / 2), dstH = max(1, srcH / 2);
+            const size_t dstBytes = (size_t)dstW * dstH * 4;
+
+            vector<unsigned char> dst(dstBytes + GUARD_BYTES, GUARD_VALUE), reference(dstBytes);
+            DownsampleBox(src.data(), srcW, srcH, dst.data(), dstW, dstH);
+            ReferenceDownsample(src.data(), srcW, srcH, reference.data(), dstW, dstH);
+
+            if (!CHECK(equal(reference.begin(), reference.end(), dst.begin())))
+                cout << "    " << srcW << "x" << srcH << " -> " << dstW << "x" << dstH << endl;
+
+            CHECK(all_of(dst.begin() + dstBytes, dst.end(), [](unsigned char v) { return v == GUARD_VALUE; }));
+        }
+
+    // Extremes of the rounding: all 255 has to stay 255 (no wrap in the 16 bit sums), 1.5 rounds up
+    const int width = 64, height = 4;
+    vector<unsigned char> white((size_t)width * height * 4, 255), dst((size_t)width * height, 0);
+    DownsampleBox(white.data(), width, height, dst.data(), width / 2, height / 2);
+    CHECK(all_of(dst.begin(), dst.end(), [](unsigned char v) { return v == 255; }));
+
+    vector<unsigned char> halves((size_t)width * height * 4);
+    for (size_t i = 0; i < halves.size(); i++) halves[i] = (unsigned char)(1 + (i / 4) % 2);
+    DownsampleBox(halves.data(), width, height, dst.data(), width / 2, height / 2);
+    CHECK(all_of(dst.begin(), dst.end(), [](unsigned char v) { return v == 2; }));
+}
+
+static void ChainMatchesReference()
+{
+    mt19937 rng(12);
+    const int sizes[][2] = { { 1, 1 }, { 1, 37 }, { 53, 1 }, { 2, 2 }, { 640, 480 }, { 257, 129 }, { 1000, 3 }, { 3, 1000 } };
+
+    for (auto const &size : sizes)
+    {
+        const int width = size[0], height = size[1];
+        const vector<unsigned char> level0 = RandomImage(rng, width, height);
+
+        MipChain chain;
+        BuildMipChain(level0.data(), width, height, &chain);
+        CHECK((int)chain.levels.size() == MipCount(width, height) - 1);
+
+        // Each level from the reference filter over the previous level of the chain
+        vector<unsigned char> src = level0;
+        int srcW = width, srcH = height;
+        size_t offset = 0;
+        for (size_t i = 0; i < chain.levels.size(); i++)
+        {
+            const MipLevel &level = chain.levels[i];
+            CHECK(level.width == max(1, srcW / 2) && level.height == max(1, srcH / 2) && level.offset == offset);
+
+            vector<unsigned char> reference((size_t)level.width * level.height * 4);
+            ReferenceDownsample(src.data(), srcW, srcH, reference.data(), level.width, level.height);
+
+            if (!CHECK(equal(reference.begin(), reference.end(), chain.pixels.begin() + level.offset)))
+                cout << "    " << width << "x" << height << ", level " << i + 1 << " (" << level.width << "x" << level.height << ")" << endl;
+
+            src = reference;
+            srcW = level.width;
+            srcH = level.height;
+            offset += reference.size();
+        }
+        CHECK(chain.pixels.size() == offset);
+        CHECK(chain.levels.empty() || (chain.levels.back().width == 1 && chain.levels.back().height == 1));
+
+        // Capped, the first levels of the full chain
+        MipChain capped;
+        BuildMipChain(level0.data(), width, height, &capped, 2);
+        CHECK(capped.levels.size() == min<size_t>(2, chain.levels.size()));
+        CHECK(equal(capped.pixels.begin(), capped.pixels.end(), chain.pixels.begin()));
+    }
+}
+
+int main()
+{
+    DownsampleMatchesReference();
+    ChainMatchesReference();
+
+    return test::Report("MipMapsTests");
+}
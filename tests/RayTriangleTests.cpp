@@ -0,0 +1,349 @@
+// batch::IntersectTriangles, batch::IntersectPackets and BVH::Intersect (over bin/objs meshes) against a plain
+// loop over Ray::IntersectTriangle, hits must agree bit for bit, and a BVH saved and loaded back has to be
+// the one that was built. Exits nonzero on failure. Build and run from the repo root:
+//   g++ -std=c++17 -O2 -ffp-contract=off -Isrc tests/RayTriangleTests.cpp -o bin/RayTriangleTests -pthread
+// and again with -mavx2 and with -DSR_NO_SIMD.
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "modules/BVH.h"
+#include "modules/FileLoaders.h"
+#include "modules/RayTriangle.h"
+
+#define TRIANGLES 1027      // Not a multiple of any register width, so the scalar tail runs too
+#define RAYS 1031
+
+#define MESH_GRID 24        // Rays per side of the grid shot at a mesh from each of the six axis directions
+#define MESH_INNER_RAYS 1031
+#define BVH_TEST_FILE "RayTriangleTests.bvh"
+
+using namespace std;
+
+// Closest hit, ties to the lowest index
+static RayHit Reference(const Ray<float> &ray, const TriangleStream &tris, float tMax)
+{
+    RayHit hit;
+    float best = tMax;
+    for (size_t i = 0; i < tris.size(); i++)
+    {
+        float t, u, v;
+        if (!ray.IntersectTriangle(tris.v0.Get(i), tris.edge1.Get(i), tris.edge2.Get(i), best, &t, &u, &v)) continue;
+        best = hit.t = t; hit.u = u; hit.v = v;
+        hit.triangle = (int)i;
+    }
+    return hit;
+}
+
+static bool SameHit(const RayHit &a, const RayHit &b)
+{
+    return a.triangle == b.triangle && test::SameBits(a.t, b.t) && test::SameBits(a.u, b.u) && test::SameBits(a.v, b.v);
+}
+
+static void CheckHit(const char* kernel, size_t ray, const RayHit &hit, const RayHit &reference)
+{
+    if (!CHECK(SameHit(hit, reference)))
+        cout << "    " << kernel << ", ray " << ray << ": triangle " << hit.triangle << " t " << hit.t
+             << ", expected triangle " << reference.triangle << " t " << reference.t << endl;
+}
+
+// Every ray through both kernels, with and without a tMax cutting some hits off
+static void CheckRays(const Vector3Stream<float> &origins, const Vector3Stream<float> &directions, const TriangleStream &tris)
+{
+    const float tMaxes[] = { numeric_limits<float>::infinity(), 15.0f };
+    for (float tMax : tMaxes)
+    {
+        vector<RayHit> references(origins.size());
+        size_t referenceHits = 0;
+        for (size_t r = 0; r < origins.size(); r++)
+        {
+            references[r] = Reference(Ray<float>(origins.Get(r), directions.Get(r)), tris, tMax);
+            referenceHits += references[r].Hit();
+        }
+
+        for (size_t r = 0; r < origins.size(); r++)
+        {
+            RayHit hit;
+            const bool found = batch::IntersectTriangles(Ray<float>(origins.Get(r), directions.Get(r)), tris, &hit, tMax);
+            CHECK(found == references[r].Hit());
+            CheckHit("IntersectTriangles", r, hit, references[r]);
+        }
+
+        vector<RayHit> hits(origins.size());
+        CHECK(batch::IntersectPackets(origins, directions, tris, hits.data(), tMax) == referenceHits);
+        for (size_t r = 0; r < origins.size(); r++) CheckHit("IntersectPackets", r, hits[r], references[r]);
+
+        // Make sure the soup is actually being hit, or all of the above proves nothing
+        CHECK(referenceHits > origins.size() / 10);
+    }
+}
+
+static void RandomSoup(mt19937 &rng, TriangleStream* tris)
+{
+    uniform_real_distribution<float> position(-10, 10), edge(-3, 3);
+    for (int i = 0; i < TRIANGLES; i++)
+    {
+        const Vector3<float> a(position(rng), position(rng), position(rng));
+        tris->PushBack(a, a + Vector3<float>(edge(rng), edge(rng), edge(rng)), a + Vector3<float>(edge(rng), edge(rng), edge(rng)));
+    }
+}
+
+// From in front of the soup towards random points inside it
+static void RandomRays(mt19937 &rng, Vector3Stream<float>* origins, Vector3Stream<float>* directions)
+{
+    uniform_real_distribution<float> position(-10, 10);
+    for (int r = 0; r < RAYS; r++)
+    {
+        const Vector3<float> origin(position(rng), position(rng), 20);
+        origins->PushBack(origin);
+        directions->PushBack((Vector3<float>(position(rng), position(rng), position(rng)) - origin).Normalized());
+    }
+}
+
+static void RandomTriangles()
+{
+    mt19937 rng(42);
+    TriangleStream tris;
+    Vector3Stream<float> origins, directions;
+    RandomSoup(rng, &tris);
+    RandomRays(rng, &origins, &directions);
+
+    CheckRays(origins, directions, tris);
+}
+
+// Copies of the same triangle at the same t, in the same register and across registers and the tail: the
+// lowest index has to win everywhere
+static void DuplicateTriangles()
+{
+    mt19937 rng(7);
+    TriangleStream tris;
+    RandomSoup(rng, &tris);
+
+    const int copies[] = { 3, 4, 17, 31, 32, 600, TRIANGLES - 2, TRIANGLES - 1 };
+    const Vector3<float> a(-8, -8, 12), b(8, -8, 12), c(0, 8, 12);
+    for (int i : copies)
+    {
+        tris.v0.Set(i, a);
+        tris.edge1.Set(i, b - a);
+        tris.edge2.Set(i, c - a);
+    }
+
+    Vector3Stream<float> origins, directions;
+    RandomRays(rng, &origins, &directions);
+
+    CheckRays(origins, directions, tris);
+
+    // Straight through the shared triangle, in front of everything else
+    RayHit hit;
+    CHECK(batch::IntersectTriangles(Ray<float>(Vector3<float>(0, 0, 20), Vector3<float>(0, 0, -1)), tris, &hit));
+    CHECK(hit.triangle == 3);
+}
+
+// Zero area (collapsed to a point or a segment) and edge-on triangles never hit, NaN or not in the lanes
+static void DegenerateTriangles()
+{
+    mt19937 rng(99);
+    TriangleStream tris;
+    RandomSoup(rng, &tris);
+
+    uniform_int_distribution<int> index(0, TRIANGLES - 1);
+    for (int n = 0; n < TRIANGLES / 4; n++)
+    {
+        const int i = index(rng);
+        const Vector3<float> edge1 = tris.edge1.Get(i);
+        switch (n % 4)
+        {
+            case 0: tris.edge1.Set(i, Vector3<float>(0, 0, 0)); tris.edge2.Set(i, Vector3<float>(0, 0, 0)); break;
+            case 1: tris.edge2.Set(i, edge1 * 0.5f); break;
+            case 2: tris.edge2.Set(i, edge1); break;
+            case 3: tris.edge1.Set(i, Vector3<float>(0, 0, 0)); break;
+        }
+    }
+
+    // Edge-on to rays going down -z: both edges in a plane containing the direction
+    for (int i = 0; i < 16; i++) tris.PushBack(Vector3<float>(float(i) - 8, -5, 10), Vector3<float>(float(i) - 8, 5, 10), Vector3<float>(float(i) - 8, 0, -10));
+
+    Vector3Stream<float> origins, directions;
+    RandomRays(rng, &origins, &directions);
+    for (int i = 0; i < 16; i++)
+    {
+        origins.PushBack(Vector3<float>(float(i) - 8, 0, 20));
+        directions.PushBack(Vector3<float>(0, 0, -1));
+    }
+
+    CheckRays(origins, directions, tris);
+}
+
+// Meshes with long thin triangles (buso) and a closed one (the teapot), so plenty of triangles share edges
+static const char* meshes[] = { "bin/objs/buso.obj", "bin/objs/Utah_teapot.obj" };
+
+// Grids from the six axis directions, framed on the bounds, then rays from inside the box every which way
+static void MeshRays(mt19937 &rng, const AABB<float> &bounds, Vector3Stream<float>* origins, Vector3Stream<float>* directions)
+{
+    const Vector3<float> center = bounds.Center(), extents = bounds.Extents();
+    const float distance = extents.Magnitud() * 2.0f;
+    const Vector3<float> axes[] = { Vector3<float>(1, 0, 0), Vector3<float>(0, 1, 0), Vector3<float>(0, 0, 1) };
+
+    for (int a = 0; a < 3; a++)
+        for (float side : { 1.0f, -1.0f })
+        {
+            const Vector3<float> forward = axes[a] * -side, right = axes[(a + 1) % 3], up = axes[(a + 2) % 3];
+            for (int i = 0; i < MESH_GRID * MESH_GRID; i++)
+            {
+                const float x = (i % MESH_GRID) / (MESH_GRID - 1.0f) - 0.5f, y = (i / MESH_GRID) / (MESH_GRID - 1.0f) - 0.5f;
+                origins->PushBack(center - forward * distance);
+                directions->PushBack((forward * 2.0f + right * x + up * y).Normalized());
+            }
+        }
+
+    uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (int r = 0; r < MESH_INNER_RAYS; r++)
+    {
+        origins->PushBack(center + Vector3<float>(extents.x * unit(rng), extents.y * unit(rng), extents.z * unit(rng)));
+        directions->PushBack(Vector3<float>(unit(rng), unit(rng), unit(rng)).Normalized());
+    }
+}
+
+// Bit for bit the brute force hit. Where two triangles are hit at the very same t the brute force loop keeps
+// the lowest index and the BVH the first one it reaches, then the BVH's triangle must give exactly its t, u, v.
+static bool SameMeshHit(const Ray<float> &ray, const TriangleStream &tris, const RayHit &hit, const RayHit &reference, float tMax)
+{
+    if (SameHit(hit, reference)) return true;
+    if (hit.triangle < 0 || !test::SameBits(hit.t, reference.t)) return false;
+
+    float t, u, v;
+    const size_t i = (size_t)hit.triangle;
+    return ray.IntersectTriangle(tris.v0.Get(i), tris.edge1.Get(i), tris.edge2.Get(i), tMax, &t, &u, &v)
+        && test::SameBits(t, hit.t) && test::SameBits(u, hit.u) && test::SameBits(v, hit.v);
+}
+
+static void CheckBVH(const char* mesh, const BVH &bvh, const TriangleStream &tris, const Vector3Stream<float> &origins, const Vector3Stream<float> &directions)
+{
+    // The second one about reaches the middle of the mesh from the grids
+    const float tMaxes[] = { numeric_limits<float>::infinity(), bvh.Bounds().Extents().Magnitud() * 2.0f };
+    for (float tMax : tMaxes)
+    {
+        size_t referenceHits = 0, mismatches = 0;
+        for (size_t r = 0; r < origins.size(); r++)
+        {
+            const Ray<float> ray(origins.Get(r), directions.Get(r));
+            const RayHit reference = Reference(ray, tris, tMax);
+            referenceHits += reference.Hit();
+
+            RayHit hit;
+            const bool found = bvh.Intersect(ray, &hit, tMax);
+            if (found == reference.Hit() && SameMeshHit(ray, tris, hit, reference, tMax)) continue;
+
+            if (mismatches++ < 5)
+                cout << "    " << mesh << ", ray " << r << ": triangle " << hit.triangle << " t " << hit.t
+                     << ", expected triangle " << reference.triangle << " t " << reference.t << endl;
+        }
+        CHECK(mismatches == 0);
+
+        // Or the rays mostly miss and the comparison proves little
+        CHECK(referenceHits > origins.size() / 10);
+    }
+}
+
+static void BVHMatchesBruteForce()
+{
+    mt19937 rng(44);
+    for (const char* mesh : meshes)
+    {
+        vector<float> verts;
+        vector<unsigned int> meshTris;
+        unsigned int vertexCount, triCount;
+        if (!CHECK(fLoaders::OBJLoader(mesh, &verts, &meshTris, &vertexCount, &triCount))) continue;
+
+        TriangleStream tris;
+        tris.FromMesh(verts.data(), meshTris.data(), triCount);
+
+        BVH bvh;
+        bvh.Build(verts.data(), meshTris.data(), triCount);
+        CHECK(bvh.get_triangleCount() == triCount);
+
+        Vector3Stream<float> origins, directions;
+        MeshRays(rng, bvh.Bounds(), &origins, &directions);
+        CheckBVH(mesh, bvh, tris, origins, directions);
+
+        // Built on a pool it's the same tree, only the nodes may be numbered in another order (whichever
+        // thread claims its pair first)
+        ThreadPool pool(3);
+        BVH pooled;
+        pooled.Build(verts.data(), meshTris.data(), triCount, 8, 0, &pool);
+        CHECK(pooled.get_nodes().size() == bvh.get_nodes().size() && pooled.get_triangleIndex() == bvh.get_triangleIndex());
+        CheckBVH(mesh, pooled, tris, origins, directions);
+    }
+}
+
+static void BVHSaveLoadRoundTrip()
+{
+    mt19937 rng(45);
+    const char* mesh = meshes[1];
+
+    vector<float> verts;
+    vector<unsigned int> meshTris;
+    unsigned int vertexCount, triCount;
+    if (!CHECK(fLoaders::OBJLoader(mesh, &verts, &meshTris, &vertexCount, &triCount))) return;
+
+    BVH built;
+    built.Build(verts.data(), meshTris.data(), triCount);
+    CHECK(built.Save(BVH_TEST_FILE));
+
+    // The same binary tree, leaf order and wide nodes, so the same hits
+    BVH loaded;
+    CHECK(loaded.Load(BVH_TEST_FILE, verts.data(), meshTris.data(), triCount));
+    CHECK(loaded.get_nodes().size() == built.get_nodes().size()
+          && memcmp(loaded.get_nodes().data(), built.get_nodes().data(), built.get_nodes().size() * sizeof(BVHNode)) == 0);
+    CHECK(loaded.get_triangleIndex() == built.get_triangleIndex());
+    CHECK(loaded.get_wideNodes().size() == built.get_wideNodes().size()
+          && memcmp(loaded.get_wideNodes().data(), built.get_wideNodes().data(), built.get_wideNodes().size() * sizeof(BVHWideNode<BVH_WIDTH>)) == 0);
+
+    Vector3Stream<float> origins, directions;
+    MeshRays(rng, built.Bounds(), &origins, &directions);
+    size_t mismatches = 0;
+    for (size_t r = 0; r < origins.size(); r++)
+    {
+        const Ray<float> ray(origins.Get(r), directions.Get(r));
+        RayHit a, b;
+        const bool foundA = built.Intersect(ray, &a), foundB = loaded.Intersect(ray, &b);
+        mismatches += foundA != foundB || !SameHit(a, b);
+    }
+    CHECK(mismatches == 0);
+
+    TriangleStream tris;
+    tris.FromMesh(verts.data(), meshTris.data(), triCount);
+    CheckBVH("Loaded BVH", loaded, tris, origins, directions);
+
+    // A moved vertex is a different mesh, the cache has to be refused and the BVH left empty
+    vector<float> moved = verts;
+    moved[meshTris[0] * 8] += 0.5f;
+    BVH stale;
+    CHECK(!stale.Load(BVH_TEST_FILE, moved.data(), meshTris.data(), triCount) && stale.empty());
+    CHECK(!stale.Load(BVH_TEST_FILE, verts.data(), meshTris.data(), triCount - 1) && stale.empty());
+
+    // Cut short
+    {
+        ifstream in(BVH_TEST_FILE, ios::binary);
+        vector<char> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        in.close();
+        ofstream out(BVH_TEST_FILE, ios::binary | ios::trunc);
+        out.write(bytes.data(), bytes.size() - 4);
+    }
+    CHECK(!stale.Load(BVH_TEST_FILE, verts.data(), meshTris.data(), triCount) && stale.empty());
+
+    remove(BVH_TEST_FILE);
+}
+
+int main()
+{
+    RandomTriangles();
+    DuplicateTriangles();
+    DegenerateTriangles();
+    BVHMatchesBruteForce();
+    BVHSaveLoadRoundTrip();
+
+    return test::Report("RayTriangleTests");
+}
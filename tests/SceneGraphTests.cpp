@@ -0,0 +1,421 @@
+// SceneGraph against a parallel set of Transforms chained by hand (world = LocalToWorld() * parent world),
+// world matrices bit for bit, through edits, reparenting, removal and the re-sorts those trigger, then
+// Update() on a ThreadPool against the serial one over random edits of a scene big enough to be split.
+// Exits nonzero on failure. Build from the repo root:
+//   g++ -std=c++17 -O2 -ffp-contract=off -Isrc tests/SceneGraphTests.cpp src/SceneGraph.cpp src/Transform.cpp -o bin/SceneGraphTests -pthread
+// and again with -mavx2 and with -DSR_NO_SIMD.
+
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "SceneGraph.h"
+#include "Transform.h"
+#include "modules/ThreadPool.h"
+
+#define SCENE_NODES 2000
+#define EDITS 300
+
+#define POOLED_NODES 30000
+#define POOLED_CHAIN 6000       // Deeper than SCENE_TASK_SIZE, so Update() walks it in place of splitting
+#define POOLED_ROUNDS 30
+
+using namespace std;
+
+// The graph, and for every handle the Transform, parent and liveness it should have
+struct MirroredScene
+{
+    SceneGraph graph;
+    vector<Transform> locals;
+    vector<SceneNode> parents;
+    vector<uint8_t> alive;
+
+    SceneNode Add(SceneNode parent, const Vector3<float> &position, const Quaternion<float> &orientation, const Vector3<float> &scale)
+    {
+        const SceneNode node = graph.Add(parent, position, orientation, scale);
+        if (node >= locals.size())
+        {
+            locals.resize(node + 1);
+            parents.resize(node + 1, INVALID_SCENE_NODE);
+            alive.resize(node + 1, 0);
+        }
+
+        // Both normalize the orientation on the way in
+        locals[node] = Transform();
+        locals[node].set_position(position);
+        locals[node].set_orientation(orientation);
+        locals[node].set_scale(scale);
+        parents[node] = parent;
+        alive[node] = 1;
+        return node;
+    }
+
+    void Remove(SceneNode node)
+    {
+        graph.Remove(node);
+
+        // The subtree goes with it: anything whose ancestors lead to 'node'. Walked up to the first node
+        // already decided, then decided back down, chains can be thousands deep.
+        vector<uint8_t> removed(alive.size(), 2); // 2 undecided
+        removed[node] = 1;
+        vector<SceneNode> chain;
+        for (SceneNode n = 0; n < alive.size(); n++)
+        {
+            if (!alive[n]) continue;
+
+            SceneNode a = n;
+            for (; a != INVALID_SCENE_NODE && removed[a] == 2; a = parents[a]) chain.push_back(a);
+            const uint8_t decided = a == INVALID_SCENE_NODE ? 0 : removed[a];
+            for (; !chain.empty(); chain.pop_back()) removed[chain.back()] = decided;
+        }
+        for (SceneNode n = 0; n < alive.size(); n++)
+            if (removed[n] == 1) alive[n] = 0;
+    }
+
+    bool IsAncestor(SceneNode ancestor, SceneNode node) const
+    {
+        for (SceneNode a = node; a != INVALID_SCENE_NODE; a = parents[a])
+            if (a == ancestor) return true;
+        return false;
+    }
+
+    vector<SceneNode> AliveNodes() const
+    {
+        vector<SceneNode> nodes;
+        for (SceneNode n = 0; n < alive.size(); n++)
+            if (alive[n]) nodes.push_back(n);
+        return nodes;
+    }
+
+    // Same walk as Remove()
+    vector<Matrix4x4<float>> ReferenceWorlds() const
+    {
+        vector<Matrix4x4<float>> worlds(alive.size());
+        vector<uint8_t> done(alive.size(), 0);
+        vector<SceneNode> chain;
+        for (SceneNode n = 0; n < alive.size(); n++)
+        {
+            if (!alive[n]) continue;
+
+            for (SceneNode a = n; a != INVALID_SCENE_NODE && !done[a]; a = parents[a]) chain.push_back(a);
+            for (; !chain.empty(); chain.pop_back())
+            {
+                const SceneNode a = chain.back();
+                worlds[a] = parents[a] == INVALID_SCENE_NODE ? locals[a].LocalToWorld() : Matrix4x4<float>::Multiply(locals[a].LocalToWorld(), worlds[parents[a]]);
+                done[a] = 1;
+            }
+        }
+        return worlds;
+    }
+};
+
+static Vector3<float> RandomPosition(mt19937 &rng)
+{
+    uniform_real_distribution<float> value(-10.0f, 10.0f);
+    return Vector3<float>(value(rng), value(rng), value(rng));
+}
+
+static Quaternion<float> RandomOrientation(mt19937 &rng)
+{
+    uniform_real_distribution<float> angle(-180.0f, 180.0f);
+    return Quaternion<float>::FromEuler(Vector3<float>(angle(rng), angle(rng), angle(rng)));
+}
+
+// Close to 1, so deep chains stay finite
+static Vector3<float> RandomScale(mt19937 &rng)
+{
+    uniform_real_distribution<float> value(0.9f, 1.1f);
+    return Vector3<float>(value(rng), value(rng), value(rng));
+}
+
+static bool SameMatrix(const Matrix4x4<float> &a, const Matrix4x4<float> &b)
+{
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            if (!test::SameBits(a[r][c], b[r][c])) return false;
+    return true;
+}
+
+// Liveness, parents, size and every world matrix, reports the first mismatching node
+static void CheckScene(const char* step, const MirroredScene &scene)
+{
+    const vector<Matrix4x4<float>> worlds = scene.ReferenceWorlds();
+    const vector<SceneNode> nodes = scene.AliveNodes();
+    CHECK(scene.graph.size() == nodes.size());
+
+    for (SceneNode n = 0; n < scene.alive.size(); n++)
+        if (!CHECK(scene.graph.IsValid(n) == (scene.alive[n] != 0)))
+        {
+            cout << "    " << step << ", node " << n << (scene.alive[n] ? " went missing" : " should be gone") << endl;
+            return;
+        }
+
+    for (SceneNode n : nodes)
+    {
+        if (!CHECK(scene.graph.get_parent(n) == scene.parents[n]))
+        {
+            cout << "    " << step << ", node " << n << ": parent " << scene.graph.get_parent(n) << ", expected " << scene.parents[n] << endl;
+            return;
+        }
+        if (!CHECK(SameMatrix(scene.graph.WorldMatrix(n), worlds[n])))
+        {
+            cout << "    " << step << ", node " << n << "\n" << scene.graph.WorldMatrix(n) << "\n    expected\n" << worlds[n] << endl;
+            return;
+        }
+    }
+}
+
+// Each new node hangs off the last one added or one of its ancestors (or starts a new tree), which is
+// depth first order, so nothing re-sorts
+static void BuildDepthFirst(mt19937 &rng, MirroredScene &scene, size_t count)
+{
+    uniform_int_distribution<int> pick(0, 9);
+    vector<SceneNode> path;
+    for (size_t i = 0; i < count; i++)
+    {
+        const int p = pick(rng);
+        if (p == 0) path.clear();
+        else if (p < 4 && !path.empty()) path.resize(uniform_int_distribution<size_t>(1, path.size())(rng));
+
+        const SceneNode parent = path.empty() ? INVALID_SCENE_NODE : path.back();
+        path.push_back(scene.Add(parent, RandomPosition(rng), RandomOrientation(rng), RandomScale(rng)));
+    }
+}
+
+// Every setter, on the graph and its Transform alike
+static void EditNode(mt19937 &rng, MirroredScene &scene, SceneNode node)
+{
+    uniform_real_distribution<float> delta(-20.0f, 20.0f);
+    switch (uniform_int_distribution<int>(0, 4)(rng))
+    {
+        case 0:
+        {
+            const Vector3<float> position = RandomPosition(rng);
+            scene.graph.set_position(node, position);
+            scene.locals[node].set_position(position);
+            break;
+        }
+        case 1:
+        {
+            // Not unit length, both have to normalize it the same way
+            const Quaternion<float> q = RandomOrientation(rng);
+            const Quaternion<float> orientation(q.x * 1.5f, q.y * 1.5f, q.z * 1.5f, q.w * 1.5f);
+            scene.graph.set_orientation(node, orientation);
+            scene.locals[node].set_orientation(orientation);
+            break;
+        }
+        case 2:
+        {
+            const Vector3<float> scale = RandomScale(rng);
+            scene.graph.set_scale(node, scale);
+            scene.locals[node].set_scale(scale);
+            break;
+        }
+        case 3:
+        {
+            const float x = delta(rng), y = delta(rng), z = delta(rng);
+            scene.graph.Translate(node, x, y, z);
+            scene.locals[node].Translate(x, y, z);
+            break;
+        }
+        default:
+        {
+            const float x = delta(rng), y = delta(rng), z = delta(rng);
+            scene.graph.Rotate(node, x, y, z);
+            scene.locals[node].Rotate(x, y, z);
+            break;
+        }
+    }
+}
+
+static SceneNode RandomNode(mt19937 &rng, const MirroredScene &scene)
+{
+    const vector<SceneNode> nodes = scene.AliveNodes();
+    return nodes[uniform_int_distribution<size_t>(0, nodes.size() - 1)(rng)];
+}
+
+static void EditsMatchTransforms()
+{
+    mt19937 rng(47);
+    MirroredScene scene;
+    BuildDepthFirst(rng, scene, SCENE_NODES);
+
+    scene.graph.Update();
+    CHECK(!scene.graph.get_lastUpdate().relayout && scene.graph.get_lastUpdate().updated == SCENE_NODES);
+    CheckScene("Built", scene);
+
+    // Nothing dirty, nothing recomputed
+    scene.graph.Update();
+    CHECK(scene.graph.get_lastUpdate().updated == 0);
+
+    for (int round = 0; round < 5; round++)
+    {
+        for (int e = 0; e < EDITS / 5; e++) EditNode(rng, scene, RandomNode(rng, scene));
+        scene.graph.Update();
+        CHECK(!scene.graph.get_lastUpdate().relayout);
+        CheckScene("Edited", scene);
+    }
+}
+
+static void ReparentMatchesTransforms()
+{
+    mt19937 rng(48);
+    MirroredScene scene;
+    BuildDepthFirst(rng, scene, SCENE_NODES);
+    scene.graph.Update();
+
+    for (int round = 0; round < 5; round++)
+    {
+        for (int e = 0; e < 40; e++)
+        {
+            const SceneNode node = RandomNode(rng, scene);
+            const SceneNode parent = e % 8 == 0 ? INVALID_SCENE_NODE : RandomNode(rng, scene);
+
+            // Under itself or its own subtree would make a cycle, refused without touching anything
+            const bool cycle = parent != INVALID_SCENE_NODE && scene.IsAncestor(node, parent);
+            CHECK(scene.graph.set_parent(node, parent) == !cycle);
+            if (!cycle) scene.parents[node] = parent;
+
+            if (e % 4 == 0) EditNode(rng, scene, RandomNode(rng, scene));
+        }
+
+        scene.graph.Update();
+        CHECK(scene.graph.get_lastUpdate().relayout);
+        CheckScene("Reparented", scene);
+
+        // Sorted again, so edits alone don't re-sort
+        EditNode(rng, scene, RandomNode(rng, scene));
+        scene.graph.Update();
+        CHECK(!scene.graph.get_lastUpdate().relayout);
+        CheckScene("Edited after reparenting", scene);
+    }
+}
+
+static void RemoveMatchesTransforms()
+{
+    mt19937 rng(49);
+    MirroredScene scene;
+    BuildDepthFirst(rng, scene, SCENE_NODES);
+    scene.graph.Update();
+
+    for (int round = 0; round < 5; round++)
+    {
+        for (int e = 0; e < 10; e++) scene.Remove(RandomNode(rng, scene));
+        CHECK(scene.graph.size() == scene.AliveNodes().size());
+
+        // Edits next to the holes before they're squeezed out
+        for (int e = 0; e < 20; e++) EditNode(rng, scene, RandomNode(rng, scene));
+
+        scene.graph.Update();
+        CHECK(scene.graph.get_lastUpdate().relayout && scene.graph.get_lastUpdate().nodes == scene.AliveNodes().size());
+        CheckScene("Removed", scene);
+
+        // Freed handles come back, under nodes anywhere in the storage, which re-sorts again
+        for (int e = 0; e < 50; e++)
+        {
+            const SceneNode parent = e % 10 == 0 ? INVALID_SCENE_NODE : RandomNode(rng, scene);
+            scene.Add(parent, RandomPosition(rng), RandomOrientation(rng), RandomScale(rng));
+        }
+
+        scene.graph.Update();
+        CHECK(scene.graph.get_lastUpdate().relayout);
+        CheckScene("Added after removing", scene);
+    }
+
+    // Removing a stale handle is a no-op
+    const SceneNode node = RandomNode(rng, scene);
+    scene.Remove(node);
+    const size_t alive = scene.graph.size();
+    scene.graph.Remove(node);
+    CHECK(scene.graph.size() == alive);
+    scene.graph.Update();
+    CheckScene("Removed twice", scene);
+}
+
+// One round of random work, the same calls on both scenes when given the same seed: a batch of edits
+// (sometimes enough to spill past SCENE_TASK_SIZE), sometimes reparenting, removal and adds that re-sort
+static void RandomRound(mt19937 &rng, MirroredScene &scene)
+{
+    uniform_int_distribution<int> pick(0, 9);
+
+    const int edits = pick(rng) < 3 ? POOLED_NODES / 4 : 200;
+    const vector<SceneNode> nodes = scene.AliveNodes();
+    uniform_int_distribution<size_t> node(0, nodes.size() - 1);
+    for (int e = 0; e < edits; e++) EditNode(rng, scene, nodes[node(rng)]);
+
+    if (pick(rng) < 4)
+        for (int e = 0; e < 20; e++)
+        {
+            const SceneNode node = RandomNode(rng, scene), parent = e % 5 == 0 ? INVALID_SCENE_NODE : RandomNode(rng, scene);
+            if (parent != INVALID_SCENE_NODE && scene.IsAncestor(node, parent)) continue;
+            scene.graph.set_parent(node, parent);
+            scene.parents[node] = parent;
+        }
+
+    // Small subtrees, so the scene doesn't drain away
+    if (pick(rng) < 3)
+        for (int e = 0; e < 5; e++)
+        {
+            const SceneNode node = RandomNode(rng, scene);
+            if (scene.graph.get_parent(node) != INVALID_SCENE_NODE) scene.Remove(node);
+        }
+
+    if (pick(rng) < 3)
+        for (int e = 0; e < 100; e++) scene.Add(RandomNode(rng, scene), RandomPosition(rng), RandomOrientation(rng), RandomScale(rng));
+}
+
+static void PooledMatchesSerial()
+{
+    ThreadPool pool(3);
+    MirroredScene serial, pooled;
+
+    // A long chain, then a depth first forest whose trees run past the task size too
+    for (MirroredScene* scene : { &serial, &pooled })
+    {
+        mt19937 rng(50);
+        SceneNode parent = INVALID_SCENE_NODE;
+        for (int i = 0; i < POOLED_CHAIN; i++) parent = scene->Add(parent, RandomPosition(rng), RandomOrientation(rng), RandomScale(rng));
+        BuildDepthFirst(rng, *scene, POOLED_NODES - POOLED_CHAIN);
+    }
+
+    size_t splitRounds = 0, relayoutRounds = 0;
+    for (int round = 0; round <= POOLED_ROUNDS; round++)
+    {
+        // Round 0 is the first Update() of the whole scene
+        if (round > 0)
+        {
+            mt19937 serialRng(1000 + round), pooledRng(1000 + round);
+            RandomRound(serialRng, serial);
+            RandomRound(pooledRng, pooled);
+        }
+
+        serial.graph.Update();
+        pooled.graph.Update(&pool);
+
+        const SceneUpdateStats &s = serial.graph.get_lastUpdate(), &p = pooled.graph.get_lastUpdate();
+        CHECK(s.nodes == p.nodes && s.updated == p.updated && s.subtrees == p.subtrees && s.relayout == p.relayout);
+        splitRounds += p.updated > SCENE_TASK_SIZE;
+        relayoutRounds += p.relayout;
+
+        // Exactly the serial result, then both against the Transforms
+        size_t mismatches = 0;
+        for (SceneNode n : serial.AliveNodes())
+            mismatches += !(pooled.graph.IsValid(n) && SameMatrix(pooled.graph.WorldMatrix(n), serial.graph.WorldMatrix(n)));
+        if (!CHECK(mismatches == 0)) cout << "    Round " << round << ": " << mismatches << " of " << s.nodes << " nodes differ" << endl;
+
+        CheckScene("Pooled", pooled);
+    }
+
+    // Or the pool never got the big updates, or the re-sorts, this is meant to cover
+    if (!CHECK(splitRounds >= 5 && relayoutRounds >= 5)) cout << "    " << splitRounds << " split updates, " << relayoutRounds << " re-sorts" << endl;
+}
+
+int main()
+{
+    EditsMatchTransforms();
+    ReparentMatchesTransforms();
+    RemoveMatchesTransforms();
+    PooledMatchesSerial();
+
+    return test::Report("SceneGraphTests");
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstring>
+#include <iostream>
+
+// Bare bones checks for the test executables in this folder. A failed CHECK prints where it failed and
+// carries on, main() returns test::Report() so any failure gives a nonzero exit code.
+namespace test
+{
+    static int checks = 0;
+    static int failures = 0;
+
+    static inline bool Check(bool passed, const char* expression, const char* file, int line)
+    {
+        checks++;
+        if (!passed)
+        {
+            failures++;
+            std::cout << "[Test] " << file << ":" << line << " failed: " << expression << std::endl;
+        }
+        return passed;
+    }
+
+    // Same bytes, so NaNs and signed zeros count too
+    template <typename T>
+    static inline bool SameBits(const T &a, const T &b)
+    {
+        return memcmp(&a, &b, sizeof(T)) == 0;
+    }
+
+    static inline int Report(const char* name)
+    {
+        std::cout << "[" << name << "] " << checks - failures << " / " << checks << " checks passed." << std::endl;
+        return failures == 0 ? 0 : 1;
+    }
+}
+
+#define CHECK(expression) test::Check((expression), #expression, __FILE__, __LINE__)
@@ -0,0 +1,177 @@
+// Vector3Stream Dot / Cross / Normalize / MinMax against Vector3<float> one element at a time, bit for bit,
+// and Gather / Scatter against plain loops over interleaved vertices, for sizes that leave a scalar tail.
+// Exits nonzero on failure. Build from the repo root:
+//   g++ -std=c++17 -O2 -ffp-contract=off -Isrc tests/Vector3StreamTests.cpp -o bin/Vector3StreamTests
+// and again with -mavx2 and with -DSR_NO_SIMD.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "modules/Vector3Stream.h"
+
+#define GUARD_FLOATS 32 // Past the last vertex of every buffer, must come back untouched
+#define GUARD_VALUE -12345.0f
+
+using namespace std;
+
+// Around the lane widths (4, 8, 16) and well past them
+static const size_t counts[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 100, 1023 };
+
+static Vector3Stream<float> RandomStream(mt19937 &rng, size_t count)
+{
+    uniform_real_distribution<float> value(-100.0f, 100.0f);
+    Vector3Stream<float> stream;
+    for (size_t i = 0; i < count; i++) stream.PushBack(Vector3<float>(value(rng), value(rng), value(rng)));
+    return stream;
+}
+
+static bool SameVector(const Vector3<float> &a, const Vector3<float> &b)
+{
+    return test::SameBits(a.x, b.x) && test::SameBits(a.y, b.y) && test::SameBits(a.z, b.z);
+}
+
+static void CheckVector(const char* op, size_t count, size_t i, const Vector3<float> &v, const Vector3<float> &expected)
+{
+    if (!CHECK(SameVector(v, expected)))
+        cout << "    " << op << ", count " << count << ", element " << i << ": " << v << " != " << expected << endl;
+}
+
+static void MathMatchesVector3()
+{
+    mt19937 rng(41);
+    for (size_t count : counts)
+    {
+        const Vector3Stream<float> a = RandomStream(rng, count), b = RandomStream(rng, count);
+
+        vector<float> dots(count + GUARD_FLOATS, GUARD_VALUE);
+        Vector3Stream<float>::Dot(a, b, dots.data());
+        for (size_t i = 0; i < count; i++)
+            if (!CHECK(test::SameBits(dots[i], Vector3<float>::Dot(a.Get(i), b.Get(i)))))
+                cout << "    Dot, count " << count << ", element " << i << endl;
+        CHECK(all_of(dots.begin() + count, dots.end(), [](float v) { return v == GUARD_VALUE; }));
+
+        Vector3Stream<float> cross;
+        Vector3Stream<float>::Cross(a, b, &cross);
+        CHECK(cross.size() == count);
+        for (size_t i = 0; i < count; i++) CheckVector("Cross", count, i, cross.Get(i), Vector3<float>::Cross(a.Get(i), b.Get(i)));
+
+        // Into one of its inputs
+        Vector3Stream<float> inPlace = a;
+        Vector3Stream<float>::Cross(inPlace, b, &inPlace);
+        for (size_t i = 0; i < count; i++) CheckVector("Cross in place", count, i, inPlace.Get(i), Vector3<float>::Cross(a.Get(i), b.Get(i)));
+
+        // A zero vector in every lane position, which has to turn into the same NaNs as Vector3::Normalize()
+        Vector3Stream<float> normalized = a;
+        for (size_t i = 0; i < count; i += 5) normalized.Set(i, Vector3<float>(0, 0, 0));
+        const Vector3Stream<float> source = normalized;
+        normalized.Normalize();
+        for (size_t i = 0; i < count; i++)
+        {
+            Vector3<float> expected = source.Get(i);
+            expected.Normalize();
+            CheckVector("Normalize", count, i, normalized.Get(i), expected);
+        }
+
+        Vector3<float> min, max;
+        a.MinMax(&min, &max);
+        Vector3<float> expectedMin, expectedMax;
+        for (size_t i = 0; i < count; i++)
+        {
+            const Vector3<float> v = a.Get(i);
+            if (i == 0) { expectedMin = expectedMax = v; continue; }
+            expectedMin = Vector3<float>(std::min(expectedMin.x, v.x), std::min(expectedMin.y, v.y), std::min(expectedMin.z, v.z));
+            expectedMax = Vector3<float>(std::max(expectedMax.x, v.x), std::max(expectedMax.y, v.y), std::max(expectedMax.z, v.z));
+        }
+        CheckVector("MinMax, min", count, 0, min, expectedMin);
+        CheckVector("MinMax, max", count, 0, max, expectedMax);
+    }
+}
+
+static vector<float> RandomVertices(mt19937 &rng, size_t vertexCount, int stride)
+{
+    uniform_real_distribution<float> value(-100.0f, 100.0f);
+    vector<float> verts(vertexCount * stride + GUARD_FLOATS, GUARD_VALUE);
+    for (size_t i = 0; i < vertexCount * stride; i++) verts[i] = value(rng);
+    return verts;
+}
+
+// Layouts with the three floats at the start, in the middle and at the end of the vertex. Offset 5 at stride 8
+// is the OBJLoader normal, where the SSE2 load window has to start one float early.
+static const int layouts[][2] = { { 8, 0 }, { 8, 3 }, { 8, 5 }, { 3, 0 }, { 4, 0 }, { 4, 1 }, { 6, 3 }, { 5, 2 } };
+
+static void GatherMatchesLoop()
+{
+    mt19937 rng(42);
+    for (auto const &layout : layouts)
+        for (size_t count : counts)
+        {
+            const int stride = layout[0], offset = layout[1];
+
+            // No guard here, so reading past the last vertex shows up under -fsanitize=address
+            const vector<float> guarded = RandomVertices(rng, count, stride);
+            const vector<float> verts(guarded.begin(), guarded.begin() + count * stride);
+
+            Vector3Stream<float> stream = RandomStream(rng, 3); // Resized by Gather
+            stream.Gather(verts.data(), count, stride, offset);
+
+            CHECK(stream.size() == count);
+            for (size_t i = 0; i < count; i++)
+            {
+                const float* src = &verts[i * stride + offset];
+                if (!CHECK(SameVector(stream.Get(i), Vector3<float>(src[0], src[1], src[2]))))
+                    cout << "    Gather, stride " << stride << ", offset " << offset << ", count " << count << ", vertex " << i << endl;
+            }
+        }
+}
+
+static void ScatterMatchesLoop()
+{
+    mt19937 rng(43);
+    for (auto const &layout : layouts)
+        for (size_t count : counts)
+        {
+            const int stride = layout[0], offset = layout[1];
+            const Vector3Stream<float> stream = RandomStream(rng, count);
+            const vector<float> before = RandomVertices(rng, count, stride);
+
+            // Everything but the three floats at 'offset' keeps its value, the fourth column of the load
+            // window and the guard past the last vertex included
+            vector<float> expected = before;
+            for (size_t i = 0; i < count; i++)
+            {
+                const Vector3<float> v = stream.Get(i);
+                expected[i * stride + offset] = v.x;
+                expected[i * stride + offset + 1] = v.y;
+                expected[i * stride + offset + 2] = v.z;
+            }
+
+            vector<float> verts = before;
+            stream.Scatter(verts.data(), stride, offset);
+
+            if (!CHECK(verts == expected))
+                for (size_t f = 0; f < verts.size(); f++)
+                    if (verts[f] != expected[f])
+                    {
+                        cout << "    Scatter, stride " << stride << ", offset " << offset << ", count " << count << ": float " << f << " of vertex " << f / stride << endl;
+                        break;
+                    }
+
+            // And back
+            Vector3Stream<float> gathered;
+            gathered.Gather(verts.data(), count, stride, offset);
+            bool same = true;
+            for (size_t i = 0; i < count; i++) same = same && SameVector(gathered.Get(i), stream.Get(i));
+            CHECK(same);
+        }
+}
+
+int main()
+{
+    MathMatchesVector3();
+    GatherMatchesLoop();
+    ScatterMatchesLoop();
+
+    return test::Report("Vector3StreamTests");
+}